@@ -50,6 +50,19 @@ $$PWD/header/xlsxabstractooxmlfile.h \
     $$PWD/header/xlsxzipwriter_p.h \
     $$PWD/property.hpp \
     $$PWD/qtablewidgetwithcopypaste.h \
+    $$PWD/samplering.h \
+    $$PWD/lineframer.h \
+    $$PWD/commstats.h \
+    $$PWD/logwriter.h \
+    $$PWD/eventcapture.h \
+    $$PWD/logcompressor.h \
+    $$PWD/logreader.h \
+    $$PWD/decimatedgraph.h \
+    $$PWD/seqlock.h \
+    $$PWD/scpi.h \
+    $$PWD/controlserver.h \
+    $$PWD/numberconv.h \
+    $$PWD/binarylog.h \
     $$PWD/signal.hpp \
     $$PWD/stdafx.h \
     $$PWD/socket.h \
@@ -114,6 +127,15 @@ $$PWD/source/xlsxabstractooxmlfile.cpp \
     $$PWD/aboutdialog.cpp \
     $$PWD/parser.cpp \
     $$PWD/clickablelabel.cpp \
+    $$PWD/lineframer.cpp \
+    $$PWD/commstats.cpp \
+    $$PWD/logwriter.cpp \
+    $$PWD/eventcapture.cpp \
+    $$PWD/logcompressor.cpp \
+    $$PWD/logreader.cpp \
+    $$PWD/decimatedgraph.cpp \
+    $$PWD/controlserver.cpp \
+    $$PWD/binarylog.cpp \
     $$PWD/errorhistorydlg.cpp
 FORMS += $$PWD/magnetdaq.ui \
     $$PWD/aboutdialog.ui \
@@ -5,6 +5,7 @@
 TEMPLATE = app
 TARGET = Magnet-DAQ
 QT += core network opengl widgets gui printsupport concurrent gui-private
+CONFIG += c++17
 DEFINES += QT_NETWORK_LIB QT_CONCURRENT_LIB QT_WIDGETS_LIB QT_PRINTSUPPORT_LIB QT_OPENGL_LIB
 INCLUDEPATH += ./GeneratedFiles \
     . \
@@ -0,0 +1,432 @@
+#include "stdafx.h"
+#include "binarylog.h"
+#include "logwriter.h"
+#include <QtEndian>
+#include <array>
+#include <cstring>
+
+static const char MAGIC[8] = { 'M', 'D', 'A', 'Q', 'L', 'O', 'G', '\0' };
+
+// record field list, written into every segment header
+static const char RECORD_FIELDS[] =
+	"type:u8,layout:u8,state:u8,heater:u8,flags:u8,reserved:u8[3],time:i64,timebase:f64,"
+	"field:f64,current:f64,voltage:f64,supplyCurrent:f64,supplyVoltage:f64,refCurrent:f64,"
+	"sendTime:i64,receiveTime:i64,midpointTime:i64";
+
+const int EXPORT_BLOCK_SIZE = 64 * 1024;
+const int REPAIR_CHUNK_SIZE = 1024 * 1024;
+const int MAX_HEADER_TEXT = 64 * 1024;
+
+
+//---------------------------------------------------------------------------
+// Little-endian field access
+//---------------------------------------------------------------------------
+static inline void putInt64(char *p, qint64 value)
+{
+	qToLittleEndian<qint64>(value, p);
+}
+
+static inline qint64 getInt64(const char *p)
+{
+	return qFromLittleEndian<qint64>(p);
+}
+
+static inline void putDouble(char *p, double value)
+{
+	quint64 bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+	qToLittleEndian<quint64>(bits, p);
+}
+
+static inline double getDouble(const char *p)
+{
+	quint64 bits = qFromLittleEndian<quint64>(p);
+	double value;
+
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+//---------------------------------------------------------------------------
+bool BinaryLog::isBinaryLogFile(const QString &fileName)
+{
+	return QFileInfo(fileName).suffix().compare("mdl", Qt::CaseInsensitive) == 0;
+}
+
+//---------------------------------------------------------------------------
+bool BinaryLog::isSegmentHeader(const char *data, qint64 length)
+{
+	return length >= (qint64)sizeof(MAGIC) && memcmp(data, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+//---------------------------------------------------------------------------
+QByteArray BinaryLog::segmentHeader(const QMap<QString, QString> &fields)
+{
+	QByteArray text;
+
+	for (auto it = fields.constBegin(); it != fields.constEnd(); ++it)
+		text += it.key().toUtf8() + "=" + it.value().toUtf8() + "\n";
+
+	text += "IndexInterval=" + QByteArray::number(INDEX_INTERVAL) + "\n";
+	text += QByteArray("Record=") + RECORD_FIELDS + "\n";
+
+	QByteArray header(HEADER_SIZE, '\0');
+	char *p = header.data();
+
+	memcpy(p, MAGIC, sizeof(MAGIC));
+	qToLittleEndian<quint16>(VERSION, p + 8);
+	qToLittleEndian<quint16>(RECORD_SIZE, p + 10);
+	qToLittleEndian<quint32>(text.size(), p + 12);
+
+	return header + text;
+}
+
+//---------------------------------------------------------------------------
+void BinaryLog::encodeData(char *record, const Sample &sample, double timebase, quint8 layout, quint8 heater)
+{
+	memset(record, 0, RECORD_SIZE);
+
+	record[0] = DATA_RECORD;
+	record[1] = layout;
+	record[2] = sample.state;
+	record[3] = heater;
+	record[4] = sample.stale ? STALE_FLAG : 0;
+	putInt64(record + 8, sample.time);
+	putDouble(record + 16, timebase);
+	putDouble(record + 24, sample.magnetField);
+	putDouble(record + 32, sample.magnetCurrent);
+	putDouble(record + 40, sample.magnetVoltage);
+	putDouble(record + 48, sample.supplyCurrent);
+	putDouble(record + 56, sample.supplyVoltage);
+	putDouble(record + 64, sample.refCurrent);
+	putInt64(record + 72, sample.sendTime);
+	putInt64(record + 80, sample.receiveTime);
+	putInt64(record + 88, sample.midpointTime);
+}
+
+//---------------------------------------------------------------------------
+void BinaryLog::encodeIndex(char *record, quint32 ordinal, qint64 time, double timebase, qint64 segmentOffset)
+{
+	memset(record, 0, RECORD_SIZE);
+
+	record[0] = INDEX_RECORD;
+	qToLittleEndian<quint32>(ordinal, record + 4);	// data records before this one in the segment
+	putInt64(record + 8, time);						// of the next data record
+	putDouble(record + 16, timebase);
+	putInt64(record + 24, segmentOffset);
+}
+
+//---------------------------------------------------------------------------
+void BinaryLog::encodeCommit(char *record, quint32 samples, qint64 groupBytes, quint32 groupCrc)
+{
+	memset(record, 0, RECORD_SIZE);
+
+	record[0] = COMMIT_RECORD;
+	qToLittleEndian<quint32>(samples, record + 4);	// data records in the group
+	putInt64(record + 8, QDateTime::currentMSecsSinceEpoch());
+	qToLittleEndian<quint32>(groupCrc, record + 16);
+	putInt64(record + 24, groupBytes);				// since the previous commit or segment header
+}
+
+//---------------------------------------------------------------------------
+// CRC-32 (IEEE 802.3), chained like zlib's: start with crc = 0.
+quint32 BinaryLog::crc32(quint32 crc, const char *data, qint64 length)
+{
+	static const auto table = []()
+	{
+		std::array<quint32, 256> t;
+
+		for (quint32 i = 0; i < 256; i++)
+		{
+			quint32 c = i;
+
+			for (int k = 0; k < 8; k++)
+				c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+
+			t[i] = c;
+		}
+
+		return t;
+	}();
+
+	crc = ~crc;
+
+	for (qint64 i = 0; i < length; i++)
+		crc = table[(crc ^ (quint8)data[i]) & 0xFF] ^ (crc >> 8);
+
+	return ~crc;
+}
+
+//---------------------------------------------------------------------------
+bool BinaryLog::decodeData(const char *record, Sample &sample, double &timebase, quint8 &layout)
+{
+	if (record[0] != DATA_RECORD)
+		return false;
+
+	layout = (quint8)record[1];
+	sample.state = (quint8)record[2];
+	sample.heater = (quint8)record[3];
+	sample.stale = (record[4] & STALE_FLAG) != 0;
+	sample.time = getInt64(record + 8);
+	timebase = getDouble(record + 16);
+	sample.magnetField = getDouble(record + 24);
+	sample.magnetCurrent = getDouble(record + 32);
+	sample.magnetVoltage = getDouble(record + 40);
+	sample.supplyCurrent = getDouble(record + 48);
+	sample.supplyVoltage = getDouble(record + 56);
+	sample.refCurrent = getDouble(record + 64);
+	sample.sendTime = getInt64(record + 72);
+	sample.receiveTime = getInt64(record + 80);
+	sample.midpointTime = getInt64(record + 88);
+
+	return true;
+}
+
+//---------------------------------------------------------------------------
+QMap<QString, QString> BinaryLog::parseSegmentText(const QByteArray &text)
+{
+	QMap<QString, QString> fields;
+
+	for (const QByteArray &line : text.split('\n'))
+	{
+		int separator = line.indexOf('=');
+
+		if (separator > 0)
+			fields.insert(QString::fromUtf8(line.left(separator)), QString::fromUtf8(line.mid(separator + 1)));
+	}
+
+	return fields;
+}
+
+//---------------------------------------------------------------------------
+// Only the last segment can be damaged. A partial record is always removed;
+// if the segment carries commit records, so is everything after the first
+// group that fails its checksum. Complete records after the last commit
+// are kept, they were simply not checksummed yet.
+qint64 BinaryLog::repairTail(const QString &fileName)
+{
+	QFile file(fileName);
+
+	if (!file.open(QFile::ReadWrite))
+		return -1;
+
+	const QByteArray magic(MAGIC, sizeof(MAGIC));
+	qint64 size = file.size();
+	qint64 headerPos = -1;
+
+	// last segment header, scanning back from the end
+	for (qint64 end = size; end > 0 && headerPos < 0; )
+	{
+		qint64 start = qMax(end - REPAIR_CHUNK_SIZE, (qint64)0);
+
+		file.seek(start);
+
+		// overlap the next chunk so a header across the boundary is found
+		QByteArray chunk = file.read(qMin(end + (qint64)sizeof(MAGIC) - 1, size) - start);
+		int index = chunk.lastIndexOf(magic);
+
+		if (index >= 0)
+			headerPos = start + index;
+
+		end = start;
+	}
+
+	if (headerPos < 0)
+		return -1;
+
+	char fixed[HEADER_SIZE];
+	qint64 cut = headerPos;		// drop a header that did not make it out whole
+	qint64 recordSize = 0;
+	qint64 textLength = 0;
+
+	file.seek(headerPos);
+
+	if (file.read(fixed, HEADER_SIZE) == HEADER_SIZE)
+	{
+		recordSize = qFromLittleEndian<quint16>(fixed + 10);
+		textLength = qFromLittleEndian<quint32>(fixed + 12);
+	}
+
+	if (recordSize >= RECORD_SIZE && textLength <= MAX_HEADER_TEXT && headerPos + HEADER_SIZE + textLength <= size)
+	{
+		// the first group starts at the segment header
+		QByteArray text = file.read(textLength);
+		quint32 crc = crc32(crc32(0, fixed, HEADER_SIZE), text.constData(), text.size());
+		qint64 groupBytes = HEADER_SIZE + textLength;
+		qint64 pos = headerPos + groupBytes;
+		qint64 lastCommit = -1;
+		bool damaged = false;
+		QByteArray buffer;
+		int offset = 0;
+
+		cut = pos;
+
+		while (pos + recordSize <= size)
+		{
+			if (offset >= buffer.size())
+			{
+				buffer = file.read(qMax((qint64)REPAIR_CHUNK_SIZE / recordSize, (qint64)1) * recordSize);
+				offset = 0;
+
+				if (buffer.size() < recordSize)
+					break;
+			}
+
+			const char *record = buffer.constData() + offset;
+
+			if (record[0] == COMMIT_RECORD)
+			{
+				if (qFromLittleEndian<quint32>(record + 16) != crc || getInt64(record + 24) != groupBytes)
+				{
+					damaged = true;
+					break;
+				}
+
+				crc = 0;
+				groupBytes = 0;
+				lastCommit = pos + recordSize;
+			}
+			else if (record[0] == DATA_RECORD || record[0] == INDEX_RECORD)
+			{
+				crc = crc32(crc, record, recordSize);
+				groupBytes += recordSize;
+			}
+			else
+			{
+				damaged = true;
+				break;
+			}
+
+			pos += recordSize;
+			offset += recordSize;
+			cut = pos;
+		}
+
+		// unverifiable data after a bad group is not kept
+		if (damaged && lastCommit >= 0)
+			cut = lastCommit;
+	}
+
+	file.close();
+
+	if (cut < size)
+	{
+		qDebug() << "Repairing binary log tail: " << fileName << " removing " << size - cut << " bytes";
+
+		if (!QFile::resize(fileName, cut))
+			return -1;
+	}
+
+	return size - cut;
+}
+
+//---------------------------------------------------------------------------
+// Reproduces the text log: a blank line and the start date for each run,
+// the column header for each segment, then one line per data record. A
+// partial record at the end (e.g. after a crash) is ignored.
+bool BinaryLog::exportToCsv(const QString &source, const QString &destination, QString *errorMessage)
+{
+	auto fail = [errorMessage](const QString &message)
+	{
+		if (errorMessage)
+			*errorMessage = message;
+
+		return false;
+	};
+
+	QFile in(source);
+	QFile out(destination);
+
+	if (!in.open(QFile::ReadOnly))
+		return fail("Cannot open " + source + ": " + in.errorString());
+
+	char fixed[HEADER_SIZE];
+
+	if (in.peek(fixed, HEADER_SIZE) != HEADER_SIZE || !isSegmentHeader(fixed, HEADER_SIZE))
+		return fail(source + " is not a Magnet-DAQ binary log");
+
+	if (!out.open(QFile::WriteOnly | QFile::Truncate))
+		return fail("Cannot create " + destination + ": " + out.errorString());
+
+	QByteArray block;
+	QByteArray record;
+	QString session;
+	int recordSize = 0;
+
+	block.reserve(EXPORT_BLOCK_SIZE + LogWriter::MAX_LINE_LENGTH);
+
+	while (!in.atEnd())
+	{
+		if (in.peek(fixed, HEADER_SIZE) == HEADER_SIZE && isSegmentHeader(fixed, HEADER_SIZE))
+		{
+			in.read(fixed, HEADER_SIZE);
+
+			if (qFromLittleEndian<quint16>(fixed + 8) > VERSION)
+				return fail(source + " was written by a newer version of Magnet-DAQ");
+
+			// newer minor formats may only append fields to a record
+			recordSize = qFromLittleEndian<quint16>(fixed + 10);
+
+			if (recordSize < RECORD_SIZE)
+				return fail(source + " has an invalid record size");
+
+			QByteArray text = in.read(qFromLittleEndian<quint32>(fixed + 12));
+			QMap<QString, QString> fields = parseSegmentText(text);
+
+			// a new run starts with a blank line and the date
+			if (fields.value("Session") != session)
+			{
+				session = fields.value("Session");
+				QString line = session;
+
+				// samples of a compressed log are as sparse as the original
+				if (fields.contains("Compression") && fields.value("Compression") != "none")
+					line += " (compressed: " + fields.value("Compression") + ")";
+
+				block += "\n" + line.toLatin1() + "\n";
+			}
+
+			block += fields.value("Columns").toLocal8Bit() + "\n";
+			record.resize(recordSize);
+			continue;
+		}
+
+		if (in.read(record.data(), recordSize) != recordSize)
+			break;	// truncated tail
+
+		if (record.at(0) == DATA_RECORD)
+		{
+			Sample sample;
+			double timebase;
+			quint8 layout;
+
+			decodeData(record.constData(), sample, timebase, layout);
+
+			int offset = block.size();
+
+			block.resize(offset + LogWriter::MAX_LINE_LENGTH);
+			block.resize(offset + LogWriter::formatSample(sample, timebase, (LogLayout)layout, sample.heater,
+				block.data() + offset, block.data() + offset + LogWriter::MAX_LINE_LENGTH));
+		}
+		else if (record.at(0) != INDEX_RECORD && record.at(0) != COMMIT_RECORD)
+		{
+			return fail(source + " is corrupt at offset " + QString::number(in.pos() - recordSize));
+		}
+
+		if (block.size() >= EXPORT_BLOCK_SIZE)
+		{
+			if (out.write(block) != block.size())
+				return fail("Cannot write " + destination + ": " + out.errorString());
+
+			block.clear();
+		}
+	}
+
+	if (out.write(block) != block.size())
+		return fail("Cannot write " + destination + ": " + out.errorString());
+
+	return true;
+}
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,67 @@
+#ifndef BINARYLOG_H
+#define BINARYLOG_H
+
+#include <QString>
+#include <QByteArray>
+#include <QMap>
+#include "socket.h"
+
+//---------------------------------------------------------------------------
+// Compact binary data log (.mdl). A file is a sequence of segments, one per
+// log header written (each run, or a units change during a run). Each
+// segment starts with a header:
+//
+//	 0	char[8]	"MDAQLOG" + NUL
+//	 8	u16		format version
+//	10	u16		record size
+//	12	u32		length of the text that follows
+//	16	text	UTF-8 "key=value" lines: session start, model, serial,
+//				firmware, units, CSV columns and the record field list
+//
+// followed by fixed-size little-endian records. Every INDEX_INTERVAL data
+// records an index record is inserted, holding the time of the data record
+// that follows it and the file offset of its segment header, so a reader
+// can seek by time without decoding every sample.
+//
+// Each time the writer flushes it adds a commit record carrying the CRC-32
+// and length of everything written since the previous commit (a group
+// never spans segment headers). After a crash repairTail() uses these to
+// cut the file back to its last intact data before appending.
+//---------------------------------------------------------------------------
+class BinaryLog
+{
+public:
+	static const quint16 VERSION = 1;
+	static const int HEADER_SIZE = 16;		// fixed part of a segment header
+	static const int RECORD_SIZE = 96;
+	static const int INDEX_INTERVAL = 600;	// data records per index record (~1 min at 10 Hz)
+
+	// record types, first byte of every record
+	static const char DATA_RECORD = 'D';
+	static const char INDEX_RECORD = 'I';
+	static const char COMMIT_RECORD = 'C';
+
+	static const quint8 STALE_FLAG = 0x01;
+
+	static bool isBinaryLogFile(const QString &fileName);
+	static bool isSegmentHeader(const char *data, qint64 length);
+
+	// encoding, used by the log writer thread
+	static QByteArray segmentHeader(const QMap<QString, QString> &fields);
+	static void encodeData(char *record, const Sample &sample, double timebase, quint8 layout, quint8 heater);
+	static void encodeIndex(char *record, quint32 ordinal, qint64 time, double timebase, qint64 segmentOffset);
+	static void encodeCommit(char *record, quint32 samples, qint64 groupBytes, quint32 groupCrc);
+	static quint32 crc32(quint32 crc, const char *data, qint64 length);
+
+	// decoding
+	static bool decodeData(const char *record, Sample &sample, double &timebase, quint8 &layout);
+	static QMap<QString, QString> parseSegmentText(const QByteArray &text);
+
+	// removes a damaged tail left by a crash, returns the bytes removed (-1 on error)
+	static qint64 repairTail(const QString &fileName);
+
+	// converts a binary log back to the CSV layout of a text log
+	static bool exportToCsv(const QString &source, const QString &destination, QString *errorMessage = nullptr);
+};
+
+#endif // BINARYLOG_H
@@ -0,0 +1,367 @@
+#include "stdafx.h"
+#include "commstats.h"
+#include <limits>
+
+// query state names for reports, in QueryState order
+static const char *queryStateNames[] =
+{
+	"WELCOME_STRING",
+	"FIRMWARE_VERSION",
+	"MODE",
+	"IPNAME",
+	"TARGET_CURRENT",
+	"TARGET_FIELD",
+	"VOLTAGE_LIMIT",
+	"CURRENT_RANGE",
+	"SUPPLY_TYPE",
+	"SUPPLY_MIN_VOLTAGE",
+	"SUPPLY_MAX_VOLTAGE",
+	"SUPPLY_MIN_CURRENT",
+	"SUPPLY_MAX_CURRENT",
+	"SUPPLY_VV_INPUT",
+	"STABILITY_MODE",
+	"STABILITY_SETTING",
+	"STABILITY_RESISTOR",
+	"COIL_CONSTANT",
+	"CURRENT_LIMIT",
+	"INDUCTANCE",
+	"ABSORBER_PRESENT",
+	"SWITCH_INSTALLED",
+	"SWITCH_CURRENT",
+	"SWITCH_TRANSITION",
+	"SWITCH_HEATED_TIME",
+	"SWITCH_COOLED_TIME",
+	"PS_RAMP_RATE",
+	"SWITCH_COOLING_GAIN",
+	"QUENCH_ENABLE",
+	"QUENCH_SENSITIVITY",
+	"SAMPLE_QUENCH_ENABLE",
+	"SAMPLE_QUENCH_LIMIT",
+	"EXT_RAMPDOWN",
+	"PROTECTION_MODE",
+	"IC_SLOPE",
+	"IC_OFFSET",
+	"TMAX",
+	"TSCALE",
+	"TOFFSET",
+	"SENSE_INDUCTANCE",
+	"AUTODETECT_SWITCH_CURRENT",
+	"RAMP_TIMEBASE",
+	"FIELD_UNITS",
+	"RAMP_SEGMENTS",
+	"RAMP_RATE_CURRENT",
+	"RAMP_RATE_FIELD",
+	"RAMPDOWN_SEGMENTS",
+	"RAMPDOWN_CURRENT",
+	"RAMPDOWN_FIELD",
+	"SAMPLE_CURRENT",
+	"SAMPLE_VOLTAGE",
+	"STATE",
+	"RAMPDOWN_COUNT",
+	"RAMPDOWN_FILE",
+	"QUENCH_COUNT",
+	"QUENCH_FILE",
+	"MSG_UPDATE",
+	"SYSTEM_ERROR",
+	"STATUS_BYTE",
+	"SETTINGS",
+	"TRG_SAMPLE",
+	"AMI_TRG_SAMPLE",
+	"SWITCH_HTR_STATE",
+	"IDLE_STATE",
+};
+
+static_assert(sizeof(queryStateNames) / sizeof(queryStateNames[0]) == (int)QueryState::IDLE_STATE + 1, "queryStateNames must match QueryState");
+
+static const char *commandTypeNames[] =
+{
+	"Common (*)",
+	"CONFigure",
+	"Ramp control",
+	"PSwitch",
+	"SYSTem",
+	"Other",
+};
+
+static_assert(sizeof(commandTypeNames) / sizeof(commandTypeNames[0]) == (int)CommandType::COUNT, "commandTypeNames must match CommandType");
+
+
+//---------------------------------------------------------------------------
+LatencyHistogram::LatencyHistogram()
+{
+	reset();
+}
+
+//---------------------------------------------------------------------------
+void LatencyHistogram::reset(void)
+{
+	for (int i = 0; i < BUCKETS; i++)
+		counts[i].store(0, std::memory_order_relaxed);
+
+	totalCount.store(0, std::memory_order_relaxed);
+	totalSum.store(0, std::memory_order_relaxed);
+	minValue.store(std::numeric_limits<qint64>::max(), std::memory_order_relaxed);
+	maxValue.store(0, std::memory_order_relaxed);
+}
+
+//---------------------------------------------------------------------------
+// Values below SUB_BUCKETS map directly. Above that, the position of the
+// leading one bit picks the power of two and the next SUB_BUCKET_BITS bits
+// pick the linear sub-bucket within it.
+int LatencyHistogram::bucketIndex(qint64 value)
+{
+	if (value < 0)
+		value = 0;
+	else if (value >= ((qint64)1 << MAX_VALUE_BITS))
+		value = ((qint64)1 << MAX_VALUE_BITS) - 1;
+
+	if (value < SUB_BUCKETS)
+		return (int)value;
+
+	int magnitude = 63 - qCountLeadingZeroBits((quint64)value);
+	int shift = magnitude - SUB_BUCKET_BITS;
+	int subBucket = (int)(value >> shift) - SUB_BUCKETS;
+
+	return (shift + 1) * SUB_BUCKETS + subBucket;
+}
+
+//---------------------------------------------------------------------------
+qint64 LatencyHistogram::bucketUpperBound(int index)
+{
+	if (index < SUB_BUCKETS)
+		return index;
+
+	int shift = index / SUB_BUCKETS - 1;
+	qint64 lower = (qint64)(SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+
+	return lower + ((qint64)1 << shift) - 1;
+}
+
+//---------------------------------------------------------------------------
+void LatencyHistogram::record(qint64 usecs)
+{
+	counts[bucketIndex(usecs)].fetch_add(1, std::memory_order_relaxed);
+	totalCount.fetch_add(1, std::memory_order_relaxed);
+	totalSum.fetch_add((quint64)qMax(usecs, (qint64)0), std::memory_order_relaxed);
+
+	// single writer, so a plain compare is enough
+	if (usecs < minValue.load(std::memory_order_relaxed))
+		minValue.store(usecs, std::memory_order_relaxed);
+
+	if (usecs > maxValue.load(std::memory_order_relaxed))
+		maxValue.store(usecs, std::memory_order_relaxed);
+}
+
+//---------------------------------------------------------------------------
+qint64 LatencyHistogram::minimum(void) const
+{
+	return count() ? minValue.load(std::memory_order_relaxed) : 0;
+}
+
+//---------------------------------------------------------------------------
+double LatencyHistogram::mean(void) const
+{
+	quint64 n = count();
+
+	return n ? (double)totalSum.load(std::memory_order_relaxed) / (double)n : 0.0;
+}
+
+//---------------------------------------------------------------------------
+qint64 LatencyHistogram::percentile(double percent) const
+{
+	quint64 snapshot[BUCKETS];
+	quint64 total = 0;
+
+	for (int i = 0; i < BUCKETS; i++)
+	{
+		snapshot[i] = counts[i].load(std::memory_order_relaxed);
+		total += snapshot[i];
+	}
+
+	if (total == 0)
+		return 0;
+
+	quint64 target = (quint64)ceil(qBound(0.0, percent, 100.0) / 100.0 * (double)total);
+	quint64 running = 0;
+
+	if (target == 0)
+		target = 1;
+
+	for (int i = 0; i < BUCKETS; i++)
+	{
+		running += snapshot[i];
+
+		if (running >= target)
+			return qMin(bucketUpperBound(i), maximum());
+	}
+
+	return maximum();
+}
+
+//---------------------------------------------------------------------------
+CommStats::CommStats()
+	: queryLatency(new LatencyHistogram[QUERY_STATES]),
+	  queryTimeouts(new std::atomic<quint64>[QUERY_STATES])
+{
+	reset();
+}
+
+//---------------------------------------------------------------------------
+void CommStats::reset(void)
+{
+	for (int i = 0; i < QUERY_STATES; i++)
+	{
+		queryLatency[i].reset();
+		queryTimeouts[i] = 0;
+	}
+
+	for (int i = 0; i < (int)CommandType::COUNT; i++)
+		commandLatency[i].reset();
+
+	allQueryLatency.reset();
+	timeouts = 0;
+	malformedReplies = 0;
+	unsolicitedReplies = 0;
+	commandQueueDepth = 0;
+	maxCommandQueueDepth = 0;
+}
+
+//---------------------------------------------------------------------------
+// Time from the query being written until its reply was received.
+void CommStats::recordQuery(QueryState aState, qint64 usecs)
+{
+	int index = (int)aState;
+
+	if (index >= 0 && index < QUERY_STATES)
+		queryLatency[index].record(usecs);
+
+	allQueryLatency.record(usecs);
+}
+
+//---------------------------------------------------------------------------
+void CommStats::recordTimeout(QueryState aState)
+{
+	int index = (int)aState;
+
+	if (index >= 0 && index < QUERY_STATES)
+		queryTimeouts[index]++;
+
+	timeouts++;
+}
+
+//---------------------------------------------------------------------------
+// Time from the command being queued until it was written.
+void CommStats::recordCommand(const QString &cmd, qint64 usecs)
+{
+	commandLatency[(int)commandType(cmd)].record(usecs);
+}
+
+//---------------------------------------------------------------------------
+void CommStats::setCommandQueueDepth(int depth)
+{
+	commandQueueDepth = depth;
+
+	if (depth > maxCommandQueueDepth)
+		maxCommandQueueDepth = depth;
+}
+
+//---------------------------------------------------------------------------
+const char *CommStats::queryStateName(QueryState aState)
+{
+	int index = (int)aState;
+
+	if (index >= 0 && index < QUERY_STATES)
+		return queryStateNames[index];
+	else
+		return "UNKNOWN";
+}
+
+//---------------------------------------------------------------------------
+const char *CommStats::commandTypeName(CommandType aType)
+{
+	return commandTypeNames[(int)aType];
+}
+
+//---------------------------------------------------------------------------
+CommandType CommStats::commandType(const QString &cmd)
+{
+	QString str = cmd.trimmed().toUpper();
+
+	if (str.startsWith("*"))
+		return CommandType::COMMON;
+	else if (str.startsWith("CONF"))
+		return CommandType::CONFIGURE;
+	else if (str.startsWith("RAMP") || str.startsWith("PAUSE") || str.startsWith("ZERO") ||
+			 str.startsWith("INCR") || str.startsWith("DECR"))
+		return CommandType::RAMP_CONTROL;
+	else if (str.startsWith("PS"))
+		return CommandType::SWITCH_HEATER;
+	else if (str.startsWith("SYST"))
+		return CommandType::SYSTEM;
+	else
+		return CommandType::OTHER;
+}
+
+//---------------------------------------------------------------------------
+// One row per query state or command type that has been used, latencies in ms.
+QString CommStats::report(void) const
+{
+	QString str;
+
+	str += "Timeouts: " + QString::number(getTimeouts()) +
+		"   Malformed replies: " + QString::number(getMalformedReplies()) +
+		"   Unsolicited replies: " + QString::number(getUnsolicitedReplies()) + "\n";
+	str += "Command queue depth: " + QString::number(getCommandQueueDepth()) +
+		" (max " + QString::number(getMaxCommandQueueDepth()) + ")\n\n";
+
+	// latency columns
+	auto row = [](const QString &name, const LatencyHistogram &h)
+	{
+		return QString("%1 %2 %3 %4 %5 %6")
+			.arg(name, -26)
+			.arg(h.count(), 8)
+			.arg(h.mean() / 1000.0, 9, 'f', 2)
+			.arg(h.percentile(50.0) / 1000.0, 9, 'f', 2)
+			.arg(h.percentile(99.0) / 1000.0, 9, 'f', 2)
+			.arg(h.maximum() / 1000.0, 9, 'f', 2);
+	};
+
+	QString heading = QString("%1 %2 %3 %4 %5")
+		.arg(QString("Count"), 8).arg(QString("Mean"), 9).arg(QString("50%"), 9).arg(QString("99%"), 9).arg(QString("Max"), 9);
+
+	str += QString("%1 %2 %3   (ms)\n").arg(QString("Query"), -26).arg(heading).arg(QString("Timeouts"), 9);
+
+	for (int i = 0; i < QUERY_STATES; i++)
+	{
+		if (queryLatency[i].count() || queryTimeouts[i])
+			str += row(queryStateNames[i], queryLatency[i]) + QString(" %1\n").arg(queryTimeouts[i].load(), 9);
+	}
+
+	str += row("All queries", allQueryLatency) + QString(" %1\n").arg(getTimeouts(), 9);
+
+	str += QString("\n%1 %2   (ms)\n").arg(QString("Command, queued to sent"), -26).arg(heading);
+
+	for (int i = 0; i < (int)CommandType::COUNT; i++)
+	{
+		if (commandLatency[i].count())
+			str += row(commandTypeNames[i], commandLatency[i]) + "\n";
+	}
+
+	return str;
+}
+
+//---------------------------------------------------------------------------
+// queries,timeouts,malformed,unsolicited,queue depth,max queue depth,
+// then all-query latency mean,50%,99%,max in microseconds
+QString CommStats::summary(void) const
+{
+	const LatencyHistogram &h = allQueryLatency;
+
+	return QString::number(h.count()) + "," + QString::number(getTimeouts()) + "," +
+		QString::number(getMalformedReplies()) + "," + QString::number(getUnsolicitedReplies()) + "," +
+		QString::number(getCommandQueueDepth()) + "," + QString::number(getMaxCommandQueueDepth()) + "," +
+		QString::number(h.mean(), 'f', 0) + "," + QString::number(h.percentile(50.0)) + "," +
+		QString::number(h.percentile(99.0)) + "," + QString::number(h.maximum());
+}
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,103 @@
+#ifndef COMMSTATS_H
+#define COMMSTATS_H
+
+#include <QString>
+#include <atomic>
+#include <memory>
+#include "model430.h"
+
+//---------------------------------------------------------------------------
+// Log-linear latency histogram in the style of HdrHistogram. Each power of
+// two is split into 16 linear sub-buckets, so any recorded value is within
+// 1/16 (6.25%) of its bucket bound, from 1 us to about 4.5 minutes. One
+// thread records; other threads may read at any time and see a close but
+// not necessarily instantaneous snapshot.
+//---------------------------------------------------------------------------
+class LatencyHistogram
+{
+public:
+	LatencyHistogram();
+
+	void record(qint64 usecs);
+	void reset(void);
+
+	quint64 count(void) const { return totalCount.load(std::memory_order_relaxed); }
+	qint64 minimum(void) const;
+	qint64 maximum(void) const { return maxValue.load(std::memory_order_relaxed); }
+	double mean(void) const;
+	qint64 percentile(double percent) const;	// upper bound of the bucket holding the percentile
+
+private:
+	static const int SUB_BUCKET_BITS = 4;
+	static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+	static const int MAX_VALUE_BITS = 28;
+	static const int BUCKETS = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+	static int bucketIndex(qint64 value);
+	static qint64 bucketUpperBound(int index);
+
+	std::atomic<quint32> counts[BUCKETS];
+	std::atomic<quint64> totalCount;
+	std::atomic<quint64> totalSum;
+	std::atomic<qint64> minValue;
+	std::atomic<qint64> maxValue;
+};
+
+// commands grouped by their SCPI header for latency reporting
+enum class CommandType
+{
+	COMMON = 0,		// *CLS, *ETE, ...
+	CONFIGURE,
+	RAMP_CONTROL,	// RAMP, PAUSE, ZERO, INCR, DECR
+	SWITCH_HEATER,
+	SYSTEM,			// SYST:LOC, SYST:REM, ...
+	OTHER,
+	COUNT
+};
+
+//---------------------------------------------------------------------------
+// Communication instrumentation for one 430 connection. Recorded on the
+// I/O thread; read by the GUI and the stdin parser.
+//---------------------------------------------------------------------------
+class CommStats
+{
+public:
+	CommStats();
+
+	void reset(void);
+	void recordQuery(QueryState aState, qint64 usecs);
+	void recordTimeout(QueryState aState);
+	void recordCommand(const QString &cmd, qint64 usecs);
+	void setCommandQueueDepth(int depth);
+	void recordMalformedReply(void) { malformedReplies++; }
+	void recordUnsolicitedReply(void) { unsolicitedReplies++; }
+
+	quint64 getTimeouts(void) const { return timeouts; }
+	quint64 getMalformedReplies(void) const { return malformedReplies; }
+	quint64 getUnsolicitedReplies(void) const { return unsolicitedReplies; }
+	int getCommandQueueDepth(void) const { return commandQueueDepth; }
+	int getMaxCommandQueueDepth(void) const { return maxCommandQueueDepth; }
+	const LatencyHistogram &allQueries(void) const { return allQueryLatency; }
+
+	QString report(void) const;		// multi-line table for display
+	QString summary(void) const;	// single comma-separated line
+
+	static const char *queryStateName(QueryState aState);
+	static const char *commandTypeName(CommandType aType);
+	static CommandType commandType(const QString &cmd);
+
+private:
+	static const int QUERY_STATES = (int)QueryState::IDLE_STATE + 1;
+
+	std::unique_ptr<LatencyHistogram[]> queryLatency;
+	std::unique_ptr<std::atomic<quint64>[]> queryTimeouts;
+	LatencyHistogram allQueryLatency;
+	LatencyHistogram commandLatency[(int)CommandType::COUNT];
+	std::atomic<quint64> timeouts;
+	std::atomic<quint64> malformedReplies;
+	std::atomic<quint64> unsolicitedReplies;
+	std::atomic<int> commandQueueDepth;
+	std::atomic<int> maxCommandQueueDepth;
+};
+
+#endif // COMMSTATS_H
@@ -0,0 +1,149 @@
+#include "stdafx.h"
+#include "controlserver.h"
+
+
+//---------------------------------------------------------------------------
+ControlServer::ControlServer(Model430 *src, QObject *parent)
+	: QObject(parent)
+{
+	model430 = src;
+	server = new QLocalServer(this);
+	server->setSocketOptions(QLocalServer::UserAccessOption);	// this user's processes only
+
+	connect(server, SIGNAL(newConnection()), this, SLOT(acceptClients()));
+}
+
+//---------------------------------------------------------------------------
+ControlServer::~ControlServer()
+{
+	// the owner resets its subscription count, don't report each client
+	for (auto it = clients.constBegin(); it != clients.constEnd(); ++it)
+	{
+		it.key()->disconnect(this);
+		it.key()->abort();
+	}
+
+	server->close();
+}
+
+//---------------------------------------------------------------------------
+// Starts serving on name, false if that failed or another process serves
+// it already. A socket file left behind by a crashed instance is replaced.
+bool ControlServer::listen(const QString &name)
+{
+	if (server->listen(name))
+		return true;
+
+	if (server->serverError() != QAbstractSocket::AddressInUseError)
+		return false;
+
+	QLocalSocket probe;
+
+	probe.connectToServer(name);
+
+	if (probe.waitForConnected(100))
+		return false;	// in use
+
+	QLocalServer::removeServer(name);
+	return server->listen(name);
+}
+
+//---------------------------------------------------------------------------
+// Writes a sample to the subscribed clients
+void ControlServer::publishSample(const Sample &sample)
+{
+	for (auto it = clients.constBegin(); it != clients.constEnd(); ++it)
+	{
+		// a client that stops reading loses samples rather than our memory
+		if (it.value()->isSubscribed() && it.key()->bytesToWrite() < MAX_BACKLOG)
+			it.value()->publishSample(sample);
+	}
+}
+
+//---------------------------------------------------------------------------
+void ControlServer::addSystemError(QString errMsg)
+{
+	for (Parser *parser : clients)
+		parser->addSystemError(errMsg);
+}
+
+//---------------------------------------------------------------------------
+void ControlServer::acceptClients(void)
+{
+	while (server->hasPendingConnections())
+	{
+		QLocalSocket *client = server->nextPendingConnection();
+		Parser *parser = new Parser(this);
+
+		parser->_setParent(parent());
+		parser->setDataSource(model430);
+		parser->setOutput(client);
+
+		connect(parser, SIGNAL(sendBlockingCommand(QString)), model430->getSocket(), SLOT(sendBlockingCommand(QString)));
+		connect(parser, SIGNAL(configurationChanged(QueryState)), parent(), SLOT(configurationChanged(QueryState)));
+		connect(parser, SIGNAL(error_msg(QString)), parent(), SLOT(parserErrorString(QString)));
+		connect(parser, SIGNAL(exit_app()), client, SLOT(disconnectFromServer()));
+		connect(parser, SIGNAL(subscriptionChanged(bool)), this, SIGNAL(subscriptionChanged(bool)));
+		connect(client, SIGNAL(readyRead()), this, SLOT(readClient()));
+		connect(client, SIGNAL(disconnected()), this, SLOT(dropClient()));
+
+		clients.insert(client, parser);
+		qDebug() << "Magnet-DAQ control client connected," << clients.count() << "connected";
+	}
+}
+
+//---------------------------------------------------------------------------
+// Parses each complete line a client has sent
+void ControlServer::readClient(void)
+{
+	QLocalSocket *client = qobject_cast<QLocalSocket *>(sender());
+	Parser *parser = clients.value(client, nullptr);
+
+	if (parser == nullptr)
+		return;
+
+	char line[MAX_LINE];
+
+	while (client->state() == QLocalSocket::ConnectedState && client->canReadLine())
+	{
+		qint64 length = client->readLine(line, sizeof(line));
+
+		if (length <= 0)
+			break;
+
+		if (line[length - 1] != '\n')
+		{
+			client->abort();	// longer than any command, not a parser client
+			return;
+		}
+
+		line[--length] = '\0';
+
+		if (length > 0 && line[length - 1] == '\r')
+			line[--length] = '\0';
+
+		if (length > 0)
+			parser->parse(line);
+	}
+
+	// no line end in a full buffer
+	if (client->state() == QLocalSocket::ConnectedState && client->bytesAvailable() >= MAX_LINE)
+		client->abort();
+}
+
+//---------------------------------------------------------------------------
+void ControlServer::dropClient(void)
+{
+	QLocalSocket *client = qobject_cast<QLocalSocket *>(sender());
+	Parser *parser = clients.take(client);
+
+	if (parser == nullptr)
+		return;
+
+	if (parser->isSubscribed())
+		emit subscriptionChanged(false);
+
+	parser->deleteLater();
+	client->deleteLater();
+	qDebug() << "Magnet-DAQ control client disconnected," << clients.count() << "connected";
+}
@@ -0,0 +1,53 @@
+#ifndef CONTROLSERVER_H
+#define CONTROLSERVER_H
+
+#include <QObject>
+#include <QHash>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include "parser.h"
+#include "socket.h"
+
+//---------------------------------------------------------------------------
+// Serves the stdin parser command set on a local socket (a named pipe on
+// Windows, a Unix domain socket elsewhere) to any number of clients, e.g.
+// a temperature logger or a measurement script next to the controlling
+// process. Queries are answered from the live state Magnet-DAQ already
+// keeps, so clients never add traffic to the 430; commands go to it over
+// the one existing connection. Each client has its own Parser, with its
+// own error queue and SUBScribe settings. EXIT closes only the client's
+// connection. Lines are newline terminated, as on stdin. GUI thread only.
+//---------------------------------------------------------------------------
+class ControlServer : public QObject
+{
+	Q_OBJECT
+
+public:
+	ControlServer(Model430 *src, QObject *parent);
+	~ControlServer();
+
+	bool listen(const QString &name);
+	QString errorString(void) const { return server->errorString(); }
+	int clientCount(void) const { return clients.count(); }
+
+	void publishSample(const Sample &sample);
+	void addSystemError(QString errMsg);	// device errors, to every client
+
+signals:
+	void subscriptionChanged(bool active);	// per client, as from Parser
+
+private slots:
+	void acceptClients(void);
+	void readClient(void);
+	void dropClient(void);
+
+private:
+	static const int MAX_LINE = 1024;				// as the stdin parser's buffer
+	static const qint64 MAX_BACKLOG = 1048576;		// unsent bytes before samples are skipped
+
+	Model430 *model430;
+	QLocalServer *server;
+	QHash<QLocalSocket *, Parser *> clients;
+};
+
+#endif // CONTROLSERVER_H
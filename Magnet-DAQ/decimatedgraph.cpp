@@ -0,0 +1,480 @@
+#include "stdafx.h"
+#include "decimatedgraph.h"
+#include <cmath>
+#include <limits>
+
+const int POINTS_PER_PIXEL = 4;		// below this the base class draws every sample
+const int RETENTION_SLACK = 8;		// retained samples may exceed the limit by 1/8 before a trim
+
+
+//---------------------------------------------------------------------------
+DecimatedGraph::DecimatedGraph(QCPAxis *keyAxis, QCPAxis *valueAxis)
+	: QCPGraph(keyAxis, valueAxis)
+{
+	retainPoints = 0;
+	retainSpan = 0.0;
+	keepHistory = false;
+	reset();
+}
+
+//---------------------------------------------------------------------------
+DecimatedGraph::Bucket DecimatedGraph::emptyBucket(void)
+{
+	Bucket bucket;
+
+	bucket.firstKey = qQNaN();
+	bucket.minKey = bucket.maxKey = 0.0;
+	bucket.minValue = bucket.maxValue = 0.0;
+	bucket.sum = 0.0;
+	bucket.count = 0;
+
+	return bucket;
+}
+
+//---------------------------------------------------------------------------
+void DecimatedGraph::mergePoint(Bucket &bucket, double key, double value)
+{
+	if (std::isnan(bucket.firstKey))
+		bucket.firstKey = key;
+
+	if (std::isnan(value))
+		return;
+
+	if (!bucket.count || value < bucket.minValue)
+	{
+		bucket.minValue = value;
+		bucket.minKey = key;
+	}
+
+	if (!bucket.count || value > bucket.maxValue)
+	{
+		bucket.maxValue = value;
+		bucket.maxKey = key;
+	}
+
+	bucket.sum += value;
+	bucket.count++;
+}
+
+//---------------------------------------------------------------------------
+void DecimatedGraph::mergeBucket(Bucket &bucket, const Bucket &from)
+{
+	if (std::isnan(bucket.firstKey))
+		bucket.firstKey = from.firstKey;
+
+	if (!from.count)
+		return;
+
+	if (!bucket.count || from.minValue < bucket.minValue)
+	{
+		bucket.minValue = from.minValue;
+		bucket.minKey = from.minKey;
+	}
+
+	if (!bucket.count || from.maxValue > bucket.maxValue)
+	{
+		bucket.maxValue = from.maxValue;
+		bucket.maxKey = from.maxKey;
+	}
+
+	bucket.sum += from.sum;
+	bucket.count += from.count;
+}
+
+//---------------------------------------------------------------------------
+void DecimatedGraph::reset(void) const
+{
+	levels.clear();
+	levels.resize(1);
+	levelBase.fill(0, 1);
+	origin = 0;
+	consumed = 0;
+	firstKey = 0.0;
+	lastKey = 0.0;
+
+	// history of data that is gone
+	history.clear();
+	historySpan = 1;
+	historyFill = 0;
+}
+
+//---------------------------------------------------------------------------
+// Brings the pyramid up to date with the data container. Appending is the
+// common case and only costs the new samples.
+void DecimatedGraph::sync(void) const
+{
+	int size = mDataContainer->size();
+	int synced = int(consumed - origin);
+
+	if (synced > size || (synced && (mDataContainer->constBegin()->key != firstKey ||
+		mDataContainer->at(synced - 1)->key != lastKey)))
+	{
+		reset();
+		synced = 0;
+	}
+
+	for (QCPGraphDataContainer::const_iterator it = mDataContainer->constBegin() + synced; synced < size; ++it, ++synced)
+		addPoint(*it);
+
+	if (consumed)
+	{
+		firstKey = mDataContainer->constBegin()->key;
+		lastKey = (mDataContainer->constEnd() - 1)->key;
+	}
+}
+
+//---------------------------------------------------------------------------
+// Adds the next sample to one bucket of each level; a level is added on
+// top once the highest one has two buckets.
+void DecimatedGraph::addPoint(const QCPGraphData &point) const
+{
+	qint64 index = consumed++;
+
+	for (int k = 0; ; k++)
+	{
+		index /= FAN_OUT;
+
+		if (k == levels.size())
+		{
+			const QVector<Bucket> &below = levels[k - 1];
+			qint64 belowBase = levelBase[k - 1];
+
+			if (below.size() <= 1)
+				break;
+
+			// already holds this sample through the level below
+			qint64 base = belowBase / FAN_OUT;
+			QVector<Bucket> top(int((belowBase + below.size() - 1) / FAN_OUT - base + 1), emptyBucket());
+
+			for (int i = 0; i < below.size(); i++)
+				mergeBucket(top[int((belowBase + i) / FAN_OUT - base)], below[i]);
+
+			levels.append(top);
+			levelBase.append(base);
+			break;
+		}
+
+		QVector<Bucket> &level = levels[k];
+
+		if (index - levelBase[k] == level.size())
+			level.append(emptyBucket());
+
+		mergePoint(level[int(index - levelBase[k])], point.key, point.value);
+	}
+}
+
+//---------------------------------------------------------------------------
+// Summary of samples [begin, end), from the largest aligned buckets that fit.
+DecimatedGraph::Bucket DecimatedGraph::query(int begin, int end) const
+{
+	Bucket result = emptyBucket();
+	QCPGraphDataContainer::const_iterator data = mDataContainer->constBegin();
+	qint64 i = origin + begin;
+
+	while (i < origin + end)
+	{
+		qint64 span = 1;
+		int level = -1;
+
+		while (level + 1 < levels.size() && i % (span * FAN_OUT) == 0 && i + span * FAN_OUT <= origin + end)
+		{
+			span *= FAN_OUT;
+			level++;
+		}
+
+		if (level < 0)
+			mergePoint(result, (data + (i - origin))->key, (data + (i - origin))->value);
+		else
+			mergeBucket(result, levels[level][int(i / span - levelBase[level])]);
+
+		i += span;
+	}
+
+	return result;
+}
+
+//---------------------------------------------------------------------------
+bool DecimatedGraph::summarize(const QCPRange &keyRange, double &min, double &max, double &mean) const
+{
+	sync();
+
+	QCPGraphDataContainer::const_iterator begin = mDataContainer->findBegin(keyRange.lower, false);
+	QCPGraphDataContainer::const_iterator end = mDataContainer->findEnd(keyRange.upper, false);
+	Bucket summary = query(int(begin - mDataContainer->constBegin()), int(end - mDataContainer->constBegin()));
+
+	if (!summary.count)
+		return false;
+
+	min = summary.minValue;
+	max = summary.maxValue;
+	mean = summary.sum / summary.count;
+
+	return true;
+}
+
+//---------------------------------------------------------------------------
+QCPRange DecimatedGraph::getValueRange(bool &foundRange, QCP::SignDomain inSignDomain, const QCPRange &inKeyRange) const
+{
+	// sign-restricted ranges need every value, leave those to the base class
+	if (inSignDomain != QCP::sdBoth)
+		return QCPGraph::getValueRange(foundRange, inSignDomain, inKeyRange);
+
+	double min, max, mean;
+	QCPRange keyRange = inKeyRange;
+
+	if (inKeyRange == QCPRange())
+		keyRange = QCPRange(-std::numeric_limits<double>::max(), std::numeric_limits<double>::max());
+
+	foundRange = summarize(keyRange, min, max, mean);
+
+	return foundRange ? QCPRange(min, max) : QCPRange();
+}
+
+//---------------------------------------------------------------------------
+void DecimatedGraph::getOptimizedLineData(QVector<QCPGraphData> *lineData, const QCPGraphDataContainer::const_iterator &begin, const QCPGraphDataContainer::const_iterator &end) const
+{
+	QCPAxis *keyAxis = mKeyAxis.data();
+
+	if (!lineData || !keyAxis || begin == end || !mAdaptiveSampling)
+	{
+		QCPGraph::getOptimizedLineData(lineData, begin, end);
+		return;
+	}
+
+	int dataCount = int(end - begin);
+	double keyPixelSpan = qAbs(keyAxis->coordToPixel(begin->key) - keyAxis->coordToPixel((end - 1)->key));
+	double maxBuckets = 2.0 * keyPixelSpan + 2.0;
+
+	if (dataCount < POINTS_PER_PIXEL * maxBuckets)
+	{
+		QCPGraph::getOptimizedLineData(lineData, begin, end);
+		return;
+	}
+
+	sync();
+
+	// coarsest level needed for about two buckets per pixel
+	int level = 0;
+	qint64 span = FAN_OUT;
+
+	while (dataCount / span > maxBuckets && level + 1 < levels.size())
+	{
+		span *= FAN_OUT;
+		level++;
+	}
+
+	// the first bucket may still hold some samples dropped by retention
+	const QVector<Bucket> &buckets = levels[level];
+	int first = int((origin + (begin - mDataContainer->constBegin())) / span - levelBase[level]);
+	int last = qMin(int((origin + (end - mDataContainer->constBegin()) - 1) / span - levelBase[level]), buckets.size() - 1);
+
+	first = qMax(first, 0);
+
+	lineData->clear();
+	lineData->reserve(2 * (last - first + 1));
+
+	// each bucket's min and max in key order, a NaN point for a gap
+	for (int i = first; i <= last; i++)
+	{
+		const Bucket &bucket = buckets[i];
+
+		if (!bucket.count)
+		{
+			lineData->append(QCPGraphData(bucket.firstKey, qQNaN()));
+		}
+		else if (bucket.minKey < bucket.maxKey)
+		{
+			lineData->append(QCPGraphData(bucket.minKey, bucket.minValue));
+			lineData->append(QCPGraphData(bucket.maxKey, bucket.maxValue));
+		}
+		else if (bucket.minKey > bucket.maxKey)
+		{
+			lineData->append(QCPGraphData(bucket.maxKey, bucket.maxValue));
+			lineData->append(QCPGraphData(bucket.minKey, bucket.minValue));
+		}
+		else
+		{
+			lineData->append(QCPGraphData(bucket.minKey, bucket.minValue));
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// Dropped samples beyond the retention limits. Waits for a batch, so the
+// container trims its storage rarely and the pyramid drops whole buckets.
+void DecimatedGraph::setRetention(int maxPoints, double keySpan, bool keepHistory)
+{
+	retainPoints = qMax(maxPoints, 0);
+	retainSpan = qMax(keySpan, 0.0);
+	this->keepHistory = keepHistory;
+
+	if (!keepHistory)
+		clearHistory();
+}
+
+//---------------------------------------------------------------------------
+void DecimatedGraph::applyRetention(void)
+{
+	int size = mDataContainer->size();
+	int drop = 0;
+
+	if (!size)
+		return;
+
+	if (retainPoints && size > retainPoints + retainPoints / RETENTION_SLACK)
+		drop = size - retainPoints;
+
+	if (retainSpan > 0.0)
+	{
+		double cutoff = (mDataContainer->constEnd() - 1)->key - retainSpan;
+		int older = int(mDataContainer->findBegin(cutoff, false) - mDataContainer->constBegin());
+
+		if (older > size / RETENTION_SLACK)
+			drop = qMax(drop, older);
+	}
+
+	if (!drop)
+		return;
+
+	// removeBefore() goes by key, so demote exactly the samples before that
+	// key; duplicates of it stay in the live tier
+	double boundary = (mDataContainer->constBegin() + drop)->key;
+
+	drop = int(mDataContainer->findBegin(boundary, false) - mDataContainer->constBegin());
+
+	if (!drop)
+		return;
+
+	sync();
+
+	if (keepHistory)
+		demote(drop);
+
+	mDataContainer->removeBefore(boundary);
+
+	int removed = size - mDataContainer->size();
+
+	origin += removed;
+
+	if (mDataContainer->isEmpty())
+	{
+		reset();
+		return;
+	}
+
+	firstKey = mDataContainer->constBegin()->key;
+
+	// buckets wholly before the first sample go too
+	qint64 span = FAN_OUT;
+
+	for (int k = 0; k < levels.size(); k++, span *= FAN_OUT)
+	{
+		int stale = int(qMin(origin / span - levelBase[k], (qint64)levels[k].size()));
+
+		if (stale > 0)
+		{
+			levels[k].remove(0, stale);
+			levelBase[k] += stale;
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+void DecimatedGraph::clearHistory(void)
+{
+	history.clear();
+	historySpan = 1;
+	historyFill = 0;
+}
+
+//---------------------------------------------------------------------------
+// Moves the oldest samples into the history tier, halving its resolution
+// whenever it fills.
+void DecimatedGraph::demote(int count)
+{
+	QCPGraphDataContainer::const_iterator it = mDataContainer->constBegin();
+
+	for (int i = 0; i < count; i++, ++it)
+	{
+		if (history.isEmpty() || historyFill >= historySpan)
+		{
+			if (history.size() >= HISTORY_BUCKETS)
+			{
+				for (int j = 0; j < history.size() / 2; j++)
+				{
+					Bucket merged = history[2 * j];
+
+					mergeBucket(merged, history[2 * j + 1]);
+					history[j] = merged;
+				}
+
+				history.resize(history.size() / 2);
+				historySpan *= 2;
+			}
+
+			if (history.isEmpty() || historyFill >= historySpan)
+			{
+				history.append(emptyBucket());
+				historyFill = 0;
+			}
+		}
+
+		mergePoint(history.last(), it->key, it->value);
+		historyFill++;
+	}
+}
+
+//---------------------------------------------------------------------------
+// The history tier is drawn below the retained data, joined to its first
+// sample.
+void DecimatedGraph::draw(QCPPainter *painter)
+{
+	QCPAxis *keyAxis = mKeyAxis.data();
+
+	if (!history.isEmpty() && keyAxis && mLineStyle != lsNone)
+	{
+		QCPRange range = keyAxis->range();
+		QVector<QPointF> lines;
+
+		lines.reserve(2 * history.size() + 1);
+
+		for (int i = 0; i < history.size(); i++)
+		{
+			const Bucket &bucket = history[i];
+			bool last = (i + 1 == history.size());
+
+			// only the visible buckets, and one either side
+			if (!last && history[i + 1].firstKey < range.lower)
+				continue;
+
+			if (i && history[i - 1].firstKey > range.upper)
+				break;
+
+			if (!bucket.count)
+			{
+				lines.append(QPointF(qQNaN(), qQNaN()));
+			}
+			else if (bucket.minKey <= bucket.maxKey)
+			{
+				lines.append(coordsToPixels(bucket.minKey, bucket.minValue));
+				lines.append(coordsToPixels(bucket.maxKey, bucket.maxValue));
+			}
+			else
+			{
+				lines.append(coordsToPixels(bucket.maxKey, bucket.maxValue));
+				lines.append(coordsToPixels(bucket.minKey, bucket.minValue));
+			}
+		}
+
+		if (!mDataContainer->isEmpty())
+			lines.append(coordsToPixels(mDataContainer->constBegin()->key, mDataContainer->constBegin()->value));
+
+		painter->setPen(mPen);
+		painter->setBrush(Qt::NoBrush);
+		drawLinePlot(painter, lines);
+	}
+
+	QCPGraph::draw(painter);
+}
+
+//---------------------------------------------------------------------------
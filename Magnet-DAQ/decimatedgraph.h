@@ -0,0 +1,90 @@
+#ifndef DECIMATEDGRAPH_H
+#define DECIMATEDGRAPH_H
+
+#if defined(Q_OS_LINUX) || defined(Q_OS_MACOS)
+#include "qcustomplot.h"
+#else
+#include <QCustomPlot/qcp.h>
+#endif
+
+//---------------------------------------------------------------------------
+// A graph for long time series. Alongside its data it keeps a pyramid of
+// min/max/mean buckets: level 0 summarizes FAN_OUT samples, each level
+// above FAN_OUT buckets of the one below. When a view holds many samples
+// per pixel the line is drawn from the coarsest level that still has about
+// two buckets per pixel, as the min and max of each bucket, so any zoom
+// level renders from a few thousand points. Value ranges (autoscaling) are
+// answered from the pyramid as well.
+//
+// The pyramid catches up with samples appended to data() when it is next
+// used, and is rebuilt if the data was changed in any other way.
+//
+// With a retention policy applyRetention() drops the oldest samples past a
+// point count or key span, in batches so the data container reuses its
+// storage. Dropped samples can be kept in a history tier of at most
+// HISTORY_BUCKETS min/max buckets, halving its resolution as it fills, so
+// memory stays flat however long the graph runs. The history is drawn
+// but not part of data(). GUI thread only.
+//---------------------------------------------------------------------------
+class DecimatedGraph : public QCPGraph
+{
+public:
+	DecimatedGraph(QCPAxis *keyAxis, QCPAxis *valueAxis);
+
+	// 0 disables either limit; keySpan is in key (timebase) units
+	void setRetention(int maxPoints, double keySpan, bool keepHistory);
+	void applyRetention(void);	// after adding data
+	void clearHistory(void);
+
+	// min, max and mean of the values in keyRange, false if there are none
+	bool summarize(const QCPRange &keyRange, double &min, double &max, double &mean) const;
+
+	QCPRange getValueRange(bool &foundRange, QCP::SignDomain inSignDomain = QCP::sdBoth, const QCPRange &inKeyRange = QCPRange()) const override;
+
+protected:
+	void draw(QCPPainter *painter) override;
+	void getOptimizedLineData(QVector<QCPGraphData> *lineData, const QCPGraphDataContainer::const_iterator &begin, const QCPGraphDataContainer::const_iterator &end) const override;
+
+private:
+	static const int FAN_OUT = 8;
+	static const int HISTORY_BUCKETS = 4096;
+
+	struct Bucket
+	{
+		double firstKey;	// NaN while empty
+		double minKey;		// key of the minimum
+		double maxKey;		// key of the maximum
+		double minValue;
+		double maxValue;
+		double sum;
+		int count;			// values, NaN (gaps) excluded
+	};
+
+	static Bucket emptyBucket(void);
+	static void mergePoint(Bucket &bucket, double key, double value);
+	static void mergeBucket(Bucket &bucket, const Bucket &from);
+
+	void sync(void) const;
+	void reset(void) const;
+	void addPoint(const QCPGraphData &point) const;
+	Bucket query(int begin, int end) const;
+	void demote(int count);
+
+	// pyramid, bucket indices count samples since the last reset
+	mutable QVector<QVector<Bucket>> levels;
+	mutable QVector<qint64> levelBase;	// index of each level's first bucket
+	mutable qint64 origin;		// index of the first sample in data()
+	mutable qint64 consumed;	// index after the last sample in the pyramid
+	mutable double firstKey;	// of the samples in the pyramid, to notice changes
+	mutable double lastKey;
+
+	// retention
+	int retainPoints;
+	double retainSpan;
+	bool keepHistory;
+	mutable QVector<Bucket> history;	// dropped samples, oldest first
+	mutable int historySpan;	// samples per history bucket
+	mutable int historyFill;	// samples in the last history bucket
+};
+
+#endif // DECIMATEDGRAPH_H
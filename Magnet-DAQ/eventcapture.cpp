@@ -0,0 +1,214 @@
+#include "stdafx.h"
+#include "eventcapture.h"
+#include "model430.h"
+#include <QtConcurrent>
+
+
+//---------------------------------------------------------------------------
+EventCapture::EventCapture(QObject *parent)
+	: QObject(parent)
+{
+	enabled = false;
+	preWindow = 10000;
+	postWindow = 10000;
+	voltageThreshold = 0.0;
+	ring.resize(BUFFER_SIZE);
+	ringHead = 0;
+	ringCount = 0;
+	lastState = 0;
+	overThreshold = false;
+	capturing = false;
+	triggerTime = 0;
+}
+
+//---------------------------------------------------------------------------
+void EventCapture::setWindows(int preMsecs, int postMsecs)
+{
+	preWindow = qMax(preMsecs, 0);
+	postWindow = qMax(postMsecs, 0);
+}
+
+//---------------------------------------------------------------------------
+void EventCapture::addSample(const Sample &sample, double timebase, LogLayout layout, bool heater)
+{
+	if (!enabled)
+		return;
+
+	CaptureSample entry;
+
+	entry.sample = sample;
+	entry.timebase = timebase;
+	entry.layout = layout;
+	entry.heater = heater;
+
+	// oldest sample is overwritten once the ring is full
+	ring[(ringHead + ringCount) % BUFFER_SIZE] = entry;
+
+	if (ringCount < BUFFER_SIZE)
+		ringCount++;
+	else
+		ringHead = (ringHead + 1) % BUFFER_SIZE;
+
+	if (capturing)
+	{
+		capture.append(entry);
+
+		if (sample.time >= triggerTime + postWindow)
+			finishCapture();
+	}
+
+	if (sample.stale)
+		return;
+
+	// triggers on the rising edge only (state is only reported by *AMITRG)
+	if (State(sample.state) == State::QUENCH && State(lastState) != State::QUENCH)
+		trigger("quench");
+
+	lastState = sample.state;
+
+	if (voltageThreshold > 0.0)
+	{
+		bool over = qAbs(sample.magnetVoltage) >= voltageThreshold;
+
+		if (over && !overThreshold)
+			trigger("magnet voltage " + QString::number(sample.magnetVoltage, 'g', 4) + " V");
+
+		overThreshold = over;
+	}
+}
+
+//---------------------------------------------------------------------------
+// A trigger during a capture is noted in the same capture.
+void EventCapture::trigger(const QString &reason)
+{
+	if (!enabled || !ringCount)
+		return;
+
+	if (capturing)
+	{
+		if (!triggerReasons.contains(reason))
+			triggerReasons += ", " + reason;
+
+		return;
+	}
+
+	const CaptureSample &newest = ring[(ringHead + ringCount - 1) % BUFFER_SIZE];
+
+	capturing = true;
+	triggerTime = newest.sample.time;
+	triggerReasons = reason;
+	capture.clear();
+
+	// pre-trigger window, including the sample that triggered
+	for (int i = 0; i < ringCount; i++)
+	{
+		const CaptureSample &entry = ring[(ringHead + i) % BUFFER_SIZE];
+
+		if (entry.sample.time >= triggerTime - preWindow)
+			capture.append(entry);
+	}
+
+	emit rateBoost(true);
+}
+
+//---------------------------------------------------------------------------
+void EventCapture::reset(void)
+{
+	if (capturing)
+		finishCapture();
+
+	ringHead = 0;
+	ringCount = 0;
+	lastState = 0;
+	overThreshold = false;
+}
+
+//---------------------------------------------------------------------------
+void EventCapture::finishCapture(void)
+{
+	QString stamp = QDateTime::fromMSecsSinceEpoch(triggerTime).toString("yyyyMMdd-HHmmss");
+	QString fileName = fileStem + "_event_" + stamp + ".csv";
+	QString title = "Event: " + triggerReasons + " at " + QDateTime::fromMSecsSinceEpoch(triggerTime).toString("MM/dd/yyyy: hh:mm:ss.zzz ap") +
+		", " + QString::number(preWindow / 1000.0) + " sec before, " + QString::number(postWindow / 1000.0) + " sec after";
+
+	capturing = false;
+	emit rateBoost(false);
+
+	// reserve the name now, creating the file is atomic where a check isn't
+	QFile file(fileName);
+
+	for (int i = 2; !file.open(QFile::WriteOnly | QFile::NewOnly); i++)
+	{
+		if (!file.exists() || i > MAX_NAME_TRIES)
+		{
+			qDebug() << "Event capture file open failed: " << file.errorString();
+			capture.clear();
+			return;
+		}
+
+		fileName = fileStem + "_event_" + stamp + "-" + QString::number(i) + ".csv";
+		file.setFileName(fileName);
+	}
+
+	file.close();
+
+	// reported once the file is written
+	QFutureWatcher<QString> *watcher = new QFutureWatcher<QString>(this);
+
+	connect(watcher, SIGNAL(finished()), this, SLOT(captureWritten()));
+	watcher->setFuture(QtConcurrent::run(&EventCapture::writeCapture, fileName, title, columnHeader, capture));
+	capture.clear();
+}
+
+//---------------------------------------------------------------------------
+void EventCapture::captureWritten(void)
+{
+	QFutureWatcher<QString> *watcher = static_cast<QFutureWatcher<QString> *>(sender());
+	QString fileName = watcher->result();
+
+	watcher->deleteLater();
+
+	if (!fileName.isEmpty())
+		emit captureSaved(fileName);
+}
+
+//---------------------------------------------------------------------------
+// Thread pool: writes one capture file in the data log CSV layout. Returns
+// the file name, empty if writing failed.
+QString EventCapture::writeCapture(QString fileName, QString title, QString header, QVector<CaptureSample> samples)
+{
+	QFile file(fileName);
+
+	if (!file.open(QFile::WriteOnly | QFile::Truncate))
+	{
+		qDebug() << "Event capture file open failed: " << file.errorString();
+		return QString();
+	}
+
+	QByteArray text = (title + "\n" + header + "\n").toLocal8Bit();
+	int offset = text.size();
+
+	text.resize(offset + samples.size() * LogWriter::MAX_LINE_LENGTH);
+
+	for (const CaptureSample &entry : samples)
+	{
+		offset += LogWriter::formatSample(entry.sample, entry.timebase, entry.layout, entry.heater,
+			text.data() + offset, text.data() + offset + LogWriter::MAX_LINE_LENGTH);
+	}
+
+	text.truncate(offset);
+
+	bool written = file.write(text) == text.size();
+
+	file.close();
+
+	if (!written || file.error() != QFile::NoError)
+	{
+		qDebug() << "Event capture file write failed: " << file.errorString();
+		return QString();
+	}
+
+	return fileName;
+}
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,81 @@
+#ifndef EVENTCAPTURE_H
+#define EVENTCAPTURE_H
+
+#include <QObject>
+#include <QVector>
+#include "socket.h"
+#include "logwriter.h"
+
+//---------------------------------------------------------------------------
+// Captures the samples around a quench, an external rampdown or a magnet
+// voltage excursion into a separate CSV file, one file per event. Every
+// sample goes through a bounded ring holding the pre-trigger window; on a
+// trigger the capture continues for the post-trigger window while
+// acquisition is boosted to the fastest rate the 430 sustains
+// (rateBoost signal). The file is named and created at once, then written
+// on the global thread pool.
+// GUI thread only.
+//---------------------------------------------------------------------------
+class EventCapture : public QObject
+{
+	Q_OBJECT
+
+public:
+	EventCapture(QObject *parent = Q_NULLPTR);
+
+	void setEnabled(bool enable) { enabled = enable; }
+	bool isEnabled(void) const { return enabled; }
+	void setWindows(int preMsecs, int postMsecs);
+	void setVoltageThreshold(double volts) { voltageThreshold = qAbs(volts); }	// 0 disables
+	void setFileStem(const QString &stem) { fileStem = stem; }	// path and name prefix of capture files
+	void setColumnHeader(const QString &header) { columnHeader = header; }
+	bool isCapturing(void) const { return capturing; }
+
+	void addSample(const Sample &sample, double timebase, LogLayout layout, bool heater);
+	void trigger(const QString &reason);
+	void reset(void);	// saves a capture in progress, then empties the buffer
+
+signals:
+	void rateBoost(bool active);
+	void captureSaved(QString fileName);	// once the file is written
+
+private slots:
+	void captureWritten(void);
+
+private:
+	static const int BUFFER_SIZE = 16384;	// samples, pre-trigger at up to ~200 Hz
+	static const int MAX_NAME_TRIES = 100;	// events within the same second
+
+	struct CaptureSample
+	{
+		Sample sample;
+		double timebase;
+		LogLayout layout;
+		bool heater;
+	};
+
+	void finishCapture(void);
+	static QString writeCapture(QString fileName, QString title, QString header, QVector<CaptureSample> samples);
+
+	bool enabled;
+	int preWindow;			// ms
+	int postWindow;			// ms
+	double voltageThreshold;
+	QString fileStem;
+	QString columnHeader;
+
+	// pre-trigger ring
+	QVector<CaptureSample> ring;
+	int ringHead;
+	int ringCount;
+
+	// trigger state
+	quint8 lastState;
+	bool overThreshold;
+	bool capturing;
+	qint64 triggerTime;		// ms, sample time
+	QString triggerReasons;
+	QVector<CaptureSample> capture;
+};
+
+#endif // EVENTCAPTURE_H
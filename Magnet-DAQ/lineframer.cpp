@@ -0,0 +1,81 @@
+#include "stdafx.h"
+#include "lineframer.h"
+
+// consumed bytes are compacted away once there are at least this many
+const int COMPACT_THRESHOLD = 4096;
+
+//---------------------------------------------------------------------------
+LineFramer::LineFramer()
+{
+	clear();
+}
+
+//---------------------------------------------------------------------------
+void LineFramer::append(const QByteArray &data)
+{
+	buffer.append(data);
+}
+
+//---------------------------------------------------------------------------
+// Returns the length of the next complete record including its terminator,
+// or 0 if the record has not been completely received. The record remains
+// in the buffer until consumed.
+int LineFramer::nextRecord(bool multiLine)
+{
+	const char *terminator = multiLine ? "\r\n\r\n" : "\r\n";
+	int terminatorLength = multiLine ? 4 : 2;
+
+	// a scan for the other terminator type tells us nothing
+	if (multiLine != scanMultiLine)
+	{
+		scanPos = readPos;
+		scanMultiLine = multiLine;
+	}
+
+	// back up in case a terminator was split across reads
+	int from = qMax(readPos, scanPos - (terminatorLength - 1));
+	int index = buffer.indexOf(terminator, from);
+
+	if (index < 0)
+	{
+		scanPos = buffer.size();
+		return 0;
+	}
+
+	scanPos = index;
+
+	return index + terminatorLength - readPos;
+}
+
+//---------------------------------------------------------------------------
+void LineFramer::consume(int length)
+{
+	readPos = qMin(readPos + length, buffer.size());
+	scanPos = qMax(scanPos, readPos);
+
+	if (readPos == buffer.size())
+	{
+		// everything consumed, reuse the allocation
+		buffer.truncate(0);
+		readPos = 0;
+		scanPos = 0;
+	}
+	else if (readPos >= COMPACT_THRESHOLD && readPos >= buffer.size() / 2)
+	{
+		// only an occasional move of the partial record, linear overall
+		buffer.remove(0, readPos);
+		scanPos -= readPos;
+		readPos = 0;
+	}
+}
+
+//---------------------------------------------------------------------------
+void LineFramer::clear(void)
+{
+	buffer.truncate(0);
+	readPos = 0;
+	scanPos = 0;
+	scanMultiLine = false;
+}
+
+//---------------------------------------------------------------------------
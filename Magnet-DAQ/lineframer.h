@@ -0,0 +1,32 @@
+#ifndef LINEFRAMER_H
+#define LINEFRAMER_H
+
+#include <QByteArray>
+
+//---------------------------------------------------------------------------
+// Incremental framing of the 430 reply stream. Received data is appended as
+// it arrives, in whatever pieces TCP delivers it, and complete records are
+// taken from the front. A record ends with <CR><LF>, or with two contiguous
+// <CR><LF> pairs for multi-line replies (extended queries). Bytes already
+// searched for a terminator are not searched again when more data arrives.
+//---------------------------------------------------------------------------
+class LineFramer
+{
+public:
+	LineFramer();
+
+	void append(const QByteArray &data);
+	int nextRecord(bool multiLine);		// length of next complete record, 0 if none yet
+	const char *record(void) const { return buffer.constData() + readPos; }
+	void consume(int length);
+	void clear(void);
+	bool isEmpty(void) const { return readPos == buffer.size(); }
+
+private:
+	QByteArray buffer;
+	int readPos;		// start of the unconsumed data
+	int scanPos;		// no terminator starts before this position
+	bool scanMultiLine;	// terminator type scanPos applies to
+};
+
+#endif // LINEFRAMER_H
@@ -0,0 +1,210 @@
+#include "stdafx.h"
+#include "logcompressor.h"
+#include <cmath>
+#include <limits>
+
+static const char *channelNames[LogCompressor::CHANNELS] =
+{
+	"field", "current", "voltage", "supply current", "supply voltage", "ref current"
+};
+
+
+//---------------------------------------------------------------------------
+LogCompressor::LogCompressor()
+{
+	mode = OFF;
+	maxInterval = 60000;
+	anchored = false;
+	previousKept = false;
+
+	for (int i = 0; i < CHANNELS; i++)
+	{
+		bound[i] = 0.0;
+		slopeLow[i] = -std::numeric_limits<double>::infinity();
+		slopeHigh[i] = std::numeric_limits<double>::infinity();
+	}
+}
+
+//---------------------------------------------------------------------------
+void LogCompressor::setPolicy(Mode mode, const double *bounds, int maxIntervalMsecs)
+{
+	this->mode = mode;
+
+	for (int i = 0; i < CHANNELS; i++)
+		bound[i] = qAbs(bounds[i]);
+
+	maxInterval = qMax(maxIntervalMsecs, 0);	// 0 for none
+	reset();
+}
+
+//---------------------------------------------------------------------------
+QString LogCompressor::description(void) const
+{
+	if (mode == OFF)
+		return "none";
+
+	QString text = (mode == DEADBAND) ? "deadband" : "swinging door";
+
+	text += ", max interval " + QString::number(maxInterval / 1000.0) + " sec, bounds";
+
+	for (int i = 0; i < CHANNELS; i++)
+		text += QString(i ? "; " : " ") + channelNames[i] + " " + QString::number(bound[i], 'g', 6);
+
+	return text;
+}
+
+//---------------------------------------------------------------------------
+void LogCompressor::reset(void)
+{
+	anchored = false;
+	previousKept = false;
+}
+
+//---------------------------------------------------------------------------
+// Returns STORE_PREVIOUS and/or STORE_SAMPLE, or 0 to hold the sample. A
+// held sample is only needed again if the next offer asks for it.
+int LogCompressor::offer(const Sample &sample)
+{
+	int decision = 0;
+
+	if (mode == OFF || !anchored)
+	{
+		anchorAt(sample);
+		previous = sample;
+		previousKept = true;
+		return STORE_SAMPLE;
+	}
+
+	// end the old run at its last sample and start the new one here
+	if (discreteChange(previous, sample))
+	{
+		decision = (previousKept ? 0 : STORE_PREVIOUS) | STORE_SAMPLE;
+		anchorAt(sample);
+		previous = sample;
+		previousKept = true;
+		return decision;
+	}
+
+	if (mode == DEADBAND)
+	{
+		bool moved = false;
+
+		for (int i = 0; i < CHANNELS && !moved; i++)
+			moved = !(qAbs(channelValue(sample, i) - channelValue(anchor, i)) <= bound[i]);	// NaN counts as moved
+
+		previous = sample;
+		previousKept = moved || (maxInterval && sample.time - anchor.time >= maxInterval);
+
+		if (previousKept)
+		{
+			anchorAt(sample);
+			return STORE_SAMPLE;
+		}
+
+		return 0;
+	}
+
+	// swinging door: the previous sample's line was checked, so it becomes
+	// the anchor when this sample's line no longer fits
+	if (!lineFits(sample))
+	{
+		if (!previousKept)
+			decision = STORE_PREVIOUS;
+
+		anchorAt(previous);
+	}
+
+	previous = sample;
+	previousKept = maxInterval && sample.time - anchor.time >= maxInterval;
+
+	if (previousKept)
+	{
+		anchorAt(sample);
+		return decision | STORE_SAMPLE;
+	}
+
+	narrowDoor(sample);
+
+	return decision;
+}
+
+//---------------------------------------------------------------------------
+double LogCompressor::channelValue(const Sample &sample, int channel)
+{
+	switch (channel)
+	{
+		case FIELD:				return sample.magnetField;
+		case CURRENT:			return sample.magnetCurrent;
+		case VOLTAGE:			return sample.magnetVoltage;
+		case SUPPLY_CURRENT:	return sample.supplyCurrent;
+		case SUPPLY_VOLTAGE:	return sample.supplyVoltage;
+		default:				return sample.refCurrent;
+	}
+}
+
+//---------------------------------------------------------------------------
+bool LogCompressor::discreteChange(const Sample &a, const Sample &b) const
+{
+	return a.state != b.state || a.heater != b.heater || a.stale != b.stale;
+}
+
+//---------------------------------------------------------------------------
+void LogCompressor::anchorAt(const Sample &sample)
+{
+	anchor = sample;
+	anchored = true;
+
+	for (int i = 0; i < CHANNELS; i++)
+	{
+		slopeLow[i] = -std::numeric_limits<double>::infinity();
+		slopeHigh[i] = std::numeric_limits<double>::infinity();
+	}
+}
+
+//---------------------------------------------------------------------------
+// Does the line from the anchor to this sample stay within every bound of
+// the samples since the anchor? Slopes are per microsecond of acquisition
+// time, which is finer than the logged Unix time.
+bool LogCompressor::lineFits(const Sample &sample) const
+{
+	double dt = (double)(sample.midpointTime - anchor.midpointTime);
+
+	for (int i = 0; i < CHANNELS; i++)
+	{
+		double dv = channelValue(sample, i) - channelValue(anchor, i);
+
+		if (dt <= 0.0)
+		{
+			if (!(qAbs(dv) <= bound[i]))
+				return false;
+		}
+		else
+		{
+			double slope = dv / dt;
+
+			if (!(slope >= slopeLow[i] && slope <= slopeHigh[i]))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+//---------------------------------------------------------------------------
+void LogCompressor::narrowDoor(const Sample &sample)
+{
+	double dt = (double)(sample.midpointTime - anchor.midpointTime);
+
+	if (dt <= 0.0)
+		return;
+
+	for (int i = 0; i < CHANNELS; i++)
+	{
+		double dv = channelValue(sample, i) - channelValue(anchor, i);
+
+		slopeLow[i] = qMax(slopeLow[i], (dv - bound[i]) / dt);
+		slopeHigh[i] = qMin(slopeHigh[i], (dv + bound[i]) / dt);
+	}
+}
+
+//---------------------------------------------------------------------------
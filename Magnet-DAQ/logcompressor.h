@@ -0,0 +1,75 @@
+#ifndef LOGCOMPRESSOR_H
+#define LOGCOMPRESSOR_H
+
+#include <QString>
+#include "socket.h"
+
+//---------------------------------------------------------------------------
+// Decides which samples a compressed data log keeps. Each analog channel
+// has an error bound (in the logged units):
+//
+//	DEADBAND		a sample is kept when any channel has moved more than its
+//					bound from the last kept sample; holding the last kept
+//					value reconstructs every channel within its bound.
+//	SWINGING_DOOR	a sample is kept when the straight line from the last
+//					kept sample would pass further than a bound from any
+//					sample since; linear interpolation between kept samples
+//					reconstructs every channel within its bound.
+//
+// Either way a change of state, heater or stale flag is kept on both sides,
+// and no two kept samples are further apart than the maximum interval.
+//---------------------------------------------------------------------------
+class LogCompressor
+{
+public:
+	enum Mode
+	{
+		OFF = 0,
+		DEADBAND,
+		SWINGING_DOOR
+	};
+
+	enum Channel
+	{
+		FIELD = 0,
+		CURRENT,
+		VOLTAGE,
+		SUPPLY_CURRENT,
+		SUPPLY_VOLTAGE,
+		REF_CURRENT,
+		CHANNELS
+	};
+
+	// offer() result flags
+	static const int STORE_PREVIOUS = 0x01;	// keep the sample offered before this one
+	static const int STORE_SAMPLE = 0x02;	// keep this sample, else hold it as the next previous
+
+	LogCompressor();
+
+	void setPolicy(Mode mode, const double *bounds /* CHANNELS values */, int maxIntervalMsecs);
+	bool isEnabled(void) const { return mode != OFF; }
+	QString description(void) const;	// for log headers
+
+	void reset(void);	// the next sample is kept
+	int offer(const Sample &sample);
+
+private:
+	static double channelValue(const Sample &sample, int channel);
+	bool discreteChange(const Sample &a, const Sample &b) const;
+	void anchorAt(const Sample &sample);
+	bool lineFits(const Sample &sample) const;
+	void narrowDoor(const Sample &sample);
+
+	Mode mode;
+	double bound[CHANNELS];
+	qint64 maxInterval;		// ms
+
+	bool anchored;
+	Sample anchor;			// last kept sample
+	Sample previous;		// last offered sample
+	bool previousKept;
+	double slopeLow[CHANNELS];	// door, per us, over samples since the anchor
+	double slopeHigh[CHANNELS];
+};
+
+#endif // LOGCOMPRESSOR_H
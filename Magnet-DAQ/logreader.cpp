@@ -0,0 +1,484 @@
+#include "stdafx.h"
+#include "logreader.h"
+#include "binarylog.h"
+#include "numberconv.h"
+#include <QtConcurrent>
+#include <QtEndian>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+const qint64 CHUNK_SIZE = 4 * 1024 * 1024;	// bytes parsed per task
+const int MAX_COLUMNS = 32;
+
+// what a CSV column or record field holds: a channel, or one of these
+enum Field
+{
+	TIME = LogReader::CHANNELS,
+	STALE,
+	FIELDS
+};
+
+// data between two section boundaries, all in one set of columns
+struct Section
+{
+	qint64 begin;
+	qint64 end;
+	int run;
+	int recordSize;				// binary, 0 for CSV
+	qint8 target[MAX_COLUMNS];	// CSV column -> Field, -1 to skip
+	bool present[LogReader::CHANNELS];
+};
+
+// a line (or record) aligned range of the file, one task each
+struct Piece
+{
+	const char *data;
+	qint64 begin;
+	qint64 end;
+	const Section *section;		// nullptr when looking for text lines
+};
+
+struct TextLine
+{
+	qint64 begin;
+	qint64 end;		// without the line end
+	qint64 next;	// start of the following line
+};
+
+struct PieceResult
+{
+	int run;
+	QVector<double> time;
+	QVector<double> values[LogReader::CHANNELS];
+};
+
+
+//---------------------------------------------------------------------------
+// Maps a column header to fields and fills in the run's units. Returns
+// false if there is no elapsed time column.
+static bool parseColumns(const QString &header, LogReader::Run &run, Section &section)
+{
+	QStringList columns = header.split(',');
+	bool hasTime = false;
+
+	memset(section.target, -1, sizeof(section.target));
+
+	for (int i = 0; i < LogReader::CHANNELS; i++)
+		section.present[i] = false;
+
+	for (int i = 0; i < qMin((int)columns.size(), MAX_COLUMNS); i++)
+	{
+		QString name = columns[i].trimmed();
+		int field = -1;
+
+		if (name.startsWith("Elapsed Time"))
+		{
+			field = TIME;
+			run.minutes = name.contains("(min)");
+			hasTime = true;
+		}
+		else if (name.startsWith("Magnet Field"))
+		{
+			field = LogReader::FIELD;
+			run.fieldUnits = name.contains("(kG)") ? "kG" : "T";
+		}
+		else if (name.startsWith("Magnet Current") || name.startsWith("Sample Current"))
+			field = LogReader::CURRENT;
+		else if (name.startsWith("Magnet Voltage") || name.startsWith("Sample Voltage"))
+			field = LogReader::VOLTAGE;
+		else if (name.startsWith("Supply Current"))
+			field = LogReader::SUPPLY_CURRENT;
+		else if (name.startsWith("Supply Voltage") || name.startsWith("Program Out"))
+			field = LogReader::SUPPLY_VOLTAGE;
+		else if (name.startsWith("Ref Current"))
+			field = LogReader::REF_CURRENT;
+		else if (name == "Stale")
+			field = STALE;
+
+		section.target[i] = field;
+
+		if (field >= 0 && field < LogReader::CHANNELS)
+			section.present[field] = true;
+	}
+
+	run.shortSample = header.contains("Sample Current");
+
+	return hasTime;
+}
+
+//---------------------------------------------------------------------------
+// Data lines start with the Unix time; anything else is a session or
+// column header line.
+static inline bool isDataLine(const char *p, const char *end)
+{
+	const char *q = p;
+
+	while (q < end && *q >= '0' && *q <= '9')
+		q++;
+
+	return q > p && q < end && *q == ',';
+}
+
+//---------------------------------------------------------------------------
+// Thread pool: the non-blank text lines of one chunk of a CSV log.
+static QVector<TextLine> findTextLines(const Piece &chunk)
+{
+	QVector<TextLine> lines;
+	const char *data = chunk.data;
+	const char *p = data + chunk.begin;
+	const char *end = data + chunk.end;
+
+	while (p < end)
+	{
+		const char *eol = (const char *)memchr(p, '\n', end - p);
+
+		if (!eol)
+			eol = end;
+
+		if (!isDataLine(p, eol))
+		{
+			const char *last = eol;
+
+			while (last > p && (last[-1] == '\r' || last[-1] == ' '))
+				last--;
+
+			if (last > p)
+				lines.append({ p - data, last - data, qMin(eol + 1, end) - data });
+		}
+
+		p = eol + 1;
+	}
+
+	return lines;
+}
+
+//---------------------------------------------------------------------------
+static inline void appendSample(PieceResult &result, const Section &section, const double *field)
+{
+	result.time.append(field[TIME]);
+
+	for (int i = 0; i < LogReader::CHANNELS; i++)
+	{
+		if (section.present[i])
+			result.values[i].append(field[i]);
+	}
+}
+
+//---------------------------------------------------------------------------
+// Thread pool: the samples of one piece of a section.
+static PieceResult parsePiece(const Piece &piece)
+{
+	const Section &section = *piece.section;
+	const char *p = piece.data + piece.begin;
+	const char *end = piece.data + piece.end;
+	PieceResult result;
+	double field[FIELDS];
+
+	result.run = section.run;
+
+	if (section.recordSize)
+	{
+		int estimate = (int)((piece.end - piece.begin) / section.recordSize);
+
+		result.time.reserve(estimate);
+
+		for (int i = 0; i < LogReader::CHANNELS; i++)
+		{
+			if (section.present[i])
+				result.values[i].reserve(estimate);
+		}
+
+		for (; p + section.recordSize <= end; p += section.recordSize)
+		{
+			Sample sample;
+			quint8 layout;
+
+			// index and commit records are skipped
+			if (!BinaryLog::decodeData(p, sample, field[TIME], layout) || sample.stale)
+				continue;
+
+			field[LogReader::FIELD] = sample.magnetField;
+			field[LogReader::CURRENT] = sample.magnetCurrent;
+			field[LogReader::VOLTAGE] = sample.magnetVoltage;
+			field[LogReader::SUPPLY_CURRENT] = sample.supplyCurrent;
+			field[LogReader::SUPPLY_VOLTAGE] = sample.supplyVoltage;
+			field[LogReader::REF_CURRENT] = sample.refCurrent;
+
+			appendSample(result, section, field);
+		}
+
+		return result;
+	}
+
+	result.time.reserve((int)((piece.end - piece.begin) / 100));	// typical line length
+
+	while (p < end)
+	{
+		const char *eol = (const char *)memchr(p, '\n', end - p);
+
+		if (!eol)
+			eol = end;
+
+		const char *q = p;
+		bool valid = true;
+
+		for (int i = 0; i < FIELDS; i++)
+			field[i] = std::numeric_limits<double>::quiet_NaN();
+
+		field[STALE] = 0.0;
+
+		// only the mapped columns are converted
+		for (int column = 0; column < MAX_COLUMNS && q <= eol; column++)
+		{
+			const char *comma = q;
+
+			while (comma < eol && *comma != ',')
+				comma++;
+
+			int target = section.target[column];
+
+			if (target >= 0)
+			{
+				const char *last = comma;
+
+				if (last > q && last[-1] == '\r')
+					last--;
+
+				if (parseDouble(q, last, field[target]) == nullptr)
+				{
+					valid = false;
+					break;
+				}
+			}
+
+			q = comma + 1;
+		}
+
+		p = eol + 1;
+
+		if (valid && !std::isnan(field[TIME]) && field[STALE] == 0.0)
+			appendSample(result, section, field);
+	}
+
+	return result;
+}
+
+//---------------------------------------------------------------------------
+// Cuts the sections into pieces no larger than a chunk, at chunk starts
+// (CSV, line aligned) or whole records (binary).
+static QVector<Piece> splitSections(const char *data, const QVector<Section> &sections, const QVector<qint64> &chunkStarts)
+{
+	QVector<Piece> pieces;
+
+	for (const Section &section : sections)
+	{
+		qint64 pos = section.begin;
+
+		while (pos < section.end)
+		{
+			qint64 next;
+
+			if (section.recordSize)
+			{
+				next = pos + (CHUNK_SIZE / section.recordSize) * section.recordSize;
+			}
+			else
+			{
+				auto it = std::upper_bound(chunkStarts.constBegin(), chunkStarts.constEnd(), pos);
+				next = (it == chunkStarts.constEnd()) ? section.end : *it;
+			}
+
+			next = qMin(next, section.end);
+			pieces.append({ data, pos, next, &section });
+			pos = next;
+		}
+	}
+
+	return pieces;
+}
+
+//---------------------------------------------------------------------------
+static QString sessionText(const QString &line)
+{
+	// notes in parentheses (data loss window, compression) are not part of it
+	int notes = line.indexOf(" (");
+
+	return (notes > 0 ? line.left(notes) : line).trimmed();
+}
+
+//---------------------------------------------------------------------------
+// Loads every run of a CSV or binary data log. A new run starts with each
+// session, or with a column header in other units.
+bool LogReader::load(const QString &fileName, QVector<Run> &runs, QString *errorMessage)
+{
+	auto fail = [errorMessage](const QString &message)
+	{
+		if (errorMessage)
+			*errorMessage = message;
+
+		return false;
+	};
+
+	QFile file(fileName);
+
+	if (!file.open(QFile::ReadOnly))
+		return fail("Cannot open " + fileName + ": " + file.errorString());
+
+	qint64 size = file.size();
+
+	if (size == 0)
+		return fail(fileName + " is empty");
+
+	const char *data = (const char *)file.map(0, size);
+
+	if (!data)
+		return fail("Cannot map " + fileName + ": " + file.errorString());
+
+	QVector<Section> sections;
+	QVector<qint64> chunkStarts;
+	QString runSession;
+	QString runHeader;
+
+	runs.clear();
+
+	// starts a section, and a new run unless the session and columns are unchanged
+	auto startSection = [&](qint64 begin, const QString &session, const QString &header, int recordSize)
+	{
+		Run run;
+		Section section;
+
+		run.minutes = false;
+		run.shortSample = false;
+
+		if (!parseColumns(header, run, section))
+			return;
+
+		if (runs.isEmpty() || session != runSession || header != runHeader)
+		{
+			run.session = session;
+			runs.append(run);
+			runSession = session;
+			runHeader = header;
+		}
+
+		section.begin = begin;
+		section.end = size;
+		section.run = runs.size() - 1;
+		section.recordSize = recordSize;
+		sections.append(section);
+	};
+
+	auto endSection = [&](qint64 end)
+	{
+		if (!sections.isEmpty() && sections.last().end > end)
+			sections.last().end = end;
+	};
+
+	if (BinaryLog::isSegmentHeader(data, size))
+	{
+		// segment headers sit between whole records, walk them
+		qint64 pos = 0;
+		int recordSize = 0;
+
+		while (pos + BinaryLog::HEADER_SIZE <= size)
+		{
+			const char *fixed = data + pos;
+
+			if (BinaryLog::isSegmentHeader(fixed, size - pos))
+			{
+				if (qFromLittleEndian<quint16>(fixed + 8) > BinaryLog::VERSION)
+					return fail(fileName + " was written by a newer version of Magnet-DAQ");
+
+				recordSize = qFromLittleEndian<quint16>(fixed + 10);
+				qint64 textLength = qFromLittleEndian<quint32>(fixed + 12);
+
+				if (recordSize < BinaryLog::RECORD_SIZE || pos + BinaryLog::HEADER_SIZE + textLength > size)
+					return fail(fileName + " is corrupt at offset " + QString::number(pos));
+
+				QMap<QString, QString> fields = BinaryLog::parseSegmentText(QByteArray::fromRawData(fixed + BinaryLog::HEADER_SIZE, (int)textLength));
+
+				endSection(pos);
+				pos += BinaryLog::HEADER_SIZE + textLength;
+				startSection(pos, fields.value("Session"), fields.value("Columns"), recordSize);
+				continue;
+			}
+
+			pos += recordSize;
+		}
+
+		// a partial record at the end (e.g. after a crash) is ignored
+		endSection(pos > size ? pos - recordSize : pos);
+	}
+	else
+	{
+		// chunk boundaries at line starts
+		chunkStarts.append(0);
+
+		for (qint64 pos = CHUNK_SIZE; pos < size; pos += CHUNK_SIZE)
+		{
+			const char *eol = (const char *)memchr(data + pos, '\n', size - pos);
+
+			if (!eol || eol + 1 - data >= size)
+				break;
+
+			pos = eol + 1 - data;
+			chunkStarts.append(pos);
+		}
+
+		QVector<Piece> chunks;
+
+		for (int i = 0; i < chunkStarts.size(); i++)
+			chunks.append({ data, chunkStarts[i], i + 1 < chunkStarts.size() ? chunkStarts[i + 1] : size, nullptr });
+
+		QVector<QVector<TextLine>> textLines = QtConcurrent::blockingMapped<QVector<QVector<TextLine>>>(chunks, findTextLines);
+		QString session;
+
+		for (const QVector<TextLine> &lines : textLines)
+		{
+			for (const TextLine &line : lines)
+			{
+				QString text = QString::fromLocal8Bit(data + line.begin, (int)(line.end - line.begin));
+
+				endSection(line.begin);
+
+				// rows after a session line wait for its column header
+				if (text.contains("Elapsed Time"))
+					startSection(line.next, session, text, 0);
+				else
+					session = sessionText(text);
+			}
+		}
+	}
+
+	if (sections.isEmpty())
+		return fail(fileName + " is not a Magnet-DAQ data log");
+
+	QVector<Piece> pieces = splitSections(data, sections, chunkStarts);
+	QVector<PieceResult> results = QtConcurrent::blockingMapped<QVector<PieceResult>>(pieces, parsePiece);
+
+	// join in file order
+	for (const PieceResult &result : results)
+	{
+		Run &run = runs[result.run];
+
+		run.time += result.time;
+
+		for (int i = 0; i < CHANNELS; i++)
+			run.values[i] += result.values[i];
+	}
+
+	for (int i = runs.size() - 1; i >= 0; i--)
+	{
+		if (runs[i].time.isEmpty())
+			runs.remove(i);
+	}
+
+	if (runs.isEmpty())
+		return fail(fileName + " has no samples");
+
+	return true;
+}
+
+//---------------------------------------------------------------------------
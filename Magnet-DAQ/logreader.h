@@ -0,0 +1,45 @@
+#ifndef LOGREADER_H
+#define LOGREADER_H
+
+#include <QString>
+#include <QVector>
+
+//---------------------------------------------------------------------------
+// Reads an existing data log (CSV or binary) back for offline review. The
+// file is memory-mapped and never copied into strings: it is cut into
+// chunks at line (or record) boundaries, the section boundaries (session
+// and column header lines, binary segment headers) are found first, then
+// the chunks are parsed in parallel on the global thread pool and joined
+// in file order. Stale samples are skipped, they were not measured.
+//---------------------------------------------------------------------------
+class LogReader
+{
+public:
+	enum Channel
+	{
+		FIELD = 0,
+		CURRENT,			// or sample current
+		VOLTAGE,			// or sample voltage (uV)
+		SUPPLY_CURRENT,
+		SUPPLY_VOLTAGE,		// or program out
+		REF_CURRENT,
+		CHANNELS
+	};
+
+	// the samples of one logging session, in one set of units
+	struct Run
+	{
+		QString session;		// start date/time line
+		QString fieldUnits;		// "T" or "kG", empty without a field column
+		bool minutes;			// elapsed time in minutes rather than seconds
+		bool shortSample;
+		QVector<double> time;	// elapsed time, as logged
+		QVector<double> values[CHANNELS];	// empty if not logged
+
+		bool hasChannel(int channel) const { return !values[channel].isEmpty(); }
+	};
+
+	static bool load(const QString &fileName, QVector<Run> &runs, QString *errorMessage = nullptr);
+};
+
+#endif // LOGREADER_H
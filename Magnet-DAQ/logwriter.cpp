@@ -0,0 +1,869 @@
+#include "stdafx.h"
+#include "logwriter.h"
+#include "binarylog.h"
+#include "numberconv.h"
+#include "xlsxzipwriter_p.h"
+#include <QtConcurrent>
+#include <charconv>
+#include <cmath>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+const int BLOCK_SIZE = 64 * 1024;	// bytes written per block
+const int MAX_RECORD_LENGTH = qMax(LogWriter::MAX_LINE_LENGTH, 2 * BinaryLog::RECORD_SIZE);
+const int IDLE_WAIT = 50;			// ms, writer polls the queue this often
+const int REPAIR_SCAN = 4096;		// bytes searched back for the last CSV line end
+
+// the manifest is updated by the writer and by compression jobs
+static QMutex manifestMutex;
+
+
+//---------------------------------------------------------------------------
+LogWriter::LogWriter(const QString &fileName, QObject *parent)
+	: QThread(parent), baseName(fileName), block(new char[BLOCK_SIZE])
+{
+	blockLength = 0;
+	unflushedBytes = 0;
+	unflushedRecords = 0;
+	filePosition = 0;
+	groupCrc = 0;
+	groupBytes = 0;
+	groupSamples = 0;
+	checksummed = 0;
+	segmentOffset = 0;
+	segmentRecords = 0;
+	format = LogFormat::CSV;
+	holding = false;
+	rotateBytes = 0;
+	rotateBoundary = LogRotation::NONE;
+	rotateOnRequest = false;
+	compressSegments = true;
+	boundaryTime = 0;
+	segmentStart = 0;
+	firstSampleTime = -1;
+	lastSampleTime = -1;
+	segmentSamples = 0;
+	flushInterval = 1000;
+	flushRecords = 0;
+	flushBytes = 0;
+	syncToDisk = false;
+	stopping = false;
+	droppedRecords = 0;
+	droppedText = 0;
+	highWaterMark = 0;
+	bytesWritten = 0;
+	repairedBytes = 0;
+	writeError = false;
+}
+
+//---------------------------------------------------------------------------
+LogWriter::~LogWriter()
+{
+	stop();
+}
+
+//---------------------------------------------------------------------------
+// Each trigger is optional (0); whichever comes first starts a flush.
+// With syncToDisk every flush is a group commit through to the disk.
+void LogWriter::setFlushPolicy(int msecs, int records, qint64 bytes, bool syncToDisk)
+{
+	flushInterval = qMax(msecs, 0);
+	flushRecords = qMax(records, 0);
+	flushBytes = qMax(bytes, (qint64)0);
+	this->syncToDisk = syncToDisk;
+}
+
+//---------------------------------------------------------------------------
+QString LogWriter::lossWindow(void) const
+{
+	QStringList limits;
+
+	// the writer notices an elapsed interval within IDLE_WAIT
+	if (flushInterval)
+		limits << QString::number(flushInterval + IDLE_WAIT) + " ms";
+
+	if (flushRecords)
+		limits << QString::number(flushRecords) + " samples";
+
+	if (flushBytes)
+		limits << QString::number(flushBytes) + " bytes";
+
+	if (limits.isEmpty())
+		return "unbounded";
+
+	return limits.join(" or ") + (syncToDisk ? ", synced to disk" : ", OS cache only");
+}
+
+//---------------------------------------------------------------------------
+// Any rule turns on segment files; bytes is per segment, 0 for no limit.
+void LogWriter::setRotationPolicy(qint64 bytes, LogRotation boundary, bool onRequest, bool compress)
+{
+	rotateBytes = qMax(bytes, (qint64)0);
+	rotateBoundary = boundary;
+	rotateOnRequest = onRequest;
+	compressSegments = compress;
+}
+
+//---------------------------------------------------------------------------
+// Bounds are per LogCompressor::Channel, in the logged units.
+void LogWriter::setCompression(LogCompressor::Mode mode, const double *bounds, int maxIntervalMsecs)
+{
+	compressor.setPolicy(mode, bounds, maxIntervalMsecs);
+	holding = false;
+}
+
+//---------------------------------------------------------------------------
+// Queues one sample line. Never blocks; returns false and counts the record
+// as dropped if the writer has fallen a full queue behind.
+bool LogWriter::writeSample(const Sample &sample, double timebase, LogLayout layout, bool heater)
+{
+	LogRecord record;
+
+	record.kind = RecordKind::SAMPLE;
+	record.layout = layout;
+	record.heater = heater;
+	record.timebase = timebase;
+	record.sample = sample;
+
+	if (!ring.push(record))
+	{
+		droppedRecords++;
+		return false;
+	}
+
+	int depth = (int)ring.count();
+
+	if (depth > highWaterMark)
+		highWaterMark = depth;
+
+	return true;
+}
+
+//---------------------------------------------------------------------------
+// Queues text (headers, session markers) in order with the samples.
+void LogWriter::writeText(const QByteArray &text)
+{
+	queueText(RecordKind::TEXT, text);
+}
+
+//---------------------------------------------------------------------------
+// Queues the column header (CSV) or segment header (binary), which is also
+// written again at the top of each new segment file.
+void LogWriter::writeHeader(const QByteArray &header)
+{
+	queueText(RecordKind::HEADER, header);
+}
+
+//---------------------------------------------------------------------------
+// Starts a new segment file once everything queued so far is written.
+void LogWriter::rotate(void)
+{
+	if (rotateOnRequest)
+		queueText(RecordKind::ROTATE, QByteArray());
+}
+
+//---------------------------------------------------------------------------
+// Never blocks; like a sample, text is dropped and counted if the writer
+// has fallen a full queue behind.
+void LogWriter::queueText(RecordKind kind, const QByteArray &text)
+{
+	LogRecord record;
+
+	record.kind = kind;
+
+	// the writer can't take the entry before its record is queued, so an
+	// entry without one is still the last
+	QMutexLocker lock(&textMutex);
+
+	textQueue.enqueue(text);
+
+	if (!ring.push(record))
+	{
+		textQueue.removeLast();
+		droppedText++;
+	}
+}
+
+//---------------------------------------------------------------------------
+void LogWriter::stop(void)
+{
+	if (isRunning())
+	{
+		stopping = true;
+
+		waitMutex.lock();
+		wake.wakeAll();
+		waitMutex.unlock();
+
+		wait();
+	}
+}
+
+//---------------------------------------------------------------------------
+void LogWriter::run(void)
+{
+	if (!openSegment())
+		return;
+
+	sinceFlush.start();
+
+	while (true)
+	{
+		// stop only after everything queued before stop() is written
+		bool finalPass = stopping;
+		LogRecord record;
+
+		while (ring.pop(record))
+		{
+			appendRecord(record);
+
+			if (flushRecords && unflushedRecords >= flushRecords)
+			{
+				commitGroup();
+				writeBlock(true);
+			}
+		}
+
+		if (finalPass)
+			break;
+
+		// flush by elapsed time or bytes pending
+		if ((flushInterval && sinceFlush.elapsed() >= flushInterval) ||
+			(flushBytes && unflushedBytes + blockLength >= flushBytes))
+		{
+			if (blockLength || unflushedBytes)
+			{
+				commitGroup();
+				writeBlock(true);
+			}
+
+			sinceFlush.restart();
+		}
+
+		waitMutex.lock();
+
+		if (!stopping)
+			wake.wait(&waitMutex, IDLE_WAIT);
+
+		waitMutex.unlock();
+	}
+
+	flushHeld();
+	closeSegment("stop");
+}
+
+//---------------------------------------------------------------------------
+bool LogWriter::openSegment(void)
+{
+	segmentSamples = 0;
+	firstSampleTime = -1;
+	lastSampleTime = -1;
+	groupCrc = 0;
+	groupBytes = 0;
+	groupSamples = 0;
+	checksummed = 0;
+
+	if (!isRotating())
+	{
+		// a single file, added to on each run; first cut back anything a
+		// crash left half written
+		if (QFile::exists(baseName))
+		{
+			qint64 repaired = (format == LogFormat::BINARY) ? BinaryLog::repairTail(baseName) : repairCsvTail(baseName);
+
+			if (repaired > 0)
+				repairedBytes = repaired;
+		}
+
+		file.setFileName(baseName);
+
+		if (!file.open(QFile::Append))
+		{
+			qDebug() << "Log file open failed: " << file.errorString();
+			writeError = true;
+			return false;
+		}
+
+		filePosition = file.size();
+		return true;
+	}
+
+	file.setFileName(segmentFileName());
+
+	if (!file.open(QFile::WriteOnly))
+	{
+		qDebug() << "Log segment open failed: " << file.errorString();
+		writeError = true;
+		return false;
+	}
+
+	filePosition = 0;
+	nextBoundary();
+
+	// listed as open until closed
+	updateManifest(manifestFileName(), QStringList() << QFileInfo(file).fileName() << "" << "" << "" << "0" << "0" << "");
+
+	return true;
+}
+
+//---------------------------------------------------------------------------
+void LogWriter::closeSegment(const QString &reason)
+{
+	if (!file.isOpen())
+		return;
+
+	commitGroup();
+	writeBlock(true);
+
+	qint64 size = filePosition;
+	QString fileName = file.fileName();
+
+	file.close();
+
+	if (!isRotating())
+		return;
+
+	auto timeString = [](qint64 msecs)
+	{
+		return msecs < 0 ? QString("") : QDateTime::fromMSecsSinceEpoch(msecs).toString(Qt::ISODateWithMs);
+	};
+
+	updateManifest(manifestFileName(), QStringList() << QFileInfo(fileName).fileName() << "" <<
+		timeString(firstSampleTime) << timeString(lastSampleTime) <<
+		QString::number(segmentSamples) << QString::number(size) << reason);
+
+	// zip in the background, the writer carries straight on
+	if (compressSegments)
+		QtConcurrent::run(&LogWriter::compressSegment, fileName, manifestFileName());
+}
+
+//---------------------------------------------------------------------------
+// Closes the present segment and starts the next with the last header.
+void LogWriter::rotateSegment(const QString &reason)
+{
+	closeSegment(reason);
+
+	if (!openSegment())
+		return;
+
+	if (format == LogFormat::BINARY)
+	{
+		segmentOffset = 0;
+		segmentRecords = 0;
+	}
+	else if (!lastText.isEmpty())
+	{
+		appendText(lastText);
+	}
+
+	if (!lastHeader.isEmpty())
+		appendText(lastHeader);
+}
+
+//---------------------------------------------------------------------------
+void LogWriter::nextBoundary(void)
+{
+	QDateTime now = QDateTime::currentDateTime();
+
+	if (rotateBoundary == LogRotation::HOURLY)
+		boundaryTime = QDateTime(now.date(), QTime(now.time().hour(), 0)).addSecs(3600).toMSecsSinceEpoch();
+	else if (rotateBoundary == LogRotation::DAILY)
+		boundaryTime = QDateTime(now.date().addDays(1), QTime(0, 0)).toMSecsSinceEpoch();
+	else
+		boundaryTime = 0;
+}
+
+//---------------------------------------------------------------------------
+// <name>_<yyyyMMdd-hhmmss>.<ext>, numbered if that already exists
+QString LogWriter::segmentFileName(void) const
+{
+	QFileInfo info(baseName);
+	QString stem = info.path() + "/" + info.completeBaseName() + "_" + QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss");
+	QString suffix = info.suffix().isEmpty() ? QString("") : "." + info.suffix();
+	QString name = stem + suffix;
+
+	for (int i = 2; QFile::exists(name) || QFile::exists(name + ".zip"); i++)
+		name = stem + "-" + QString::number(i) + suffix;
+
+	return name;
+}
+
+//---------------------------------------------------------------------------
+QString LogWriter::manifestFileName(void) const
+{
+	QFileInfo info(baseName);
+
+	return info.path() + "/" + info.completeBaseName() + ".manifest.csv";
+}
+
+//---------------------------------------------------------------------------
+// Thread pool: zips a closed segment and removes the original.
+void LogWriter::compressSegment(QString fileName, QString manifestName)
+{
+	QFile source(fileName);
+
+	if (!source.open(QFile::ReadOnly))
+		return;
+
+	QString zipName = fileName + ".zip";
+	bool ok;
+
+	{
+		QXlsx::ZipWriter zip(zipName);
+
+		zip.addFile(QFileInfo(fileName).fileName(), &source);
+		zip.close();
+		ok = !zip.error();
+	}
+
+	source.close();
+
+	if (ok)
+	{
+		QFile::remove(fileName);
+		updateManifest(manifestName, QStringList() << QFileInfo(fileName).fileName() << QFileInfo(zipName).fileName());
+	}
+	else
+	{
+		qDebug() << "Log segment compression failed: " << fileName;
+		QFile::remove(zipName);
+	}
+}
+
+//---------------------------------------------------------------------------
+// Adds or updates the manifest line for a segment (first column). Missing
+// trailing columns of the entry are left as they were.
+void LogWriter::updateManifest(const QString &manifestName, const QStringList &entry)
+{
+	const QString header = "Segment,Archive,First Sample,Last Sample,Samples,Bytes,Closed";
+	QMutexLocker lock(&manifestMutex);
+	QStringList lines;
+
+	{
+		QFile in(manifestName);
+
+		if (in.open(QFile::ReadOnly | QFile::Text))
+		{
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
+			lines = QString::fromUtf8(in.readAll()).split('\n', QString::SkipEmptyParts);
+#else
+			lines = QString::fromUtf8(in.readAll()).split('\n', Qt::SkipEmptyParts);
+#endif
+		}
+	}
+
+	if (lines.isEmpty())
+		lines << header;
+
+	int index;
+
+	for (index = 1; index < lines.size(); index++)
+	{
+		if (lines[index].section(',', 0, 0) == entry.first())
+			break;
+	}
+
+	QStringList columns = (index < lines.size()) ? lines[index].split(',') : QStringList();
+
+	while (columns.size() < 7)
+		columns << "";
+
+	for (int i = 0; i < entry.size() && i < columns.size(); i++)
+		columns[i] = entry[i];
+
+	if (index < lines.size())
+		lines[index] = columns.join(',');
+	else
+		lines << columns.join(',');
+
+	// replaced in one step, so a reader never sees a partial manifest
+	QSaveFile out(manifestName);
+
+	if (out.open(QFile::WriteOnly | QFile::Text))
+	{
+		out.write((lines.join('\n') + "\n").toUtf8());
+		out.commit();
+	}
+}
+
+//---------------------------------------------------------------------------
+// Writer thread: adds one queued record to the block in the file format.
+void LogWriter::appendRecord(const LogRecord &record)
+{
+	if (blockLength > BLOCK_SIZE - MAX_RECORD_LENGTH)
+		writeBlock(false);
+
+	if (record.kind != RecordKind::SAMPLE)
+	{
+		QByteArray text;
+
+		{
+			QMutexLocker lock(&textMutex);
+			text = textQueue.dequeue();
+		}
+
+		// a new segment or header starts a new compressed run
+		flushHeld();
+
+		if (record.kind == RecordKind::ROTATE)
+		{
+			if (rotateOnRequest)
+				rotateSegment("request");
+		}
+		else if (record.kind == RecordKind::HEADER)
+		{
+			if (format == LogFormat::BINARY)
+			{
+				// a checksum group never spans segment headers
+				commitGroup();
+
+				if (blockLength > BLOCK_SIZE - MAX_RECORD_LENGTH)
+					writeBlock(false);
+
+				segmentOffset = filePosition + blockLength;
+				segmentRecords = 0;
+			}
+
+			lastHeader = text;
+			appendText(text);
+		}
+		else if (format == LogFormat::CSV)
+		{
+			lastText = text;
+			appendText(text);
+		}
+
+		return;
+	}
+
+	if (!compressor.isEnabled())
+	{
+		appendSample(record);
+		return;
+	}
+
+	int decision = compressor.offer(record.sample);
+
+	if ((decision & LogCompressor::STORE_PREVIOUS) && holding)
+		appendSample(held);
+
+	holding = false;
+
+	if (decision & LogCompressor::STORE_SAMPLE)
+		appendSample(record);
+	else
+	{
+		held = record;
+		holding = true;
+	}
+}
+
+//---------------------------------------------------------------------------
+// Writer thread: writes out a held sample, the next sample is then kept.
+void LogWriter::flushHeld(void)
+{
+	if (holding)
+	{
+		holding = false;
+		appendSample(held);
+	}
+
+	compressor.reset();
+}
+
+//---------------------------------------------------------------------------
+// Writer thread: adds one sample record to the block.
+void LogWriter::appendSample(const LogRecord &record)
+{
+	if (blockLength > BLOCK_SIZE - MAX_RECORD_LENGTH)
+		writeBlock(false);
+
+	const Sample &s = record.sample;
+
+	// rotate ahead of the first sample past a limit
+	if (segmentSamples)
+	{
+		if (boundaryTime && s.time >= boundaryTime)
+			rotateSegment(rotateBoundary == LogRotation::DAILY ? "daily" : "hourly");
+		else if (rotateBytes && filePosition + blockLength >= rotateBytes)
+			rotateSegment("size");
+	}
+
+	if (firstSampleTime < 0)
+		firstSampleTime = s.time;
+
+	lastSampleTime = s.time;
+	segmentSamples++;
+	unflushedRecords++;
+
+	if (format == LogFormat::BINARY)
+	{
+		char *p = block.get() + blockLength;
+
+		// periodic index ahead of the data record it points to
+		if (segmentRecords % BinaryLog::INDEX_INTERVAL == 0)
+		{
+			BinaryLog::encodeIndex(p, segmentRecords, s.time, record.timebase, segmentOffset);
+			p += BinaryLog::RECORD_SIZE;
+		}
+
+		// non-*AMITRG switch heater state comes from the last query
+		BinaryLog::encodeData(p, s, record.timebase, (quint8)record.layout,
+			record.layout == LogLayout::MAGNET_HEATER ? record.heater : s.heater);
+		p += BinaryLog::RECORD_SIZE;
+
+		blockLength = (int)(p - block.get());
+		segmentRecords++;
+		groupSamples++;
+	}
+	else
+	{
+		blockLength += formatSample(s, record.timebase, record.layout, record.heater,
+			block.get() + blockLength, block.get() + BLOCK_SIZE);
+	}
+}
+
+//---------------------------------------------------------------------------
+void LogWriter::appendText(const QByteArray &text)
+{
+	// large text goes straight out behind the block
+	if (text.size() > BLOCK_SIZE - blockLength)
+	{
+		writeBlock(false);
+
+		if (format == LogFormat::BINARY)
+			checksum(text.constData(), text.size());
+
+		qint64 written = file.write(text);
+
+		if (written > 0)
+		{
+			bytesWritten += written;
+			filePosition += written;
+		}
+
+		unflushedBytes += text.size();
+	}
+	else
+	{
+		memcpy(block.get() + blockLength, text.constData(), text.size());
+		blockLength += text.size();
+	}
+}
+
+//---------------------------------------------------------------------------
+bool LogWriter::writeBlock(bool flush)
+{
+	bool ok = true;
+
+	if (blockLength)
+	{
+		if (format == LogFormat::BINARY)
+			checksum(block.get() + checksummed, blockLength - checksummed);
+
+		checksummed = 0;
+
+		qint64 written = file.write(block.get(), blockLength);
+
+		if (written != blockLength)
+		{
+			if (!writeError)
+				qDebug() << "Log file write failed: " << file.errorString();
+
+			writeError = true;
+			ok = false;
+		}
+
+		if (written > 0)
+		{
+			bytesWritten += written;
+			filePosition += written;
+		}
+
+		unflushedBytes += blockLength;
+		blockLength = 0;
+	}
+
+	if (flush)
+	{
+		file.flush();
+
+		if (syncToDisk)
+			syncFile();
+
+		unflushedBytes = 0;
+		unflushedRecords = 0;
+		sinceFlush.restart();
+	}
+
+	return ok;
+}
+
+//---------------------------------------------------------------------------
+// file data only where the OS allows it, metadata such as the modified
+// time is not worth a second seek
+void LogWriter::syncFile(void)
+{
+#if defined(Q_OS_WIN)
+	_commit(file.handle());
+#elif defined(Q_OS_LINUX)
+	fdatasync(file.handle());
+#else
+	fsync(file.handle());
+#endif
+}
+
+//---------------------------------------------------------------------------
+void LogWriter::checksum(const char *data, qint64 length)
+{
+	groupCrc = BinaryLog::crc32(groupCrc, data, length);
+	groupBytes += length;
+}
+
+//---------------------------------------------------------------------------
+// Binary logs: closes the group written since the last commit with a
+// commit record holding its length and CRC. Written with the next block.
+void LogWriter::commitGroup(void)
+{
+	if (format != LogFormat::BINARY)
+		return;
+
+	if (!groupBytes && blockLength == checksummed)
+		return;	// nothing new
+
+	if (blockLength > BLOCK_SIZE - BinaryLog::RECORD_SIZE)
+		writeBlock(false);
+
+	checksum(block.get() + checksummed, blockLength - checksummed);
+	BinaryLog::encodeCommit(block.get() + blockLength, groupSamples, groupBytes, groupCrc);
+	blockLength += BinaryLog::RECORD_SIZE;
+	checksummed = blockLength;	// the commit record itself is not in any group
+
+	groupCrc = 0;
+	groupBytes = 0;
+	groupSamples = 0;
+}
+
+//---------------------------------------------------------------------------
+// CSV logs: removes a partial last line. Returns the bytes removed.
+qint64 LogWriter::repairCsvTail(const QString &fileName)
+{
+	QFile csv(fileName);
+
+	if (!csv.open(QFile::ReadOnly))
+		return -1;
+
+	qint64 size = csv.size();
+	qint64 start = qMax(size - REPAIR_SCAN, (qint64)0);
+
+	csv.seek(start);
+
+	QByteArray tail = csv.read(size - start);
+	csv.close();
+
+	if (tail.isEmpty() || tail.endsWith('\n'))
+		return 0;
+
+	int lineEnd = tail.lastIndexOf('\n');
+
+	// no line end near the end at all, leave it alone
+	if (lineEnd < 0 && start > 0)
+		return 0;
+
+	qint64 cut = start + lineEnd + 1;
+
+	qDebug() << "Repairing log tail: " << fileName << " removing " << size - cut << " bytes";
+
+	if (!QFile::resize(fileName, cut))
+		return -1;
+
+	return size - cut;
+}
+
+//---------------------------------------------------------------------------
+// Formats one sample line, in the same columns and precision as the
+// original sprintf() formats. Returns the length written.
+int LogWriter::formatSample(const Sample &s, double timebase, LogLayout layout, bool heater, char *buffer, char *end)
+{
+	char *p = buffer;
+
+	auto integer = [&p, end](qint64 value)
+	{
+		p = std::to_chars(p, end, value).ptr;
+	};
+
+	// very large (or non-finite) values in shortest form, so a line always
+	// fits in MAX_LINE_LENGTH
+	auto fixed = [&p, end](double value, int precision)
+	{
+		*p++ = ',';
+
+		if (fabs(value) < 1e15)
+			p = formatDouble(p, end, value, precision);
+		else
+			p = formatDouble(p, end, value);
+	};
+
+	auto flag = [&p, end](int value)
+	{
+		*p++ = ',';
+		p = std::to_chars(p, end, value).ptr;
+	};
+
+	integer(s.time);
+	fixed(timebase, 8);
+
+	switch (layout)
+	{
+		case LogLayout::SHORT_SAMPLE:
+		case LogLayout::SHORT_SAMPLE_STATE:
+			fixed(s.magnetCurrent, 8);	// sample current
+			fixed(s.magnetVoltage, 3);	// sample uV
+			fixed(s.supplyCurrent, 8);
+			fixed(s.supplyVoltage, 6);
+
+			if (layout == LogLayout::SHORT_SAMPLE_STATE)
+			{
+				fixed(s.refCurrent, 8);
+				flag(s.state);
+			}
+			break;
+
+		default:
+			fixed(s.magnetField, 9);
+			fixed(s.magnetCurrent, 8);
+			fixed(s.magnetVoltage, 3);
+			fixed(s.supplyCurrent, 8);
+			fixed(s.supplyVoltage, 6);
+
+			if (layout == LogLayout::MAGNET_STATE || layout == LogLayout::MAGNET_STATE_HEATER)
+			{
+				fixed(s.refCurrent, 8);
+				flag(s.state);
+			}
+
+			if (layout == LogLayout::MAGNET_STATE_HEATER)
+				flag(s.heater);
+			else if (layout == LogLayout::MAGNET_HEATER)
+				flag(heater);
+			break;
+	}
+
+	// acquisition timing, microseconds on a monotonic clock
+	*p++ = ',';
+	integer(s.sendTime);
+	*p++ = ',';
+	integer(s.receiveTime);
+	*p++ = ',';
+	integer(s.midpointTime);
+	flag(s.stale ? 1 : 0);
+	*p++ = '\n';
+
+	return (int)(p - buffer);
+}
+
+//---------------------------------------------------------------------------
@@ -0,0 +1,206 @@
+#ifndef LOGWRITER_H
+#define LOGWRITER_H
+
+#include <QThread>
+#include <QFile>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QElapsedTimer>
+#include <atomic>
+#include <memory>
+#include "socket.h"
+#include "samplering.h"
+#include "logcompressor.h"
+
+// column layouts of a data log line, chosen when the sample is queued
+enum class LogLayout : quint8
+{
+	SHORT_SAMPLE = 0,			// short-sample mode
+	SHORT_SAMPLE_STATE,			// short-sample mode, with ref current and state (*AMITRG)
+	MAGNET,						// field, current, voltages
+	MAGNET_HEATER,				// ... with switch heater (as last queried)
+	MAGNET_STATE,				// ... with ref current and state (*AMITRG)
+	MAGNET_STATE_HEATER			// ... with ref current, state and heater (*AMITRG)
+};
+
+enum class LogFormat : quint8
+{
+	CSV = 0,		// text, one formatted line per sample
+	BINARY			// fixed-size records, see binarylog.h
+};
+
+// wall-clock boundaries for starting a new log segment
+enum class LogRotation : quint8
+{
+	NONE = 0,
+	HOURLY,
+	DAILY
+};
+
+//---------------------------------------------------------------------------
+// Writes the data log on its own thread, so a slow or stalled disk (e.g. a
+// network share) never holds up plotting or acquisition. The GUI thread
+// queues records into a bounded lock-free ring and never blocks; if the ring
+// is full the record is dropped and counted. The writer thread formats with
+// std::to_chars into a large block and writes whole blocks, flushing by
+// elapsed time, samples or bytes written, optionally through to the disk
+// (group commit). The flush policy bounds what a crash or power loss can
+// lose; binary logs also checksum each group, and a damaged tail is
+// repaired before a log is appended to.
+//
+// With compression the writer thread keeps only the samples LogCompressor
+// needs to reconstruct each channel within its bound, holding back the
+// newest sample until it knows whether it ends a run.
+//
+// With a rotation policy the log is split into segment files named
+// <name>_<yyyyMMdd-hhmmss>.<ext>, each starting with the last header.
+// Closed segments are zipped on the global thread pool, and
+// <name>.manifest.csv lists every segment with its sample time range.
+//---------------------------------------------------------------------------
+class LogWriter : public QThread
+{
+public:
+	LogWriter(const QString &fileName, QObject *parent = Q_NULLPTR);
+	~LogWriter();
+
+	// set before start()
+	void setFormat(LogFormat format) { this->format = format; }
+	void setFlushPolicy(int msecs, int records, qint64 bytes, bool syncToDisk);
+	void setRotationPolicy(qint64 bytes, LogRotation boundary, bool onRequest, bool compress);
+	void setCompression(LogCompressor::Mode mode, const double *bounds, int maxIntervalMsecs);
+	LogFormat getFormat(void) const { return format; }
+	QString lossWindow(void) const;		// worst-case data loss, for log headers
+	bool isCompressing(void) const { return compressor.isEnabled(); }
+	QString compressionDescription(void) const { return compressor.description(); }
+
+	// GUI thread only
+	bool writeSample(const Sample &sample, double timebase, LogLayout layout, bool heater);
+	void writeText(const QByteArray &text);		// CSV only, ignored for binary logs
+	void writeHeader(const QByteArray &header);	// CSV column line, or BinaryLog::segmentHeader()
+	void rotate(void);	// starts a new segment, if rotating on request
+	void stop(void);	// drains the queue, flushes and closes the file
+
+	// statistics, may be read from any thread
+	quint64 getDroppedRecords(void) const { return droppedRecords; }
+	quint64 getDroppedText(void) const { return droppedText; }
+	int getHighWaterMark(void) const { return highWaterMark; }
+	quint64 getBytesWritten(void) const { return bytesWritten; }
+	qint64 getRepairedBytes(void) const { return repairedBytes; }
+	bool hasError(void) const { return writeError; }
+	static constexpr int queueCapacity(void) { return QUEUE_SIZE - 1; }
+
+	// formats one CSV line, returns its length
+	static const int MAX_LINE_LENGTH = 384;
+	static int formatSample(const Sample &sample, double timebase, LogLayout layout, bool heater, char *buffer, char *end);
+
+protected:
+	void run(void) override;
+
+private:
+	static const int QUEUE_SIZE = 8192;	// records, a power of two
+
+	enum class RecordKind : quint8
+	{
+		SAMPLE,
+		TEXT,			// next entry of textQueue goes here
+		HEADER,			// ... as the header, repeated in each segment
+		ROTATE			// ... (empty) start a new segment
+	};
+
+	// fixed-size queue entry, text is carried separately to keep it small
+	struct LogRecord
+	{
+		RecordKind kind;
+		LogLayout layout;
+		bool heater;
+		double timebase;
+		Sample sample;
+	};
+
+	void queueText(RecordKind kind, const QByteArray &text);
+	void appendText(const QByteArray &text);
+	void appendRecord(const LogRecord &record);
+	void appendSample(const LogRecord &record);
+	void flushHeld(void);
+	bool writeBlock(bool flush);
+	void syncFile(void);
+
+	// binary group commit
+	void checksum(const char *data, qint64 length);
+	void commitGroup(void);
+	static qint64 repairCsvTail(const QString &fileName);
+
+	// segment files
+	bool isRotating(void) const { return rotateBytes || rotateBoundary != LogRotation::NONE || rotateOnRequest; }
+	bool openSegment(void);
+	void closeSegment(const QString &reason);
+	void rotateSegment(const QString &reason);
+	void nextBoundary(void);
+	QString segmentFileName(void) const;
+	QString manifestFileName(void) const;
+	static void compressSegment(QString fileName, QString manifestName);
+	static void updateManifest(const QString &manifestName, const QStringList &entry);
+
+	QString baseName;	// as chosen by the user
+	QFile file;
+	SampleRing<LogRecord, QUEUE_SIZE> ring;
+	QMutex textMutex;
+	QQueue<QByteArray> textQueue;
+	QMutex waitMutex;
+	QWaitCondition wake;
+
+	// block being filled by the writer thread
+	std::unique_ptr<char[]> block;
+	int blockLength;
+	qint64 unflushedBytes;
+	int unflushedRecords;
+	QElapsedTimer sinceFlush;
+	qint64 filePosition;	// of the end of the block
+
+	// group being checksummed (binary)
+	quint32 groupCrc;
+	qint64 groupBytes;
+	quint32 groupSamples;
+	int checksummed;		// bytes of the block already in groupCrc
+
+	// binary segment state
+	qint64 segmentOffset;
+	quint32 segmentRecords;
+
+	// rotation policy and present segment
+	qint64 rotateBytes;			// 0 for none
+	LogRotation rotateBoundary;
+	bool rotateOnRequest;
+	bool compressSegments;
+	qint64 boundaryTime;		// ms since epoch of the next wall-clock boundary
+	qint64 segmentStart;		// file position after the re-emitted header
+	qint64 firstSampleTime;		// ms, -1 until the first sample
+	qint64 lastSampleTime;
+	quint64 segmentSamples;
+	QByteArray lastText;		// CSV session line
+	QByteArray lastHeader;
+
+	LogFormat format;
+
+	// sample compression (writer thread)
+	LogCompressor compressor;
+	LogRecord held;			// newest sample, not yet known to be needed
+	bool holding;
+
+	// flush policy
+	int flushInterval;		// ms, 0 for none
+	int flushRecords;		// 0 for none
+	qint64 flushBytes;		// 0 for none
+	bool syncToDisk;		// flush through to the disk, not just the OS
+
+	std::atomic<bool> stopping;
+	std::atomic<quint64> droppedRecords;
+	std::atomic<quint64> droppedText;	// text, header and rotate records
+	std::atomic<int> highWaterMark;
+	std::atomic<quint64> bytesWritten;
+	std::atomic<qint64> repairedBytes;
+	std::atomic<bool> writeError;
+};
+
+#endif // LOGWRITER_H
@@ -821,7 +821,12 @@ void magnetdaq::goToSelectedTableEntry(void)
 	{
 		if (socket->isConnected())
 		{
+			// need the present state reply before deciding
 			socket->getState();
+			socket->waitForIdle(2000);
+
+			if (connectionLost())
+				return;
 
 			if (model430.state() < State::QUENCH || model430.state() == State::AT_ZERO || model430.state() == State::ZEROING)
 			{
@@ -856,7 +861,12 @@ void magnetdaq::goToNextTableEntry(void)
 	{
 		if (socket->isConnected())
 		{
+			// need the present state reply before deciding
 			socket->getState();
+			socket->waitForIdle(2000);
+
+			if (connectionLost())
+				return;
 
 			if (model430.state() < State::QUENCH || model430.state() == State::AT_ZERO || model430.state() == State::ZEROING)
 			{
@@ -922,7 +932,7 @@ void magnetdaq::sendNextTarget(double target)
 	{
 		// calculate ramping time
 		targetValue = target;
-		remainingTime = calculateRampingTime(target, model430.magnetCurrent);
+		remainingTime = calculateRampingTime(target, model430.liveState().magnetCurrent);
 
 		// send down command
 		socket->sendCommand("CONF:CURR:TARG " + QString::number(target, 'g', 10) + "\r\n");
@@ -935,7 +945,7 @@ void magnetdaq::sendNextTarget(double target)
 	{
 		// calculate ramping time
 		targetValue = target / model430.coilConstant();
-		remainingTime = calculateRampingTime(targetValue, model430.magnetCurrent);
+		remainingTime = calculateRampingTime(targetValue, model430.liveState().magnetCurrent);
 
 		socket->sendCommand("CONF:FIELD:TARG " + QString::number(target, 'g', 10) + "\r\n");
 		model430.targetField = target;
@@ -1073,7 +1083,7 @@ void magnetdaq::manualCtrlTimerTick(void)
 			manualCtrlTimer->stop();
 
 			// mark target line as "Fail" after quench display updates (quenchPassCnt > 1)
-			markTableSelectionAsFail(presentTableValue, model430.quenchCurrent);
+			markTableSelectionAsFail(presentTableValue, model430.liveState().quenchCurrent);
 		}
 	}
 
@@ -1261,6 +1271,10 @@ bool magnetdaq::goToTableSelection(int rowIndex, bool makeTarget)
 					sendNextTarget(temp);
 					lastTableValue = rowIndex;
 
+					// optionally log each table row to its own segment
+					if (logWriter)
+						logWriter->rotate();
+
 					if (autostepTimer->isActive())
 					{
 						lastStatusMiscString = "Auto-Stepping : Table Row #" + QString::number(rowIndex + 1);
@@ -1320,7 +1334,7 @@ void magnetdaq::autostepRangeChanged(void)
 void magnetdaq::calculateAutostepRemainingTime(int startIndex, int endIndex)
 {
 	autostepRemainingTime = 0;
-	double currentValue = model430.magnetCurrent;
+	double currentValue = model430.liveState().magnetCurrent;
 
 	if (startIndex < autostepStartIndex || endIndex > autostepEndIndex)	// out of range
 		return;
@@ -1393,7 +1407,12 @@ void magnetdaq::startAutostep(void)
 	{
 		if (socket->isConnected())
 		{
+			// need the present state reply before deciding
 			socket->getState();
+			socket->waitForIdle(2000);
+
+			if (connectionLost())
+				return;
 
 			if (model430.state() < State::QUENCH || model430.state() == State::AT_ZERO || model430.state() == State::ZEROING)
 			{
@@ -1423,7 +1442,7 @@ void magnetdaq::startAutostep(void)
 					{
 						showErrorString("Python not found at specified path!", true);
 					}
-					else if (model430.switchInstalled() && !model430.switchHeaterState)
+					else if (model430.switchInstalled() && !model430.liveState().switchHeaterState)
 					{
 						showErrorString("Cannot ramp to target current or field with cooled switch!", true);
 						lastStatusMiscString.clear();
@@ -1555,12 +1574,12 @@ void magnetdaq::autostepTimerTick(void)
 			{
 				if (elapsedTimerTicks == 0)
 				{
-					if (model430.switchHeaterState)	// heater is ON
+					if (model430.liveState().switchHeaterState)	// heater is ON
 					{
 						settlingTime++;
 
 						// wait for settling time and magnetVoltage to decay
-						if (settlingTime >= SETTLING_TIME && fabs(model430.magnetVoltage) < 0.01)
+						if (settlingTime >= SETTLING_TIME && fabs(model430.liveState().magnetVoltage) < 0.01)
 						{
 							/////////////////////
 							// enter persistence
@@ -1622,7 +1641,7 @@ void magnetdaq::autostepTimerTick(void)
 					{
 						if (ui.tableWidget->item(presentTableValue, 1)->checkState() == Qt::Checked)
 						{
-							if (!model430.switchHeaterState)	// heater is OFF, persistent
+							if (!model430.liveState().switchHeaterState)	// heater is OFF, persistent
 							{
 								////////////////////
 								// exit persistence
@@ -1752,7 +1771,7 @@ void magnetdaq::recalculateRemainingTime(void)
 	if (autostepTimer->isActive())
 		calculateAutostepRemainingTime(presentTableValue + 1, autostepEndIndex);
 	else if (manualCtrlTimer->isActive())
-		remainingTime = calculateRampingTime(targetValue, model430.magnetCurrent);
+		remainingTime = calculateRampingTime(targetValue, model430.liveState().magnetCurrent);
 	else
 		autostepRangeChanged();
 }
@@ -1954,11 +1973,11 @@ void magnetdaq::executeApp(void)
 		QString testString = arguments[i].toUpper();
 
 		if (testString == "%CURR:MAG%" || testString == "$CURR:MAG")
-			arguments[i] = QString::number(avoidSignedZeroOutput(model430.magnetField, precision), 'g', precision);
+			arguments[i] = QString::number(avoidSignedZeroOutput(model430.liveState().magnetField, precision), 'g', precision);
 		else if (testString == "%CURR:REF%" || testString == "$CURR:REF")
-			arguments[i] = QString::number(avoidSignedZeroOutput(model430.referenceCurrent, precision), 'g', precision);
+			arguments[i] = QString::number(avoidSignedZeroOutput(model430.liveState().referenceCurrent, precision), 'g', precision);
 		else if (testString == "%FIELD:MAG%" || testString == "$FIELD:MAG")
-			arguments[i] = QString::number(avoidSignedZeroOutput(model430.magnetField, precision), 'g', precision);
+			arguments[i] = QString::number(avoidSignedZeroOutput(model430.liveState().magnetField, precision), 'g', precision);
 		else if (testString == "%TARG:CURR%" || testString == "$TARG:CURR")
 			arguments[i] = QString::number(avoidSignedZeroOutput(model430.targetCurrent(), precision), 'g', precision);
 		else if (testString == "%TARG:FIELD%" || testString == "$TARG:FIELD")
@@ -15,6 +15,20 @@ const int MIN_WINDOW_HEIGHT_COLLAPSED = 220;
 const int MIN_WINDOW_HEIGHT_COLLAPSED = 210;
 #endif
 
+// backstop wait for each connect-time sync step (ms), queries time out individually
+const int CONNECT_SYNC_TIMEOUT = 10000;
+
+// backstop wait for the settings dump that validates the configuration cache (ms)
+const int CACHE_SAVE_TIMEOUT = 5000;
+
+// settings keys and default error bounds (logged units) for compressed data logs
+static const char *compressionBoundKeys[LogCompressor::CHANNELS] =
+{
+	"Field", "Current", "Voltage", "SupplyCurrent", "SupplyVoltage", "RefCurrent"
+};
+
+const double COMPRESSION_BOUNDS[LogCompressor::CHANNELS] = { 1.0e-5, 1.0e-4, 1.0e-3, 1.0e-4, 1.0e-3, 1.0e-4 };
+
 
 //---------------------------------------------------------------------------
 // Constructor
@@ -29,6 +43,7 @@ magnetdaq::magnetdaq(QWidget *parent)
 	QFontDatabase::addApplicationFont(":/magnetdaq/Resources/AMIBubbledotFinePositive.otf");	// family: AMI's custom Bubbledot Fine Positive
 #endif
 	qRegisterMetaType<QueryState>("QueryState");
+	qRegisterMetaType<Sample>("Sample");
 
 	ui.setupUi(this);
 
@@ -93,16 +108,23 @@ magnetdaq::magnetdaq(QWidget *parent)
 	-z	Label the Magnet-DAQ window as "Z Axis" and superimpose
 		a Z on the app icon.
 	-p	Start the stdin/stdout parser function (for QProcess use).
+	-s name	Serve the parser commands to local clients on socket
+		(named pipe) <name>, alongside or without -p.
 
 	-a address		Start and auto-connect to IP address.
 	--port xxxx		Connect to specified port (for simulation use only)
 	--telnet xxxx	Echo display to specified port (for simulation use only)
+	--export-csv file.mdl	Convert a binary log to CSV and exit
+		(handled in main(), before the window is created)
 	************************************************************/
 
 	// init states
 	parserErrorStatusIsActive.store(false);
 	errorStatusIsActive.store(false);
 	parser = nullptr;	// stdin parser
+	controlServer = nullptr;
+	parserSubscribers = 0;
+	configurationSynced = false;
 #if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
 	ftp = nullptr;
 #endif
@@ -157,6 +179,18 @@ magnetdaq::magnetdaq(QWidget *parent)
 		QCoreApplication::translate("main", "Enable stdin parsing for interprocess communication."));
 	cmdLineParse.addOption(parsingOption);
 
+	// A local control server option with a value (-s, --server)
+	QCommandLineOption serverOption(QStringList() << "s" << "server",
+		QCoreApplication::translate("main", "Serve the parser commands to local clients on socket <name>."),
+		QCoreApplication::translate("main", "name"));
+	cmdLineParse.addOption(serverOption);
+
+	// Binary log conversion (--export-csv), listed here for --help only
+	QCommandLineOption exportOption("export-csv",
+		QCoreApplication::translate("main", "Convert binary <log> to CSV (as <log>.csv, or the first argument) and exit."),
+		QCoreApplication::translate("main", "log"));
+	cmdLineParse.addOption(exportOption);
+
 	// Process the actual command line arguments given by the user
 	cmdLineParse.process(*(QCoreApplication::instance()));
 
@@ -194,6 +228,7 @@ magnetdaq::magnetdaq(QWidget *parent)
 	// hidden start and parsing function options
 	startHidden = cmdLineParse.isSet(hiddenOption);
 	parseInput = cmdLineParse.isSet(parsingOption);
+	serverName = cmdLineParse.value(serverOption);
 
 	// restore window position and gui state
 	QSettings settings;
@@ -239,6 +274,35 @@ magnetdaq::magnetdaq(QWidget *parent)
 	ui.ipNameEdit->setText(settings.value(axisStr + "IPName", "").toString());
 	ui.logFileEdit->setText(settings.value(axisStr + "Logfile", "").toString());
 	ui.remoteLockoutCheckBox->setChecked(settings.value(axisStr + "RemoteLockout", false).toBool());
+	ui.maxSampleRateSpinBox->setValue(settings.value(axisStr + "MaxSampleRate", 10).toInt());
+
+	// data log flush policy (no GUI), 0 disables that trigger
+	logFlushInterval = settings.value(axisStr + "Log/FlushInterval", 1000).toInt();
+	logFlushRecords = settings.value(axisStr + "Log/FlushRecords", 0).toInt();
+	logFlushBytes = settings.value(axisStr + "Log/FlushBytes", 0).toLongLong();
+	logSyncToDisk = settings.value(axisStr + "Log/SyncToDisk", false).toBool();
+
+	// log rotation (no GUI), any rule splits the log into segment files
+	logRotateSizeMB = settings.value(axisStr + "Log/RotateSizeMB", 0).toInt();
+	logRotateInterval = (LogRotation)settings.value(axisStr + "Log/RotateInterval", (int)LogRotation::NONE).toInt();
+	logRotateOnTableRow = settings.value(axisStr + "Log/RotateOnTableRow", false).toBool();
+	logCompressSegments = settings.value(axisStr + "Log/CompressSegments", true).toBool();
+
+	// sample compression (no GUI): 0 off, 1 deadband, 2 swinging door
+	logSampleCompression = (LogCompressor::Mode)settings.value(axisStr + "Log/SampleCompression", (int)LogCompressor::OFF).toInt();
+	logCompressionMaxInterval = settings.value(axisStr + "Log/CompressionMaxInterval", 60000).toInt();
+
+	for (int i = 0; i < LogCompressor::CHANNELS; i++)
+		logCompressionBounds[i] = settings.value(axisStr + "Log/Bound/" + compressionBoundKeys[i], COMPRESSION_BOUNDS[i]).toDouble();
+
+	// event capture (no GUI)
+	eventCapture = new EventCapture(this);
+	eventCapture->setEnabled(settings.value(axisStr + "Capture/Enabled", false).toBool());
+	capturePreWindow = settings.value(axisStr + "Capture/PreTriggerMsecs", 10000).toInt();
+	capturePostWindow = settings.value(axisStr + "Capture/PostTriggerMsecs", 10000).toInt();
+	captureVoltageThreshold = settings.value(axisStr + "Capture/VoltageThreshold", 0.0).toDouble();
+	eventCapture->setWindows(capturePreWindow, capturePostWindow);
+	eventCapture->setVoltageThreshold(captureVoltageThreshold);
 
 	// no context menu for toolbar or dock widgets
 	ui.mainToolBar->setContextMenuPolicy(Qt::PreventContextMenu);
@@ -248,7 +312,8 @@ magnetdaq::magnetdaq(QWidget *parent)
 	socket = nullptr;
 	telnet = nullptr;
 	lastPath = "";
-	logFile = nullptr;
+	logWriter = nullptr;
+	loadedRuns = 0;
 	upgradeWizard = nullptr;
 	errorCode = NO_ERROR;
 	errorstackDlg = nullptr;
@@ -263,9 +328,22 @@ magnetdaq::magnetdaq(QWidget *parent)
 	setupRampRateArrays();
 	setupRampdownArrays();
 
+	// event capture boosts acquisition while it runs
+	connect(eventCapture, SIGNAL(rateBoost(bool)), this, SLOT(eventCaptureRateBoost(bool)));
+	connect(eventCapture, SIGNAL(captureSaved(QString)), this, SLOT(eventCaptureSaved(QString)));
+
+	// a new quench in the status byte triggers a capture, after the reply is handled
+	model430.statusByte.on_change().connect([this, last = (unsigned char)0](unsigned char val) mutable
+	{
+		if ((val & QUENCH_EVENT) && !(last & QUENCH_EVENT))
+			QMetaObject::invokeMethod(eventCapture, [this]() { eventCapture->trigger("status byte quench"); }, Qt::QueuedConnection);
+
+		last = val;
+	});
+
 	// connect toolbar actions
 	connect(ui.actionRun, SIGNAL(triggered()), this, SLOT(actionRun()));
-	connect(ui.actionStop, SIGNAL(triggered()), this, SLOT(actionStop()));
+	connect(ui.actionStop, SIGNAL(triggered()), this, SLOT(stopClicked()));
 	connect(ui.actionSetup, SIGNAL(triggered()), this, SLOT(actionSetup()));
 	connect(ui.actionPrint, SIGNAL(triggered()), this, SLOT(actionPrint()));
 	connect(ui.actionHelp, SIGNAL(triggered()), this, SLOT(actionHelp()));
@@ -278,7 +356,7 @@ magnetdaq::magnetdaq(QWidget *parent)
 	// restore device list in Setup
 	restoreDeviceList(&settings);
 
-	// create plotTimer
+	// create plotTimer, data is acquired on the I/O thread and only plotted here
 	plotTimer = new QTimer(this);
 
 	if (parseInput)
@@ -288,20 +366,22 @@ magnetdaq::magnetdaq(QWidget *parent)
 	else
 	{
 #if defined(Q_OS_LINUX) || defined(Q_OS_MACOS)
-		// For Linux and macOS, setting the plotTimer data collection rate too high results
-		// in a lagging user interface. On the Mac, the display can go long periods
-		// without a refresh. Limit the max update rate here to keep the interface responsive.
+		// For Linux and macOS, replotting too often results in a lagging user
+		// interface. On the Mac, the display can go long periods without a refresh.
+		// Limit the max update rate here to keep the interface responsive.
 		plotTimer->setInterval(200);	// 5 updates per second max rate on Linux/macOS
 #else
-		// Windows seems to give preference to the user interface updates at the
-		// expense of slowing the plotTimer data collection rate, so we set the update
-		// rate to a higher value and let the interface dictate the actual achieved rate.
 		plotTimer->setInterval(125);	// 8 updates per second max rate on Windows
 #endif
 	}
 
 	connect(plotTimer, SIGNAL(timeout()), this, SLOT(timeout()));
 
+	// create the I/O thread for the 430 sockets, the GUI only drains acquired samples
+	ioThread = new QThread(this);
+	ioThread->setObjectName("Model430 I/O");
+	ioThread->start();
+
 	// restore plot saved settings
 	restorePlotSettings(&settings);
 
@@ -352,7 +432,7 @@ magnetdaq::magnetdaq(QWidget *parent)
 	statusError->setToolTip("Error messages, click for history");
 	statusSampleRate = new QLabel("", this);
 	statusSampleRate->setFrameStyle(QFrame::Panel | QFrame::Sunken);
-	statusSampleRate->setToolTip("Magnet data sample rate");
+	statusSampleRate->setToolTip("Magnet data sample rate and interval jitter");
 	statusSampleRate->setAlignment(Qt::AlignHCenter);
 
 	statusBar()->addPermanentWidget(statusConnectState, 1);
@@ -366,6 +446,7 @@ magnetdaq::magnetdaq(QWidget *parent)
 	// other UI signal/slot connections
 	connect(statusError, SIGNAL(clicked()), this, SLOT(actionShowErrorDialog()));
 	connect(ui.remoteLockoutCheckBox, SIGNAL(toggled(bool)), this, SLOT(remoteLockoutChanged(bool)));
+	connect(ui.maxSampleRateSpinBox, SIGNAL(valueChanged(int)), this, SLOT(sampleRateLimitChanged(int)));
 	connect(ui.ipAddressEdit, SIGNAL(textEdited(QString)), this, SLOT(ipAddressEdited(QString)));
 	connect(ui.resetGraphButton, SIGNAL(clicked(bool)), this, SLOT(resetAxes(bool)));
 	connect(ui.secondsRadioButton, SIGNAL(toggled(bool)), this, SLOT(timebaseChanged(bool)));
@@ -493,6 +574,15 @@ magnetdaq::~magnetdaq()
 		plotTimer = nullptr;
 	}
 
+	// finishes any pending socket deletions
+	if (ioThread)
+	{
+		ioThread->quit();
+		ioThread->wait();
+		delete ioThread;
+		ioThread = nullptr;
+	}
+
 #if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
 	if (ftp)
 	{
@@ -545,6 +635,25 @@ magnetdaq::~magnetdaq()
 	settings.setValue(axisStr + "Graph/Vmax", ui.vmaxEdit->text());
 	settings.setValue(axisStr + "Logfile", ui.logFileEdit->text());
 	settings.setValue(axisStr + "RemoteLockout", ui.remoteLockoutCheckBox->isChecked());
+	settings.setValue(axisStr + "MaxSampleRate", ui.maxSampleRateSpinBox->value());
+	settings.setValue(axisStr + "Log/FlushInterval", logFlushInterval);
+	settings.setValue(axisStr + "Log/FlushRecords", logFlushRecords);
+	settings.setValue(axisStr + "Log/FlushBytes", logFlushBytes);
+	settings.setValue(axisStr + "Log/SyncToDisk", logSyncToDisk);
+	settings.setValue(axisStr + "Log/RotateSizeMB", logRotateSizeMB);
+	settings.setValue(axisStr + "Log/RotateInterval", (int)logRotateInterval);
+	settings.setValue(axisStr + "Log/RotateOnTableRow", logRotateOnTableRow);
+	settings.setValue(axisStr + "Log/CompressSegments", logCompressSegments);
+	settings.setValue(axisStr + "Log/SampleCompression", (int)logSampleCompression);
+	settings.setValue(axisStr + "Log/CompressionMaxInterval", logCompressionMaxInterval);
+
+	for (int i = 0; i < LogCompressor::CHANNELS; i++)
+		settings.setValue(axisStr + "Log/Bound/" + compressionBoundKeys[i], logCompressionBounds[i]);
+
+	settings.setValue(axisStr + "Capture/Enabled", eventCapture->isEnabled());
+	settings.setValue(axisStr + "Capture/PreTriggerMsecs", capturePreWindow);
+	settings.setValue(axisStr + "Capture/PostTriggerMsecs", capturePostWindow);
+	settings.setValue(axisStr + "Capture/VoltageThreshold", captureVoltageThreshold);
 	settings.setValue(axisStr + "Graph/UseSeconds", ui.secondsRadioButton->isChecked());
 	settings.setValue(axisStr + "Graph/AutoscrollX", ui.autoscrollXCheckBox->isChecked());
 
@@ -580,6 +689,10 @@ magnetdaq::~magnetdaq()
 	settings.setValue(axisStr + "Graph/PlotMagnetVoltage", ui.magnetVoltageCheckBox->isChecked());
 	settings.setValue(axisStr + "Graph/PlotSupplyCurrent", ui.supplyCurrentCheckBox->isChecked());
 	settings.setValue(axisStr + "Graph/PlotSupplyVoltage", ui.supplyVoltageCheckBox->isChecked());
+	settings.setValue(axisStr + "Graph/RetentionPoints", plotRetentionPoints);
+	settings.setValue(axisStr + "Graph/RetentionMinutes", plotRetentionMinutes);
+	settings.setValue(axisStr + "Graph/RetentionHistory", plotRetentionHistory);
+	settings.setValue(axisStr + "Graph/MaxFrameRate", plotMaxFrameRate);
 
 	// save support settings
 	settings.setValue(axisStr + "Support/Subject", ui.caseEdit->text());
@@ -610,6 +723,8 @@ void magnetdaq::actionRun(void)
 	statusConnectState->clear();
 	ui.droppedConnectionLabel->clear();
 	clearErrorHistory();
+	configurationSynced = false;
+	model430.markStale(ALL_SYNC);	// nothing shown is known to match this connection
 
 	if (errorstackDlg)
 		errorstackDlg->clearErrorListWidget();
@@ -625,6 +740,7 @@ void magnetdaq::actionRun(void)
 
 	// use the port 7180 (default) socket to collect high-speed data queries
 	socket = new Socket(&model430, this);
+	socket->moveToThread(ioThread);
 
 	if (ui.noProxyRadioButton->isChecked())
 		socket->connectToModel430(ui.ipAddressEdit->text(), port, QNetworkProxy::NoProxy);
@@ -640,11 +756,16 @@ void magnetdaq::actionRun(void)
 		plotCount = 0;
 		// clear data
 		for (int i = 0; i < 6; i++)
-			ui.plotWidget->graph(i)->data()->clear();
-		ui.plotWidget->replot();
+			clearLiveGraph(i);
+		requestPlotReplot();
 
 		// query firmware version and suffix
 		socket->getFirmwareVersion();
+		socket->waitForIdle(CONNECT_SYNC_TIMEOUT);
+
+		if (connectionLost())
+			return;
+
 		ui.serialNumEdit->setText(model430.serialNumber());
 
 		// check for required firmware update
@@ -654,15 +775,18 @@ void magnetdaq::actionRun(void)
 			if (!supports_AMITRG())
 				socket->sendCommand("*ETE 151\r\n");
 
-			// connect the socket data ready signal to the plot
-			connect(socket, SIGNAL(nextDataPoint(qint64, double, double, double, double, double, double, quint8, quint8)),
-				this, SLOT(addDataPoint(qint64, double, double, double, double, double, double, quint8, quint8)));
-			
+			// connect achieved sample rate reporting
+			connect(socket, SIGNAL(acquisitionStats(double, double, double)), this, SLOT(acquisitionStatsUpdated(double, double, double)));
+
+			// samples pushed to a parser subscriber, written out from this thread
+			connect(socket, SIGNAL(sampleAcquired(Sample)), this, SLOT(streamSample(Sample)), Qt::QueuedConnection);
+
 			// connect error signals
 			connect(socket, SIGNAL(model430Disconnected()), this, SLOT(actionStop()));
 			connect(socket, SIGNAL(systemErrorMessage(QString, QString)), this, SLOT(displaySystemError(QString, QString)), Qt::ConnectionType::QueuedConnection);
 
 			// query 430 mode (s2 state), sets up interface for short-sample mode if needed
+			socket->beginBatch();
 			socket->getMode();
 
 			// query 430 status
@@ -670,6 +794,13 @@ void magnetdaq::actionRun(void)
 
 			// query 430 ipName
 			socket->getIpName();
+			socket->endBatch();
+
+			// wait for the replies before syncing setup pages
+			socket->waitForIdle(CONNECT_SYNC_TIMEOUT);
+
+			if (connectionLost())
+				return;
 
 			// lockout front panel if preferred
 			if (ui.remoteLockoutCheckBox->isChecked())
@@ -681,68 +812,88 @@ void magnetdaq::actionRun(void)
 			// connect signal for configuration changes
 			connect(&model430, SIGNAL(configurationChanged(QueryState)), this, SLOT(configurationChanged(QueryState)));
 
-			// initialize the 430 configuration GUI, show progress dialog and checking for cancellation
-			model430.syncSupplySetup();
+			// initialize the 430 configuration GUI, all configuration queries are
+			// written in one burst and decoded as the replies stream back
+			QElapsedTimer syncTimer;
+			syncTimer.start();
+
+			// a configuration cached at the end of the last session with this unit
+			// is used instead if a fresh SETTINGS? dump shows nothing has changed
+			bool usedCache = false;
 
-			if (!startHidden)
 			{
-				progressDialog.setValue(20);
-				if (progressDialog.wasCanceled())
-					actionStop();
-				QApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
-			}
+				QSettings settings;
 
-			model430.syncLoadSetup();
+				if (model430.hasCachedConfiguration(&settings))
+				{
+					model430.setSettings(QString());
+					socket->sendExtendedQuery("SETTINGS?\r\n", QueryState::SETTINGS, 4); // 4 second time limit on reply
+					socket->waitForIdle(CONNECT_SYNC_TIMEOUT);
 
-			if (!startHidden)
-			{
-				progressDialog.setValue(40);
-				if (progressDialog.wasCanceled())
-					actionStop();
-				QApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+					if (connectionLost())
+						return;
+
+					usedCache = model430.restoreCachedConfiguration(&settings);
+				}
 			}
 
-			model430.syncSwitchSetup();
+			socket->beginBatch();
 
-			if (!startHidden)
-			{
-				progressDialog.setValue(60);
-				if (progressDialog.wasCanceled())
-					actionStop();
-				QApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
-			}
+			if (usedCache)
+				model430.syncVolatileValues();
+			else
+				model430.sync();
 
-			model430.syncProtectionSetup();
+			model430.syncEventCounts();
+			socket->endBatch();
 
-			if (!startHidden)
+			int syncQueries = socket->queriesOutstanding();
+
+			// show progress dialog and check for cancellation while waiting
+			while (!socket->isIdle() && syncTimer.elapsed() < CONNECT_SYNC_TIMEOUT)
 			{
-				progressDialog.setValue(80);
-				if (progressDialog.wasCanceled())
-					actionStop();
-				QApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
-			}
+				socket->waitForIdle(50);
 
-			model430.syncEventCounts();
+				if (connectionLost())
+					return;
 
-			if (!startHidden)
+				if (!startHidden)
+				{
+					// chained queries (ramp segments) may add to the total
+					syncQueries = qMax(syncQueries, socket->queriesOutstanding());
+
+					if (syncQueries)
+						progressDialog.setValue(100 - (100 * socket->queriesOutstanding()) / syncQueries);
+
+					if (progressDialog.wasCanceled())
+					{
+						actionStop();
+						return;
+					}
+				}
+			}
+
+			// report total sync time
+			qint64 syncTime = syncTimer.elapsed();
+			if (usedCache)
 			{
-				progressDialog.setValue(85);
-				if (progressDialog.wasCanceled())
-					actionStop();
-				QApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+				qDebug() << "Cached configuration validated in " << syncTime << " ms";
+				setStatusMsg("Configuration restored from cache in " + QString::number(syncTime) + " ms");
+			}
+			else
+			{
+				qDebug() << "Configuration sync completed in " << syncTime << " ms";
+				setStatusMsg("Configuration read in " + QString::number(syncTime) + " ms");
 			}
 
-			model430.syncRampRates();
+			configurationSynced = true;
 
 			if (!startHidden)
-			{
 				progressDialog.setValue(100);
-				if (progressDialog.wasCanceled())
-					actionStop();
-			}
 
 			// use the port 23 (default) telnet socket for configuration and keypad simulation
 			telnet = new Socket(&model430, this);
+			telnet->moveToThread(ioThread);
 
 			// capture display/keypad broadcasts
 			if (ui.noProxyRadioButton->isChecked())
@@ -781,10 +932,8 @@ void magnetdaq::actionRun(void)
 				ui.deleteDeviceButton->setEnabled(false);
 				mainTabChanged(-1);
 
-				// start the plot timer to get data points at regular interval
-				samplePos = 0; // restarts sample rate averaging
+				// start the plot timer to plot data points at regular interval
 				startTime = QDateTime::currentMSecsSinceEpoch();
-				lastTime = startTime;
 
 				// reset timebase
 				if (ui.autoscrollXCheckBox->isChecked())
@@ -801,18 +950,14 @@ void magnetdaq::actionRun(void)
 					ui.referenceCheckBox->setChecked(false);
 				}
 
-				// support higher data rate if version 4.0 or higher due to new CPU (isARM)
-#if defined(Q_OS_LINUX) || defined(Q_OS_MACOS)
-				// placeholder
-#else
-				// Windows seems to give preference to the user interface updates at the
-				// expense of slowing the plotTimer data collection rate, so we set the update
-				// rate to a higher value and let the interface dictate the actual achieved rate.
-				if (isARM() && !parseInput)
-					plotTimer->setInterval(100);	// 10 updates per second max rate on Windows
-#endif
 				plotTimer->start();
 
+				// acquisition adapts to the rate the 430 sustains, 1 Hz if a QProcess slave
+				if (parseInput)
+					socket->startSampling(1);
+				else
+					socket->startSampling(ui.maxSampleRateSpinBox->value());
+
 				// enable table functions
 				ui.manualControlGroupBox->setEnabled(true);
 				ui.autoStepGroupBox->setEnabled(true);
@@ -826,15 +971,37 @@ void magnetdaq::actionRun(void)
 
 				if (!ui.logFileEdit->text().isEmpty())
 				{
-					// good connections to this point, create log file
-					logFile = new QFile(ui.logFileEdit->text());
-					logFile->open(QFile::Append);
-
-					// write date/time of start
-					logFile->write("\n");
-					logFile->write(QDateTime::currentDateTime().toString("MM/dd/yyyy: hh:mm:ss ap").toLatin1());
-					logFile->write("\n");
-					logFile->flush();
+					// good connections to this point, start the log writer
+					logWriter = new LogWriter(ui.logFileEdit->text());
+					logWriter->setFormat(BinaryLog::isBinaryLogFile(ui.logFileEdit->text()) ? LogFormat::BINARY : LogFormat::CSV);
+					logWriter->setFlushPolicy(logFlushInterval, logFlushRecords, logFlushBytes, logSyncToDisk);
+					logWriter->setRotationPolicy((qint64)logRotateSizeMB * 1024 * 1024, logRotateInterval, logRotateOnTableRow, logCompressSegments);
+					logWriter->setCompression(logSampleCompression, logCompressionBounds, logCompressionMaxInterval);
+					logWriter->start(QThread::LowPriority);
+
+					// write date/time of start (binary logs carry it in each segment header)
+					logSessionStart = QDateTime::currentDateTime().toString("MM/dd/yyyy: hh:mm:ss ap");
+
+					QString sessionLine = logSessionStart;
+
+					if (logSyncToDisk)
+						sessionLine += " (max data loss: " + logWriter->lossWindow() + ")";
+
+					if (logWriter->isCompressing())
+						sessionLine += " (compressed: " + logWriter->compressionDescription() + ")";
+
+					logWriter->writeText("\n" + sessionLine.toLatin1() + "\n");
+				}
+
+				// event captures go beside the log, or to Documents without one
+				if (ui.logFileEdit->text().isEmpty())
+				{
+					eventCapture->setFileStem(QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + "/MagnetDAQ" + axisStr.left(1));
+				}
+				else
+				{
+					QFileInfo logInfo(ui.logFileEdit->text());
+					eventCapture->setFileStem(logInfo.path() + "/" + logInfo.completeBaseName());
 				}
 
 				// add/update device in list and update window title bar
@@ -853,6 +1020,7 @@ void magnetdaq::actionRun(void)
 					parser->moveToThread(parserThread);
 					connect(parser, SIGNAL(error_msg(QString)), this, SLOT(parserErrorString(QString)));
 					connect(parser, SIGNAL(exit_app()), this, SLOT(exit_app()));
+					connect(parser, SIGNAL(subscriptionChanged(bool)), this, SLOT(parserSubscriptionChanged(bool)));
 					connect(parserThread, SIGNAL(started()), parser, SLOT(process()));
 					connect(parser, SIGNAL(finished()), parserThread, SLOT(quit()));
 					connect(parser, SIGNAL(finished()), parser, SLOT(deleteLater()));
@@ -860,6 +1028,20 @@ void magnetdaq::actionRun(void)
 					parserThread->start();
 				}
 
+				// start local control server if enabled
+				if (!serverName.isEmpty())
+				{
+					controlServer = new ControlServer(&model430, this);
+					connect(controlServer, SIGNAL(subscriptionChanged(bool)), this, SLOT(parserSubscriptionChanged(bool)));
+
+					if (!controlServer->listen(serverName))
+					{
+						showErrorString("Cannot serve local clients on " + serverName + ": " + controlServer->errorString(), true);
+						delete controlServer;
+						controlServer = nullptr;
+					}
+				}
+
 				// check switch installed state change and clear table if needed
 				{
 					static bool lastSwitchInstalledValue = false;	// retain between calls
@@ -967,12 +1149,29 @@ void magnetdaq::actionStop(void)
 		parser = nullptr;
 	}
 
+	// close the local control server and its client connections
+	if (controlServer)
+	{
+		delete controlServer;
+		controlServer = nullptr;
+	}
+
+	if (parserSubscribers)
+	{
+		if (socket)
+			socket->setSampleStreaming(false);
+
+		parserSubscribers = 0;
+	}
+
 	// stop any active table auto-stepping
 	stopAutostep();
 
 	// stop plotting
 	plotTimer->stop();
 
+	configurationSynced = false;
+
 	// close all 430 connections
 	if (socket)
 	{
@@ -988,12 +1187,15 @@ void magnetdaq::actionStop(void)
 		telnet = nullptr;
 	}
 
-	if (logFile)
+	// saves any capture in progress
+	eventCapture->reset();
+
+	if (logWriter)
 	{
-		logFile->flush();
-		logFile->close();
-		delete logFile;
-		logFile = nullptr;
+		// writes everything still queued before closing
+		logWriter->stop();
+		delete logWriter;
+		logWriter = nullptr;
 	}
 
 	ui.actionRun->setEnabled(true);
@@ -1025,6 +1227,58 @@ void magnetdaq::actionStop(void)
 	ui.droppedConnectionLabel->setText("Emulated display/keypad not presently connected to a remote device.");
 }
 
+//---------------------------------------------------------------------------
+// The toolbar Stop, caches the configuration before disconnecting
+void magnetdaq::stopClicked(void)
+{
+	ui.actionStop->setEnabled(false);	// no second Stop while the cache is read
+	saveConfigurationCache();
+	actionStop();
+}
+
+//---------------------------------------------------------------------------
+// Caches the configuration for a faster reconnect to this unit. Reads a
+// fresh SETTINGS? dump behind any outstanding queries, so the model and the
+// digest saved with it describe the same configuration. Waits in a local
+// event loop, so only called on a user Stop or window close, never from
+// actionStop() itself (destructor, dropped connection, parser EXIT).
+void magnetdaq::saveConfigurationCache(void)
+{
+	if (!configurationSynced || !socket || !socket->isConnected())
+		return;
+
+	socket->stopSampling();
+
+	// pages changed remotely or by local writes are read back first
+	model430.syncStale(CACHED_SYNC);
+	model430.setSettings(QString());
+	socket->sendExtendedQuery("SETTINGS?\r\n", QueryState::SETTINGS, 4); // 4 second time limit on reply
+
+	bool idle = socket->waitForIdle(CACHE_SAVE_TIMEOUT);
+
+	// the connection may have dropped while waiting
+	if (idle && socket && socket->isConnected())
+	{
+		QSettings settings;
+		model430.saveCachedConfiguration(&settings);
+	}
+}
+
+//---------------------------------------------------------------------------
+// For use after a nested wait (waitForIdle()), which can run a dropped
+// connection's actionStop() and delete the socket. True if the connection
+// is gone, what is left of it is then stopped.
+bool magnetdaq::connectionLost(void)
+{
+	if (socket && socket->isConnected())
+		return false;
+
+	if (socket)
+		actionStop();
+
+	return true;
+}
+
 //---------------------------------------------------------------------------
 void magnetdaq::droppedTelnet(void)
 {
@@ -1238,6 +1492,35 @@ void magnetdaq::actionToggle_Collapse(bool checked)
 	}
 }
 
+//---------------------------------------------------------------------------
+// Catch up the main plot when it is shown again (expanded, tab selected).
+bool magnetdaq::eventFilter(QObject *watched, QEvent *event)
+{
+	if (watched == ui.plotWidget && event->type() == QEvent::Show)
+		QMetaObject::invokeMethod(this, "replotIfStale", Qt::QueuedConnection);
+
+	return QMainWindow::eventFilter(watched, event);
+}
+
+//---------------------------------------------------------------------------
+// A window close while connected caches the configuration like Stop does,
+// while the event loop still runs.
+void magnetdaq::closeEvent(QCloseEvent *event)
+{
+	saveConfigurationCache();
+	QMainWindow::closeEvent(event);
+}
+
+//---------------------------------------------------------------------------
+// Catch up the main plot when the window is restored from minimized.
+void magnetdaq::changeEvent(QEvent *event)
+{
+	if (event->type() == QEvent::WindowStateChange && !isMinimized())
+		QMetaObject::invokeMethod(this, "replotIfStale", Qt::QueuedConnection);
+
+	QMainWindow::changeEvent(event);
+}
+
 //---------------------------------------------------------------------------
 // Outputs general and parser function errors
 //---------------------------------------------------------------------------
@@ -1365,7 +1648,7 @@ void magnetdaq::chooseLogfile(bool checked)
 	QSettings settings;
 	lastPath = settings.value("LastLogPath").toString();
 
-	QString logFileName = QFileDialog::getSaveFileName(this, "Choose Log File", lastPath, "Log Files (*.txt *.log *.csv)");
+	QString logFileName = QFileDialog::getSaveFileName(this, "Choose Log File", lastPath, "Log Files (*.txt *.log *.csv);;Binary Log Files (*.mdl)");
 
 	if (!logFileName.isEmpty())
 	{
@@ -1386,11 +1669,53 @@ void magnetdaq::remoteLockoutChanged(bool checked)
 	}
 }
 
+//---------------------------------------------------------------------------
+void magnetdaq::sampleRateLimitChanged(int value)
+{
+	if (socket && (!parseInput || parserSubscribers > 0))
+		socket->setSampleRateLimit(value);
+}
+
+//---------------------------------------------------------------------------
+// A parser client, on stdin or the control server, subscribed to or
+// unsubscribed from samples. While any is subscribed acquisition runs at
+// the user rate rather than the 1 Hz poll of a QProcess slave.
+void magnetdaq::parserSubscriptionChanged(bool active)
+{
+	parserSubscribers = qMax(parserSubscribers + (active ? 1 : -1), 0);
+
+	if (socket)
+	{
+		socket->setSampleStreaming(parserSubscribers > 0);
+		socket->setSampleRateLimit((parseInput && parserSubscribers == 0) ? 1 : ui.maxSampleRateSpinBox->value());
+	}
+}
+
+//---------------------------------------------------------------------------
+void magnetdaq::streamSample(Sample sample)
+{
+	if (parser)
+		parser->publishSample(sample);
+
+	if (controlServer)
+		controlServer->publishSample(sample);
+}
+
 //---------------------------------------------------------------------------
 void magnetdaq::timeout(void)
 {
-	// plotTimer fired, request next data point from socket
-	socket->getNextDataPoint();
+	// plotTimer fired, plot everything acquired since the last tick
+	Sample sample;
+	bool newData = false;
+
+	while (socket->nextSample(sample))
+	{
+		addDataPoint(sample);
+		newData = true;
+	}
+
+	if (newData)
+		requestPlotReplot();
 
 	// fetch STATE? every sample if a QProcess slave
 	if (parseInput)
@@ -1461,12 +1786,12 @@ void magnetdaq::updateFrontPanel(QString displayString, bool shiftLED, bool fiel
 	if (persistentLED)
 	{
 		ui.persistentLED->setState(KLed::State::On);
-		model430.persistentState = true;
+		model430.setPersistentState(true);
 	}
 	else
 	{
 		ui.persistentLED->setState(KLed::State::Off);
-		model430.persistentState = false;
+		model430.setPersistentState(false);
 	}
 
 	if (energizedLED)
@@ -1483,9 +1808,9 @@ void magnetdaq::updateFrontPanel(QString displayString, bool shiftLED, bool fiel
 	if (!supports_AMITRG())
 	{
 		if (displayString.contains("PSwitch Heater: ON"))
-			model430.switchHeaterState = true;
+			model430.setSwitchHeaterState(true);
 		else if (displayString.contains("PSwitch Heater: OFF"))
-			model430.switchHeaterState = false;
+			model430.setSwitchHeaterState(false);
 	}
 }
 
@@ -1515,6 +1840,9 @@ void magnetdaq::displaySystemError(QString errMsg, QString errorSourceStr)
 			if (parser != nullptr)
 				parser->addSystemError(errMsg.remove("\r\n"));
 
+			if (controlServer != nullptr)
+				controlServer->addSystemError(errMsg.remove("\r\n"));
+
 			// also save to device error stack
 			if (!errMsg.isEmpty())
 				errorStack.push(errMsg.remove("\r\n"));
@@ -1576,6 +1904,8 @@ void magnetdaq::startExternalRampdown(void)
 
 	statusMisc->setStyleSheet("color: red; font: bold");
 	statusMisc->setText("External Rampdown is active. No input is allowed until completion.");
+
+	eventCapture->trigger("external rampdown");
 }
 
 //---------------------------------------------------------------------------
@@ -3,6 +3,7 @@
 
 #include <QtWidgets/QMainWindow>
 #include <QLabel>
+#include <QElapsedTimer>
 #include "ui_magnetdaq.h"
 #include "errorhistorydlg.h"
 
@@ -15,7 +16,13 @@
 #include "socket.h"
 #include "model430.h"
 #include "parser.h"
+#include "controlserver.h"
 #include "clickablelabel.h"
+#include "logwriter.h"
+#include "binarylog.h"
+#include "eventcapture.h"
+#include "logreader.h"
+#include "decimatedgraph.h"
 
 #if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
 #include <QtFtp/QtFtp>
@@ -75,6 +82,11 @@ public:
 	bool supports_AMITRG(void);
 	bool isARM(void);
 
+protected:
+	bool eventFilter(QObject *watched, QEvent *event) override;
+	void changeEvent(QEvent *event) override;
+	void closeEvent(QCloseEvent *event) override;
+
 public slots:
 	void configurationChanged(QueryState state);
 	void shortSampleModeChanged(bool isSampleMode);
@@ -83,6 +95,7 @@ public slots:
 private slots:
 	void actionRun(void);
 	void actionStop(void);
+	void stopClicked(void);
 	void droppedTelnet(void);
 	void exit_app(void);
 	void actionSetup(void);
@@ -103,6 +116,9 @@ private slots:
 	void setDeviceWindowTitle(void);
 	void chooseLogfile(bool checked);
 	void remoteLockoutChanged(bool checked);
+	void sampleRateLimitChanged(int value);
+	void parserSubscriptionChanged(bool active);
+	void streamSample(Sample sample);
 	void timeout(void);
 	void updateFrontPanel(QString, bool, bool, bool, bool, bool);
 	void systemErrorNotification();
@@ -131,10 +147,19 @@ private slots:
 	// slots for main plot
 	void restorePlotSettings(QSettings *settings);
 	void initPlot(void);
+	void applyPlotRetention(void);
+	void requestPlotReplot(void);
+	void replotIfStale(void);
+	void replotNow(void);
+	bool isPlotVisible(void);
 	void toggleAutoscrollXCheckBox(bool checked);
 	void toggleAutoscrollButton(bool checked);
-	void addDataPoint(qint64 time, double magField, double magCurrent, double magVoltage, double supCurrent, double supVoltage, double refCurrent, quint8 state, quint8 heater);
+	void addDataPoint(const Sample &sample);
+	void acquisitionStatsUpdated(double rate, double jitter, double latency);
 	void writeLogHeader(void);
+	void writeLogSample(const Sample &sample, double timebase);
+	void eventCaptureRateBoost(bool active);
+	void eventCaptureSaved(QString fileName);
 	void resetAxes(bool checked);
 	void timebaseChanged(bool checked);
 	void currentAxisSelectionChanged(bool checked);
@@ -151,6 +176,8 @@ private slots:
 	void mouseWheel();
 	void contextMenuRequest(QPoint pos);
 	void moveLegend();
+	void loadLogFile(void);
+	void clearLoadedLogs(void);
 
 	// slots for ramp rate plot
 	void restoreRampPlotSettings(QSettings *settings);
@@ -190,6 +217,8 @@ private slots:
 	void sendSupportEmailClicked(void);
 	void copySettingsToClipboard(void);
 	void saveSettingsToFile(void);
+	void refreshCommStats(void);
+	void resetCommStats(void);
 
 	// slots for 430 control
 	void persistentSwitchButtonClicked(void);
@@ -282,11 +311,16 @@ private slots:
 	void pythonCheckBoxChanged(int state);
 
 private:
+	void saveConfigurationCache(void);
+	bool connectionLost(void);
+
 	Ui::magnetdaqClass ui;
 	Model430 model430;	// contains the presently-connected 430 settings
 
 	Socket *socket;	// communicates via port 7180 to 430
 	Socket *telnet; // communicates via port 23 to 430
+	QThread *ioThread;	// socket I/O and data acquisition run here
+	bool configurationSynced;	// model holds the full 430 configuration, may be cached
 	QTimer *plotTimer;
 	qint64 startTime;
 	int plotCount;
@@ -307,9 +341,30 @@ private:
 	QString axisStr;	// label for saving/restoring axes window geometry
 	bool parseInput;	// optional stdin message parsing
 	Parser *parser;		// stdin parsing support
+	QString serverName;	// optional local control server
+	ControlServer *controlServer;	// parser commands for local clients
+	int parserSubscribers;	// parser clients receiving every sample
 
 	// log file support
-	QFile *logFile;
+	LogWriter *logWriter;	// writes the data log on its own thread
+	int logFlushInterval;	// ms
+	int logFlushRecords;
+	qint64 logFlushBytes;
+	bool logSyncToDisk;
+	int logRotateSizeMB;	// 0 for no size limit
+	LogRotation logRotateInterval;
+	bool logRotateOnTableRow;
+	bool logCompressSegments;
+	LogCompressor::Mode logSampleCompression;
+	int logCompressionMaxInterval;	// ms, 0 for none
+	double logCompressionBounds[LogCompressor::CHANNELS];
+	QString logSessionStart;	// start date/time of the run being logged
+
+	// high-rate capture around quench/rampdown events
+	EventCapture *eventCapture;
+	int capturePreWindow;		// ms
+	int capturePostWindow;		// ms
+	double captureVoltageThreshold;	// V, 0 for none
 	QString lastPath;
 
 	// main plot elements
@@ -318,13 +373,18 @@ private:
 	QCPAxis *currentAxis;
 	QCPAxis *voltageAxis;
 	QToolButton *autoscrollButton;
-
-	// main plot sample rate calculation
+	QList<QCPGraph *> loadedGraphs;	// runs loaded from log files, after the live graphs
+	int loadedRuns;
+	int plotRetentionPoints;		// per live graph, 0 for no limit
+	double plotRetentionMinutes;	// 0 for no limit
+	bool plotRetentionHistory;		// keep a decimated history of dropped samples
+	int plotMaxFrameRate;			// live replots per second, 0 for every plotTimer tick
+	QTimer *replotTimer;			// pending coalesced replot
+	QElapsedTimer lastReplot;
+	bool plotStale;					// live data arrived while the plot was not visible
+
+	// main plot selected trace
 	int selectedTrace;
-	double sampleTimes[N_SAMPLES_MOVING_AVG];
-	int samplePos;
-	double meanSampleTime;
-	qint64 lastTime;
 
 	// main plot selected trace stat calcs
 	double selTraceValues[N_SAMPLES_MOVING_AVG];
@@ -386,11 +446,11 @@ private:
 	void setupRampdownArrays(void);
 	void clearStats(void);
 	void avgSelectedTrace(double newValue);
-	void avgSampleTimes(double newValue);
 	void setTimeAxisLabel(void);
 	QString getCurrentAxisLabel(void);
 	void setCurrentAxisLabel(void);
 	void setVoltageAxisLabel(void);
+	void clearLiveGraph(int index);
 
 	// firmware upgrade wizard
 	QWizard *upgradeWizard;
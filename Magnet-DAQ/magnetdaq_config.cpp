@@ -26,30 +26,44 @@ void magnetdaq::mainTabChanged(int index)
 	else if (ui.mainTabWidget->currentIndex() == RAMP_TAB)
 	{
 		QApplication::setOverrideCursor(Qt::WaitCursor);
-		QMetaObject::invokeMethod(&model430, "syncRampRates", Qt::QueuedConnection);
+
+		// re-query only if changed remotely or by a local write since last shown
+		if (model430.isStale(RAMP_SYNC))
+			QMetaObject::invokeMethod(&model430, "syncRampRates", Qt::QueuedConnection);
+
 		QMetaObject::invokeMethod(this, "syncRampRates", Qt::QueuedConnection);
 		ui.actionPrint->setEnabled(true);
 	}
 	else if (ui.mainTabWidget->currentIndex() == RAMPDOWN_TAB)
 	{
 		QApplication::setOverrideCursor(Qt::WaitCursor);
-		QMetaObject::invokeMethod(&model430, "syncRampdownSegmentValues", Qt::QueuedConnection);
+
+		if (model430.isStale(RAMPDOWN_SYNC))
+			QMetaObject::invokeMethod(&model430, "syncRampdownSegmentValues", Qt::QueuedConnection);
+
 		QMetaObject::invokeMethod(this, "syncRampdownRates", Qt::QueuedConnection);
 		ui.actionPrint->setEnabled(true);
 	}
 	else if (ui.mainTabWidget->currentIndex() == RAMPDOWN_EVENTS_TAB)
 	{
-		refreshRampdownList();
+		if (model430.isStale(RAMPDOWN_EVENTS_SYNC))
+			refreshRampdownList();
+
 		ui.actionPrint->setEnabled(false);
 	}
 	else if (ui.mainTabWidget->currentIndex() == QUENCH_EVENTS_TAB)
 	{
-		refreshQuenchList();
+		if (model430.isStale(QUENCH_EVENTS_SYNC))
+			refreshQuenchList();
+
 		ui.actionPrint->setEnabled(false);
 	}
 	else if (ui.mainTabWidget->currentIndex() == SUPPORT_TAB)
 	{
-		refreshSupportSettings();
+		if (model430.isStale(SETTINGS_SYNC))
+			refreshSupportSettings();
+
+		refreshCommStats();
 		ui.actionPrint->setEnabled(false);
 	}
 	else
@@ -63,21 +77,21 @@ void magnetdaq::mainTabChanged(int index)
 //---------------------------------------------------------------------------
 void magnetdaq::postErrorRefresh(void)
 {
+	// the rejected value may be showing, so read back the visible page
 	if (ui.mainTabWidget->currentIndex() == CONFIG_TAB)
 	{
+		model430.markStale(SETUP_SYNC);
 		setupToolBoxChanged(ui.setupToolBox->currentIndex());
 	}
 	else if (ui.mainTabWidget->currentIndex() == RAMP_TAB)
 	{
-		QApplication::setOverrideCursor(Qt::WaitCursor);
-		QMetaObject::invokeMethod(&model430, "syncRampRates", Qt::QueuedConnection);
-		QMetaObject::invokeMethod(this, "syncRampRates", Qt::QueuedConnection);
+		model430.markStale(RAMP_SYNC);
+		mainTabChanged(RAMP_TAB);
 	}
 	else if (ui.mainTabWidget->currentIndex() == RAMPDOWN_TAB)
 	{
-		QApplication::setOverrideCursor(Qt::WaitCursor);
-		QMetaObject::invokeMethod(&model430, "syncRampdownSegmentValues", Qt::QueuedConnection);
-		QMetaObject::invokeMethod(this, "syncRampdownRates", Qt::QueuedConnection);
+		model430.markStale(RAMPDOWN_SYNC);
+		mainTabChanged(RAMPDOWN_TAB);
 	}
 }
 
@@ -88,22 +102,30 @@ void magnetdaq::setupToolBoxChanged(int index)
 
 	if (ui.setupToolBox->currentIndex() == SUPPLY_PAGE)
 	{
-		QMetaObject::invokeMethod(&model430, "syncSupplySetup", Qt::QueuedConnection);
+		if (model430.isStale(SUPPLY_SYNC))
+			QMetaObject::invokeMethod(&model430, "syncSupplySetup", Qt::QueuedConnection);
+
 		QMetaObject::invokeMethod(this, "syncSupplyTab", Qt::QueuedConnection);
 	}
 	else if (ui.setupToolBox->currentIndex() == LOAD_PAGE)
 	{
-		QMetaObject::invokeMethod(&model430, "syncLoadSetup", Qt::QueuedConnection);
+		if (model430.isStale(LOAD_SYNC))
+			QMetaObject::invokeMethod(&model430, "syncLoadSetup", Qt::QueuedConnection);
+
 		QMetaObject::invokeMethod(this, "syncLoadTab", Qt::QueuedConnection);
 	}
 	else if (ui.setupToolBox->currentIndex() == SWITCH_PAGE)
 	{
-		QMetaObject::invokeMethod(&model430, "syncSwitchSetup", Qt::QueuedConnection);
+		if (model430.isStale(SWITCH_SYNC))
+			QMetaObject::invokeMethod(&model430, "syncSwitchSetup", Qt::QueuedConnection);
+
 		QMetaObject::invokeMethod(this, "syncSwitchTab", Qt::QueuedConnection);
 	}
 	else if (ui.setupToolBox->currentIndex() == PROTECTION_PAGE)
 	{
-		QMetaObject::invokeMethod(&model430, "syncProtectionSetup", Qt::QueuedConnection);
+		if (model430.isStale(PROTECTION_SYNC))
+			QMetaObject::invokeMethod(&model430, "syncProtectionSetup", Qt::QueuedConnection);
+
 		QMetaObject::invokeMethod(this, "syncProtectionTab", Qt::QueuedConnection);
 	}
 }
@@ -112,7 +134,8 @@ void magnetdaq::setupToolBoxChanged(int index)
 void magnetdaq::remoteConfigurationChanged(int index)
 {
 	// check if we are currently showing a page with info that changed
-	// if so, then call the appropriate functions to force update
+	// if so, then call the appropriate functions to force update, other
+	// pages were marked stale by the socket and update when next shown
 	// this notification feature was added to 430 firmware in 2.66/3.16/4.00+
 
 	if (ui.mainTabWidget->currentIndex() == CONFIG_TAB)
@@ -123,9 +146,12 @@ void magnetdaq::remoteConfigurationChanged(int index)
 	else if (ui.mainTabWidget->currentIndex() == RAMP_TAB)
 	{
 		if (index == (int)RAMP_PAGE)
-		QApplication::setOverrideCursor(Qt::WaitCursor);
-		QMetaObject::invokeMethod(&model430, "syncRampRates", Qt::QueuedConnection);
-		QMetaObject::invokeMethod(this, "syncRampRates", Qt::QueuedConnection);
+			mainTabChanged(RAMP_TAB);
+	}
+	else if (ui.mainTabWidget->currentIndex() == RAMPDOWN_TAB)
+	{
+		if (index == (int)RAMP_PAGE)
+			mainTabChanged(RAMPDOWN_TAB);
 	}
 }
 
@@ -1211,9 +1237,11 @@ void magnetdaq::inductanceSenseButtonClicked(void)
 		statusMisc->setText("Inductance measurement blocks comm; observe front panel...");
 		QApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
 
-		socket->sendExtendedQuery("IND:SENSE?\r\n", QueryState::SENSE_INDUCTANCE, 10); // 10 second time limit on reply
-		QApplication::restoreOverrideCursor();
-		clearMiscDisplay();
+		socket->sendExtendedQuery("IND:SENSE?\r\n", QueryState::SENSE_INDUCTANCE, 10, [this](bool ok) // 10 second time limit on reply
+		{
+			QApplication::restoreOverrideCursor();
+			clearMiscDisplay();
+		});
 	}
 }
 
@@ -1227,9 +1255,11 @@ void magnetdaq::switchCurrentDetectionButtonClicked(void)
 		statusMisc->setText("Switch current detection blocks comm; observe front panel...");
 		QApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
 
-		socket->sendExtendedQuery("PS:AUTOD?\r\n", QueryState::AUTODETECT_SWITCH_CURRENT, 10); // 10 second time limit on reply
-		QApplication::restoreOverrideCursor();
-		clearMiscDisplay();
+		socket->sendExtendedQuery("PS:AUTOD?\r\n", QueryState::AUTODETECT_SWITCH_CURRENT, 10, [this](bool ok) // 10 second time limit on reply
+		{
+			QApplication::restoreOverrideCursor();
+			clearMiscDisplay();
+		});
 	}
 }
 
@@ -13,20 +13,26 @@ void magnetdaq::refreshRampdownList(void)
 	{
 		model430.syncEventCounts(true);
 
-		if (model430.rampdownEventsCount() > 0)
+		// event file is requested only after the count reply is in
+		socket->whenIdle([this](bool ok)
 		{
-			QApplication::setOverrideCursor(Qt::WaitCursor);
-			socket->sendExtendedQuery("RAMPDF?\r\n", QueryState::RAMPDOWN_FILE, 10); // 10 second time limit on reply
-			QApplication::restoreOverrideCursor();
-		}
-		else
-		{
-			rampdownSummaries.clear();
+			// current until the count changes again
+			model430.markSynced(RAMPDOWN_EVENTS_SYNC);
 
-			// clear widgets for no events
-			ui.rampdownListWidget->clear();
-			ui.rampdownEventTextEdit->clear();
-		}
+			if (model430.rampdownEventsCount() > 0)
+			{
+				QApplication::setOverrideCursor(Qt::WaitCursor);
+				socket->sendExtendedQuery("RAMPDF?\r\n", QueryState::RAMPDOWN_FILE, 10, [](bool ok) { QApplication::restoreOverrideCursor(); }); // 10 second time limit on reply
+			}
+			else
+			{
+				rampdownSummaries.clear();
+
+				// clear widgets for no events
+				ui.rampdownListWidget->clear();
+				ui.rampdownEventTextEdit->clear();
+			}
+		});
 	}
 }
 
@@ -99,20 +105,26 @@ void magnetdaq::refreshQuenchList(void)
 	{
 		model430.syncEventCounts(true);
 
-		if (model430.quenchEventsCount() > 0)
+		// event file is requested only after the count reply is in
+		socket->whenIdle([this](bool ok)
 		{
-			QApplication::setOverrideCursor(Qt::WaitCursor);
-			socket->sendExtendedQuery("QUF?\r\n", QueryState::QUENCH_FILE, 10); // 10 second time limit on reply
-			QApplication::restoreOverrideCursor();
-		}
-		else
-		{
-			quenchSummaries.clear();
+			// current until the count changes again
+			model430.markSynced(QUENCH_EVENTS_SYNC);
 
-			// clear widgets for no events
-			ui.quenchListWidget->clear();
-			ui.quenchEventTextEdit->clear();
-		}
+			if (model430.quenchEventsCount() > 0)
+			{
+				QApplication::setOverrideCursor(Qt::WaitCursor);
+				socket->sendExtendedQuery("QUF?\r\n", QueryState::QUENCH_FILE, 10, [](bool ok) { QApplication::restoreOverrideCursor(); }); // 10 second time limit on reply
+			}
+			else
+			{
+				quenchSummaries.clear();
+
+				// clear widgets for no events
+				ui.quenchListWidget->clear();
+				ui.quenchEventTextEdit->clear();
+			}
+		});
 	}
 }
 
@@ -53,6 +53,14 @@ void magnetdaq::restorePlotSettings(QSettings *settings)
 	ui.magnetVoltageCheckBox->setChecked(settings->value(axisStr + "Graph/PlotMagnetVoltage", true).toBool());
 	ui.supplyCurrentCheckBox->setChecked(settings->value(axisStr + "Graph/PlotSupplyCurrent", false).toBool());
 	ui.supplyVoltageCheckBox->setChecked(settings->value(axisStr + "Graph/PlotSupplyVoltage", false).toBool());
+
+	// live graph retention (no GUI), bounds memory on long runs
+	plotRetentionPoints = settings->value(axisStr + "Graph/RetentionPoints", 1000000).toInt();
+	plotRetentionMinutes = settings->value(axisStr + "Graph/RetentionMinutes", 0.0).toDouble();
+	plotRetentionHistory = settings->value(axisStr + "Graph/RetentionHistory", true).toBool();
+
+	// live replot rate limit (no GUI)
+	plotMaxFrameRate = settings->value(axisStr + "Graph/MaxFrameRate", 10).toInt();
 }
 
 //---------------------------------------------------------------------------
@@ -111,10 +119,10 @@ void magnetdaq::initPlot(void)
 	voltageAxis->setTickLabelColor(Qt::red);
 	voltageAxis->setLabelColor(Qt::red);
 
-	// create graphs for data
+	// create graphs for data, each registers itself with the plot
 
 	// magnet current graph #0
-	ui.plotWidget->addGraph(timeAxis, currentAxis);
+	new DecimatedGraph(timeAxis, currentAxis);
 	ui.plotWidget->graph(MAGNET_CURRENT_GRAPH)->setName(mainLegend[MAGNET_CURRENT_GRAPH]);
 	{
 		QPen pen = QPen(Qt::blue);
@@ -124,7 +132,7 @@ void magnetdaq::initPlot(void)
 	}
 
 	// magnet field graph #1
-	ui.plotWidget->addGraph(timeAxis, currentAxis);
+	new DecimatedGraph(timeAxis, currentAxis);
 	ui.plotWidget->graph(MAGNET_FIELD_GRAPH)->setName(mainLegend[MAGNET_FIELD_GRAPH]);
 	{
 		QPen pen = QPen(Qt::darkGreen);
@@ -135,7 +143,7 @@ void magnetdaq::initPlot(void)
 	}
 
 	// supply current graph #2
-	ui.plotWidget->addGraph(timeAxis, currentAxis);
+	new DecimatedGraph(timeAxis, currentAxis);
 	ui.plotWidget->graph(SUPPLY_CURRENT_GRAPH)->setName(mainLegend[SUPPLY_CURRENT_GRAPH]);
 	{
 		QPen pen = QPen(Qt::blue);
@@ -146,7 +154,7 @@ void magnetdaq::initPlot(void)
 	}
 
 	// magnet voltage graph #3
-	ui.plotWidget->addGraph(timeAxis, voltageAxis);
+	new DecimatedGraph(timeAxis, voltageAxis);
 	ui.plotWidget->graph(MAGNET_VOLTAGE_GRAPH)->setName(mainLegend[MAGNET_VOLTAGE_GRAPH]);
 	{
 		QPen pen = QPen(Qt::red);
@@ -157,7 +165,7 @@ void magnetdaq::initPlot(void)
 	}
 
 	// supply voltage graph #4
-	ui.plotWidget->addGraph(timeAxis, voltageAxis);
+	new DecimatedGraph(timeAxis, voltageAxis);
 	ui.plotWidget->graph(SUPPLY_VOLTAGE_GRAPH)->setName(mainLegend[SUPPLY_VOLTAGE_GRAPH]);
 	{
 		QPen pen = QPen(Qt::red);
@@ -168,7 +176,7 @@ void magnetdaq::initPlot(void)
 	}
 
 	// ramp reference graph #5 (if supported by firmware)
-	ui.plotWidget->addGraph(timeAxis, currentAxis);
+	new DecimatedGraph(timeAxis, currentAxis);
 	ui.plotWidget->graph(RAMP_REFERENCE_GRAPH)->setName("Reference Current");
 	{
 		QPen pen = QPen(Qt::black);
@@ -178,6 +186,8 @@ void magnetdaq::initPlot(void)
 		ui.plotWidget->graph(RAMP_REFERENCE_GRAPH)->selectionDecorator()->setPen(QPen(Qt::darkMagenta, 1));
 	}
 
+	applyPlotRetention();
+
 	// set default scale
 	ui.plotWidget->xAxis->setRange(ui.xminEdit->text().toDouble(), ui.xmaxEdit->text().toDouble());
 	ui.plotWidget->yAxis->setRange(ui.yminEdit->text().toDouble(), ui.ymaxEdit->text().toDouble());
@@ -254,6 +264,80 @@ void magnetdaq::initPlot(void)
 	// setup policy and connect slot for context menu popup:
 	ui.plotWidget->setContextMenuPolicy(Qt::CustomContextMenu);
 	connect(ui.plotWidget, SIGNAL(customContextMenuRequested(QPoint)), this, SLOT(contextMenuRequest(QPoint)));
+
+	// live data replots are coalesced and skipped while the plot is not visible
+	plotStale = false;
+	replotTimer = new QTimer(this);
+	replotTimer->setSingleShot(true);
+	connect(replotTimer, SIGNAL(timeout()), this, SLOT(replotNow()));
+	ui.plotWidget->installEventFilter(this);	// catch-up replot on show
+}
+
+//---------------------------------------------------------------------------
+// Sets the retention policy of the live graphs, in the present timebase.
+void magnetdaq::applyPlotRetention(void)
+{
+	double span = plotRetentionMinutes;
+
+	if (ui.secondsRadioButton->isChecked())
+		span *= 60.0;
+
+	for (int i = 0; i <= RAMP_REFERENCE_GRAPH; i++)
+		static_cast<DecimatedGraph *>(ui.plotWidget->graph(i))->setRetention(plotRetentionPoints, span, plotRetentionHistory);
+}
+
+//---------------------------------------------------------------------------
+// Is the main plot on screen? Not while collapsed, minimized (including a
+// hidden start or a Multi-Axis child), or behind another tab.
+bool magnetdaq::isPlotVisible(void)
+{
+	return ui.plotWidget->isVisible() && !isMinimized() && !ui.plotWidget->visibleRegion().isEmpty();
+}
+
+//---------------------------------------------------------------------------
+// Replot for new live data. Replots are queued to the event loop at most
+// plotMaxFrameRate times per second, and only marked stale while the plot
+// is not visible so replotIfStale() can catch up once it is.
+void magnetdaq::requestPlotReplot(void)
+{
+	if (!isPlotVisible())
+	{
+		replotTimer->stop();
+		plotStale = true;
+		return;
+	}
+
+	if (replotTimer->isActive())
+		return;	// already pending
+
+	qint64 interval = (plotMaxFrameRate > 0) ? 1000 / plotMaxFrameRate : 0;
+	qint64 elapsed = lastReplot.isValid() ? lastReplot.elapsed() : interval;
+
+	if (elapsed >= interval)
+		replotNow();
+	else
+		replotTimer->start((int)(interval - elapsed));
+}
+
+//---------------------------------------------------------------------------
+void magnetdaq::replotIfStale(void)
+{
+	if (plotStale && isPlotVisible())
+		replotNow();
+}
+
+//---------------------------------------------------------------------------
+void magnetdaq::replotNow(void)
+{
+	if (!isPlotVisible())
+	{
+		plotStale = true;
+		return;
+	}
+
+	plotStale = false;
+	lastReplot.start();
+	ui.plotWidget->replot(QCustomPlot::rpQueuedReplot);
 }
 
 //---------------------------------------------------------------------------
@@ -304,6 +388,17 @@ QString magnetdaq::getCurrentAxisLabel(void)	// minus units
 		return mainPlotYTitleCurrent;
 }
 
+//---------------------------------------------------------------------------
+// Clears a live graph's data and its decimated history, which would
+// otherwise be drawn until the next retention pass
+void magnetdaq::clearLiveGraph(int index)
+{
+	QCPGraph *graph = ui.plotWidget->graph(index);
+
+	graph->data()->clear();
+	static_cast<DecimatedGraph *>(graph)->clearHistory();
+}
+
 //---------------------------------------------------------------------------
 void magnetdaq::setCurrentAxisLabel(void)
 {
@@ -314,7 +409,7 @@ void magnetdaq::setCurrentAxisLabel(void)
 	{
 		// does magnet field already have a history?
 		if (!ui.plotWidget->graph(MAGNET_FIELD_GRAPH)->data()->isEmpty())
-			ui.plotWidget->graph(MAGNET_FIELD_GRAPH)->data()->clear();	// clear it
+			clearLiveGraph(MAGNET_FIELD_GRAPH);	// clear it
 	}
 
 	// add units
@@ -350,24 +445,33 @@ void magnetdaq::setVoltageAxisLabel(void)
 }
 
 //---------------------------------------------------------------------------
-void magnetdaq::addDataPoint(qint64 time, double magField, double magCurrent, double magVoltage, double supCurrent, double supVoltage, double refCurrent, quint8 state, quint8 heater)
+void magnetdaq::addDataPoint(const Sample &sample)
 {
+	qint64 time = sample.time;
+	double magField = sample.magnetField;
+	double magCurrent = sample.magnetCurrent;
+	double magVoltage = sample.magnetVoltage;
+	double supCurrent = sample.supplyCurrent;
+	double supVoltage = sample.supplyVoltage;
+	double refCurrent = sample.refCurrent;
+	quint8 state = sample.state;
+	quint8 heater = sample.heater;
 	double timebase = (double)(time - startTime) / 1000.0;
 
-	// save current data to model430 object
-	model430.setCurrentData(time, magField, magCurrent, magVoltage, supCurrent, supVoltage, refCurrent);
-
-	if (supports_AMITRG())
-		model430.switchHeaterState = (bool)heater;
-
-	// sample rate calculation
-	double deltaTime = (double)(time - lastTime) / 1000.0;
-	avgSampleTimes(deltaTime);
-	lastTime = time;
-
 	if (ui.minutesRadioButton->isChecked())
 		timebase /= 60.0;	// convert to minutes
 
+	// stale samples are only logged, their values were not measured now
+	if (sample.stale)
+	{
+		writeLogSample(sample, timebase);
+		plotCount++;
+		return;
+	}
+
+	// save current data to model430 object
+	model430.setCurrentData(time, magField, magCurrent, magVoltage, supCurrent, supVoltage, refCurrent, supports_AMITRG() ? (int)heater : -1);
+
 	if (ui.magnetCurrentRadioButton->isChecked())
 	{
 		ui.plotWidget->graph(MAGNET_CURRENT_GRAPH)->addData(timebase, magCurrent);
@@ -498,45 +602,11 @@ void magnetdaq::addDataPoint(qint64 time, double magField, double magCurrent, do
 	if (ui.referenceCheckBox->isChecked() && supports_AMITRG())
 		ui.plotWidget->graph(RAMP_REFERENCE_GRAPH)->addData(timebase, refCurrent);
 
-	if (logFile)
-	{
-		if (plotCount == 0)	// write header
-			writeLogHeader();
-
-		// write data to log file
-		char buffer[256];
-
-		if (model430.shortSampleMode)
-		{
-			if (supports_AMITRG())
-				sprintf(buffer, "%lld,%0.8lf,%0.8lf,%0.3lf,%0.8lf,%0.6lf,%0.8lf,%d\n", time, timebase, magCurrent /* sample Curr */, magVoltage /*sample uV */, supCurrent, supVoltage, refCurrent, state);
-			else
-				sprintf(buffer, "%lld,%0.8lf,%0.8lf,%0.3lf,%0.8lf,%0.6lf\n", time, timebase, magCurrent /* sample Curr */, magVoltage /*sample uV */, supCurrent, supVoltage);
-		}
-		else
-		{
-			if (supports_AMITRG())
-			{
-				if (model430.switchInstalled())
-					sprintf(buffer, "%lld,%0.8lf,%0.9lf,%0.8lf,%0.3lf,%0.8lf,%0.6lf,%0.8lf,%d,%d\n", time, timebase, magField, magCurrent, magVoltage, supCurrent, supVoltage, refCurrent, state, heater);
-				else
-					sprintf(buffer, "%lld,%0.8lf,%0.9lf,%0.8lf,%0.3lf,%0.8lf,%0.6lf,%0.8lf,%d\n", time, timebase, magField, magCurrent, magVoltage, supCurrent, supVoltage, refCurrent, state);
-			}
-			else
-			{
-				if (model430.switchInstalled())
-					sprintf(buffer, "%lld,%0.8lf,%0.9lf,%0.8lf,%0.3lf,%0.8lf,%0.6lf,%d\n", time, timebase, magField, magCurrent, magVoltage, supCurrent, supVoltage, model430.switchHeaterState);
-				else
-					sprintf(buffer, "%lld,%0.8lf,%0.9lf,%0.8lf,%0.3lf,%0.8lf,%0.6lf\n", time, timebase, magField, magCurrent, magVoltage, supCurrent, supVoltage);
-			}
-		}
-
-		logFile->write(buffer);
+	// drop (or demote) the oldest samples past the retention limits
+	for (int i = 0; i <= RAMP_REFERENCE_GRAPH; i++)
+		static_cast<DecimatedGraph *>(ui.plotWidget->graph(i))->applyRetention();
 
-		// flush every 300 lines (~1 minute)
-		if (plotCount % 300 == 0)
-			logFile->flush();
-	}
+	writeLogSample(sample, timebase);
 
 	plotCount++;
 
@@ -551,8 +621,6 @@ void magnetdaq::addDataPoint(qint64 time, double magField, double magCurrent, do
 			timeAxis->setRange(upper, upper + range);
 		}
 	}
-
-	ui.plotWidget->replot();
 }
 
 //---------------------------------------------------------------------------
@@ -638,54 +706,106 @@ void magnetdaq::avgSelectedTrace(double newValue)
 }
 
 //---------------------------------------------------------------------------
-// this function implements an average of the data sampling rate
-// using Welford's algorithm
-void magnetdaq::avgSampleTimes(double newValue)
+void magnetdaq::writeLogSample(const Sample &sample, double timebase)
 {
-	double delta;
-
-	if (samplePos == 0) // for Welford's algorithm we must reset mean to zero
-		meanSampleTime = 0.0;
+	if (logWriter || eventCapture->isEnabled())
+	{
+		if (plotCount == 0)	// write header
+			writeLogHeader();
 
-	// save new value
-	sampleTimes[samplePos] = newValue;
+		// pick the columns here, formatting happens on the writer thread
+		LogLayout layout;
+		bool heater = false;
 
-	// running mean for first window of data
-	delta = newValue - meanSampleTime;
-	meanSampleTime += delta / (double)(samplePos + 1);
-	
-	samplePos += 1;
+		if (model430.shortSampleMode)
+		{
+			if (supports_AMITRG())
+				layout = LogLayout::SHORT_SAMPLE_STATE;
+			else
+				layout = LogLayout::SHORT_SAMPLE;
+		}
+		else
+		{
+			if (supports_AMITRG())
+			{
+				if (model430.switchInstalled())
+					layout = LogLayout::MAGNET_STATE_HEATER;
+				else
+					layout = LogLayout::MAGNET_STATE;
+			}
+			else
+			{
+				if (model430.switchInstalled())
+				{
+					layout = LogLayout::MAGNET_HEATER;
+					heater = model430.liveState().switchHeaterState;
+				}
+				else
+				{
+					layout = LogLayout::MAGNET;
+				}
+			}
+		}
 
-	if (samplePos >= N_SAMPLES_MOVING_AVG)	// update interface for each buffer fill
-	{
-		if (meanSampleTime > 0)
-			statusSampleRate->setText(QString::number(1.0 / meanSampleTime, 'f', 1) + " samples/sec");
+		// drops (and counts) the sample rather than block if the disk stalls
+		if (logWriter)
+			logWriter->writeSample(sample, timebase, layout, heater);
 
-		samplePos = 0;
+		eventCapture->addSample(sample, timebase, layout, heater);
 	}
 }
 
+//---------------------------------------------------------------------------
+void magnetdaq::eventCaptureRateBoost(bool active)
+{
+	if (socket)
+		socket->setRateBoost(active);
+
+	if (active)
+		setStatusMsg("Event capture triggered, sampling at maximum rate");
+}
+
+//---------------------------------------------------------------------------
+void magnetdaq::eventCaptureSaved(QString fileName)
+{
+	setStatusMsg("Event capture saved to " + QFileInfo(fileName).fileName());
+}
+
+//---------------------------------------------------------------------------
+// achieved acquisition rate, reported by the socket about once per second
+void magnetdaq::acquisitionStatsUpdated(double rate, double jitter, double latency)
+{
+	statusSampleRate->setText(QString::number(rate, 'f', 1) + " samples/sec, " + QChar(0x00B1) + QString::number(jitter, 'f', 1) + " ms");
+	statusSampleRate->setToolTip("Magnet data sample rate and interval jitter, reply latency " + QString::number(latency, 'f', 1) + " ms");
+
+	// keep the communication statistics current while visible
+	if (ui.mainTabWidget->currentIndex() == SUPPORT_TAB)
+		refreshCommStats();
+}
+
 //---------------------------------------------------------------------------
 void magnetdaq::writeLogHeader(void)
 {
-	if (logFile)
+	if (logWriter || eventCapture->isEnabled())
 	{
+		QString header;
+
 		if (model430.shortSampleMode)
 		{
 			// write data column header
 			if (supports_AMITRG())
 			{
 				if (ui.secondsRadioButton->isChecked())
-					logFile->write(QString("Unix time,Elapsed Time(sec),Sample Current(A),Sample Voltage(uV),Supply Current(A),Program Out(V),Ref Current(A),State\n").toLocal8Bit());
+					header = QString("Unix time,Elapsed Time(sec),Sample Current(A),Sample Voltage(uV),Supply Current(A),Program Out(V),Ref Current(A),State");
 				else
-					logFile->write(QString("Unix time,Elapsed Time(min),Sample Current(A),Sample Voltage(uV),Supply Current(A),Program Out(V),Ref Current(A),State\n").toLocal8Bit());
+					header = QString("Unix time,Elapsed Time(min),Sample Current(A),Sample Voltage(uV),Supply Current(A),Program Out(V),Ref Current(A),State");
 			}
 			else
 			{
 				if (ui.secondsRadioButton->isChecked())
-					logFile->write(QString("Unix time,Elapsed Time(sec),Sample Current(A),Sample Voltage(uV),Supply Current(A),Program Out(V)\n").toLocal8Bit());
+					header = QString("Unix time,Elapsed Time(sec),Sample Current(A),Sample Voltage(uV),Supply Current(A),Program Out(V)");
 				else
-					logFile->write(QString("Unix time,Elapsed Time(min),Sample Current(A),Sample Voltage(uV),Supply Current(A),Program Out(V)\n").toLocal8Bit());
+					header = QString("Unix time,Elapsed Time(min),Sample Current(A),Sample Voltage(uV),Supply Current(A),Program Out(V)");
 			}
 		}
 		else
@@ -709,18 +829,50 @@ void magnetdaq::writeLogHeader(void)
 			if (supports_AMITRG())
 			{
 				if (ui.secondsRadioButton->isChecked())
-					logFile->write(QString("Unix time,Elapsed Time(sec),Magnet Field" + unitsStr + ",Magnet Current(A),Magnet Voltage(V),Supply Current(A),Supply Voltage(V),Ref Current(A),State" + heaterStr + "\n").toLocal8Bit());
+					header = QString("Unix time,Elapsed Time(sec),Magnet Field" + unitsStr + ",Magnet Current(A),Magnet Voltage(V),Supply Current(A),Supply Voltage(V),Ref Current(A),State" + heaterStr);
 				else
-					logFile->write(QString("Unix time,Elapsed Time(min),Magnet Field" + unitsStr + ",Magnet Current(A),Magnet Voltage(V),Supply Current(A),Supply Voltage(V),Ref Current(A),State" + heaterStr + "\n").toLocal8Bit());
+					header = QString("Unix time,Elapsed Time(min),Magnet Field" + unitsStr + ",Magnet Current(A),Magnet Voltage(V),Supply Current(A),Supply Voltage(V),Ref Current(A),State" + heaterStr);
 			}
 			else
 			{
 				if (ui.secondsRadioButton->isChecked())
-					logFile->write(QString("Unix time,Elapsed Time(sec),Magnet Field" + unitsStr + ",Magnet Current(A),Magnet Voltage(V),Supply Current(A),Supply Voltage(V)" + heaterStr + "\n").toLocal8Bit());
+					header = QString("Unix time,Elapsed Time(sec),Magnet Field" + unitsStr + ",Magnet Current(A),Magnet Voltage(V),Supply Current(A),Supply Voltage(V)" + heaterStr);
 				else
-					logFile->write(QString("Unix time,Elapsed Time(min),Magnet Field" + unitsStr + ",Magnet Current(A),Magnet Voltage(V),Supply Current(A),Supply Voltage(V)" + heaterStr + "\n").toLocal8Bit());
+					header = QString("Unix time,Elapsed Time(min),Magnet Field" + unitsStr + ",Magnet Current(A),Magnet Voltage(V),Supply Current(A),Supply Voltage(V)" + heaterStr);
 			}
 		}
+
+		// acquisition timing columns
+		header += ",Sent(us),Received(us),Midpoint(us),Stale";
+
+		eventCapture->setColumnHeader(header);
+
+		if (!logWriter)
+			return;
+
+		if (logWriter->getFormat() == LogFormat::BINARY)
+		{
+			// self-describing segment header, see binarylog.h
+			QMap<QString, QString> fields;
+
+			fields["Session"] = logSessionStart;
+			fields["Model"] = "430";
+			fields["Serial"] = model430.serialNumber();
+			fields["Firmware"] = QString::number(model430.firmwareVersion(), 'f', 2) + model430.getFirmwareSuffix();
+			fields["FieldUnits"] = model430.fieldUnits() == KG ? "kG" : "T";
+			fields["TimeUnits"] = ui.secondsRadioButton->isChecked() ? "sec" : "min";
+			fields["ShortSample"] = model430.shortSampleMode ? "1" : "0";
+			fields["Axis"] = axisStr.left(1);
+			fields["LossWindow"] = logWriter->lossWindow();
+			fields["Compression"] = logWriter->compressionDescription();
+			fields["Columns"] = header;
+
+			logWriter->writeHeader(BinaryLog::segmentHeader(fields));
+		}
+		else
+		{
+			logWriter->writeHeader((header + "\n").toLocal8Bit());
+		}
 	}
 }
 
@@ -852,13 +1004,23 @@ void magnetdaq::timebaseChanged(bool checked)
 {
 	// only the seconds button is connected to this slot,
 	// so we can assume we changed the units
-	// clear the past data of all graphs as the timebase is changed
-	for (int i = 0; i < 5; i++)
-		ui.plotWidget->graph(i)->data()->clear();
+	// clear the past data of all live graphs (and their history) as the timebase is changed
+	for (int i = 0; i <= RAMP_REFERENCE_GRAPH; i++)
+		clearLiveGraph(i);
+
+	// loaded logs are kept, in the new units
+	double scale = checked ? 60.0 : 1.0 / 60.0;
+
+	for (QCPGraph *graph : loadedGraphs)
+	{
+		for (auto it = graph->data()->begin(); it != graph->data()->end(); ++it)
+			it->key *= scale;
+	}
 
 	// reset time to zero
 	startTime = QDateTime::currentMSecsSinceEpoch();
 
+	applyPlotRetention();
 	setTimeAxisLabel();
 	ui.plotWidget->replot();
 }
@@ -872,13 +1034,13 @@ void magnetdaq::currentAxisSelectionChanged(bool checked)
 	{
 		// does magnet field already have a history?
 		if (!ui.plotWidget->graph(MAGNET_FIELD_GRAPH)->data()->isEmpty())
-			ui.plotWidget->graph(MAGNET_FIELD_GRAPH)->data()->clear();	// clear it
+			clearLiveGraph(MAGNET_FIELD_GRAPH);	// clear it
 	}
 	else
 	{
 		// does magnet current already have a history?
 		if (!ui.plotWidget->graph(MAGNET_CURRENT_GRAPH)->data()->isEmpty())
-			ui.plotWidget->graph(MAGNET_CURRENT_GRAPH)->data()->clear();	// clear it
+			clearLiveGraph(MAGNET_CURRENT_GRAPH);	// clear it
 	}
 
 	setCurrentAxisLabel();
@@ -893,7 +1055,7 @@ void magnetdaq::magnetVoltageSelectionChanged(bool checked)
 	{
 		// does supply current already have a history?
 		if (!ui.plotWidget->graph(MAGNET_VOLTAGE_GRAPH)->data()->isEmpty())
-			ui.plotWidget->graph(MAGNET_VOLTAGE_GRAPH)->data()->clear();	// clear it
+			clearLiveGraph(MAGNET_VOLTAGE_GRAPH);	// clear it
 	}
 
 	syncPlotLegend();
@@ -908,7 +1070,7 @@ void magnetdaq::supplyCurrentSelectionChanged(bool checked)
 	{
 		// does supply current already have a history?
 		if (!ui.plotWidget->graph(SUPPLY_CURRENT_GRAPH)->data()->isEmpty())
-			ui.plotWidget->graph(SUPPLY_CURRENT_GRAPH)->data()->clear();	// clear it
+			clearLiveGraph(SUPPLY_CURRENT_GRAPH);	// clear it
 	}
 
 	setCurrentAxisLabel();
@@ -923,7 +1085,7 @@ void magnetdaq::supplyVoltageSelectionChanged(bool checked)
 	{
 		// does supply voltage already have a history?
 		if (!ui.plotWidget->graph(SUPPLY_VOLTAGE_GRAPH)->data()->isEmpty())
-			ui.plotWidget->graph(SUPPLY_VOLTAGE_GRAPH)->data()->clear();	// clear it
+			clearLiveGraph(SUPPLY_VOLTAGE_GRAPH);	// clear it
 	}
 
 	syncPlotLegend();
@@ -937,7 +1099,7 @@ void magnetdaq::referenceSelectionChanged(bool checked)
 	{
 		// does supply voltage already have a history?
 		if (!ui.plotWidget->graph(RAMP_REFERENCE_GRAPH)->data()->isEmpty())
-			ui.plotWidget->graph(RAMP_REFERENCE_GRAPH)->data()->clear();	// clear it
+			clearLiveGraph(RAMP_REFERENCE_GRAPH);	// clear it
 	}
 
 	setCurrentAxisLabel();
@@ -1303,6 +1465,13 @@ void magnetdaq::contextMenuRequest(QPoint pos)
 		menu->addAction("Move to bottom right", this, SLOT(moveLegend()))->setData((int)(Qt::AlignBottom | Qt::AlignRight));
 		menu->addAction("Move to bottom left", this, SLOT(moveLegend()))->setData((int)(Qt::AlignBottom | Qt::AlignLeft));
 	}
+	else
+	{
+		menu->addAction("Load Log...", this, SLOT(loadLogFile()));
+
+		if (!loadedGraphs.isEmpty())
+			menu->addAction("Clear Loaded Logs", this, SLOT(clearLoadedLogs()));
+	}
 
 	menu->popup(ui.plotWidget->mapToGlobal(pos));
 }
@@ -1324,4 +1493,114 @@ void magnetdaq::moveLegend()
 
 //---------------------------------------------------------------------------
 
-//---------------------------------------------------------------------------
\ No newline at end of file
+//---------------------------------------------------------------------------
+// Overlays the runs of an earlier data log (CSV or binary) on the main
+// plot, each from the start of its run, for offline review. Each run gets
+// its own color; the channels follow the present plot selections.
+void magnetdaq::loadLogFile(void)
+{
+	QSettings settings;
+	lastPath = settings.value("LastLogPath").toString();
+
+	QString fileName = QFileDialog::getOpenFileName(this, "Load Log File", lastPath, "Log Files (*.txt *.log *.csv *.mdl)");
+
+	if (fileName.isEmpty())
+		return;
+
+	settings.setValue("LastLogPath", QFileInfo(fileName).absolutePath());
+
+	QVector<LogReader::Run> runs;
+	QString errorMessage;
+
+	QApplication::setOverrideCursor(Qt::WaitCursor);
+	bool loaded = LogReader::load(fileName, runs, &errorMessage);
+	QApplication::restoreOverrideCursor();
+
+	if (!loaded)
+	{
+		QMessageBox msgBox;
+		msgBox.setText("Log Load Error");
+		msgBox.setInformativeText(errorMessage);
+		msgBox.setStandardButtons(QMessageBox::Ok);
+		msgBox.setDefaultButton(QMessageBox::Ok);
+		msgBox.setIcon(QMessageBox::Critical);
+		msgBox.exec();
+		return;
+	}
+
+	static const QColor runColors[] = { Qt::darkCyan, QColor(255, 140, 0), Qt::darkYellow, Qt::magenta, Qt::darkGray, Qt::darkBlue, QColor(139, 69, 19) };
+	const int numColors = sizeof(runColors) / sizeof(runColors[0]);
+
+	QString name = QFileInfo(fileName).fileName();
+
+	for (const LogReader::Run &run : runs)
+	{
+		QColor color = runColors[loadedRuns++ % numColors];
+		QString prefix = name + " " + run.session + ": ";
+
+		// elapsed time in the plot's present units
+		QVector<double> keys = run.time;
+		double scale = 1.0;
+
+		if (run.minutes && ui.secondsRadioButton->isChecked())
+			scale = 60.0;
+		else if (!run.minutes && ui.minutesRadioButton->isChecked())
+			scale = 1.0 / 60.0;
+
+		if (scale != 1.0)
+		{
+			for (double &key : keys)
+				key *= scale;
+		}
+
+		auto addRunGraph = [&](int channel, QCPAxis *valueAxis, const QString &label, Qt::PenStyle style)
+		{
+			if (!run.hasChannel(channel))
+				return;
+
+			QCPGraph *graph = new DecimatedGraph(timeAxis, valueAxis);
+			QPen pen = QPen(color);
+
+			pen.setWidthF(1.0);
+			pen.setStyle(style);
+			graph->setName(prefix + label);
+			graph->setPen(pen);
+			graph->selectionDecorator()->setPen(QPen(Qt::darkMagenta, 1));
+			graph->setData(keys, run.values[channel], true);
+			graph->rescaleAxes(true);
+			loadedGraphs.append(graph);
+		};
+
+		if (ui.magnetFieldRadioButton->isChecked() && run.hasChannel(LogReader::FIELD))
+			addRunGraph(LogReader::FIELD, currentAxis, "Magnet Field (" + run.fieldUnits + ")", Qt::SolidLine);
+		else
+			addRunGraph(LogReader::CURRENT, currentAxis, run.shortSample ? "Sample Current" : "Magnet Current", Qt::SolidLine);
+
+		if (ui.magnetVoltageCheckBox->isChecked())
+			addRunGraph(LogReader::VOLTAGE, voltageAxis, run.shortSample ? "Sample Voltage (uV)" : "Magnet Voltage", Qt::DashDotLine);
+
+		if (ui.supplyCurrentCheckBox->isChecked())
+			addRunGraph(LogReader::SUPPLY_CURRENT, currentAxis, "Supply Current", Qt::DashLine);
+
+		if (ui.supplyVoltageCheckBox->isChecked())
+			addRunGraph(LogReader::SUPPLY_VOLTAGE, voltageAxis, run.shortSample ? "Program Out" : "Supply Voltage", Qt::DashDotDotLine);
+
+		if (ui.referenceCheckBox->isChecked())
+			addRunGraph(LogReader::REF_CURRENT, currentAxis, "Reference Current", Qt::DotLine);
+	}
+
+	ui.plotWidget->replot();
+}
+
+//---------------------------------------------------------------------------
+void magnetdaq::clearLoadedLogs(void)
+{
+	for (QCPGraph *graph : loadedGraphs)
+		ui.plotWidget->removeGraph(graph);
+
+	loadedGraphs.clear();
+	loadedRuns = 0;
+	ui.plotWidget->replot();
+}
+
+//---------------------------------------------------------------------------
@@ -16,6 +16,10 @@ void magnetdaq::restoreSupportSettings(QSettings *settings)
 	connect(ui.sendSupportEmailButton, SIGNAL(clicked()), this, SLOT(sendSupportEmailClicked()));
 	connect(ui.copySettingsToClipboardButton, SIGNAL(clicked()), this, SLOT(copySettingsToClipboard()));
 	connect(ui.saveSettingsToFileButton, SIGNAL(clicked()), this, SLOT(saveSettingsToFile()));
+	connect(ui.resetCommStatsButton, SIGNAL(clicked()), this, SLOT(resetCommStats()));
+
+	// statistics are a column-aligned table
+	ui.commStatsTextEdit->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
 }
 
 //---------------------------------------------------------------------------
@@ -24,8 +28,48 @@ void magnetdaq::refreshSupportSettings(void)
 	if (socket)
 	{
 		QApplication::setOverrideCursor(Qt::WaitCursor);
-		socket->sendExtendedQuery("SETTINGS?\r\n", QueryState::SETTINGS, 4); // 4 second time limit on reply
-		QApplication::restoreOverrideCursor();
+		model430.markSynced(SETTINGS_SYNC);
+		socket->sendExtendedQuery("SETTINGS?\r\n", QueryState::SETTINGS, 4, [](bool ok) { QApplication::restoreOverrideCursor(); }); // 4 second time limit on reply
+	}
+}
+
+//---------------------------------------------------------------------------
+void magnetdaq::refreshCommStats(void)
+{
+	if (socket)
+	{
+		// keep the scroll position while the table updates
+		int position = ui.commStatsTextEdit->verticalScrollBar()->value();
+
+		QString report = socket->commStats().report();
+
+		// data log writer health
+		if (logWriter)
+		{
+			report += "\nData log: " + QString::number(logWriter->getBytesWritten()) + " bytes written, " +
+				QString::number(logWriter->getDroppedRecords()) + " samples dropped, " +
+				QString::number(logWriter->getDroppedText()) + " text lines dropped, queue high-water " +
+				QString::number(logWriter->getHighWaterMark()) + "/" + QString::number(LogWriter::queueCapacity()) +
+				(logWriter->hasError() ? ", WRITE ERROR" : "") + "\n";
+
+			if (logWriter->getRepairedBytes() > 0)
+				report += "Data log: " + QString::number(logWriter->getRepairedBytes()) + " bytes of damaged tail removed at start\n";
+
+			report += "Data log flush: at most " + logWriter->lossWindow() + "\n";
+		}
+
+		ui.commStatsTextEdit->setPlainText(report);
+		ui.commStatsTextEdit->verticalScrollBar()->setValue(position);
+	}
+}
+
+//---------------------------------------------------------------------------
+void magnetdaq::resetCommStats(void)
+{
+	if (socket)
+	{
+		socket->resetCommStats();
+		refreshCommStats();
 	}
 }
 
@@ -1,6 +1,7 @@
 #include "stdafx.h"
 #include "magnetdaq.h"
 #include "version.h"
+#include "binarylog.h"
 #include <QtWidgets/QApplication>
 #include <QtDebug>
 #include <QFile>
@@ -112,6 +113,34 @@ int main(int argc, char *argv[])
 	QApplication a(argc, argv);
 #endif
 
+	// convert a binary log without opening the window:
+	// Magnet-DAQ --export-csv file.mdl [file.csv]
+	{
+		QStringList args = QCoreApplication::arguments();
+		int index = args.indexOf("--export-csv");
+
+		if (index > 0)
+		{
+			if (index + 1 >= args.size())
+			{
+				fprintf(stderr, "--export-csv requires a binary log file name\n");
+				return 1;
+			}
+
+			QString source = args.at(index + 1);
+			QString destination = (index + 2 < args.size()) ? args.at(index + 2) : source + ".csv";
+			QString error;
+
+			if (!BinaryLog::exportToCsv(source, destination, &error))
+			{
+				fprintf(stderr, "%s\n", error.toLocal8Bit().constData());
+				return 1;
+			}
+
+			return 0;
+		}
+	}
+
 	magnetdaq w;
 	w.show();
 	return a.exec();
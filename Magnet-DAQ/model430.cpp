@@ -7,18 +7,13 @@
 Model430::Model430(QObject *parent) : QObject(parent)
 {
 	socket = nullptr;
-	persistentState = false;
-	switchHeaterState = false;
 	shortSampleMode = false;
-	magnetField = 0.0;
-	magnetCurrent = 0.0;
-	magnetVoltage = 0.0;
-	supplyCurrent = 0.0;
-	supplyVoltage = 0.0;
-	quenchCurrent = 0.0;
+	live.store(LiveState());
+	stalePages = ALL_SYNC;
 
 	// setup on_change() connections for properties
 	mode.on_change().connect([this](int val)					{ this->modeValueChanged(); });
+	state.on_change().connect([this](State val)					{ this->live.update([val](LiveState &s) { s.state = (int)val; }); });
 	fieldUnits.on_change().connect([this](int val)				{ this->fieldUnitsChanged(); });
 	targetCurrent.on_change().connect([this](double val)		{ this->valueChanged(QueryState::TARGET_CURRENT); });
 	targetField.on_change().connect([this](double val)			{ this->valueChanged(QueryState::TARGET_FIELD); });
@@ -64,6 +59,10 @@ Model430::Model430(QObject *parent) : QObject(parent)
 	rampRateSegments.on_change().connect([this](int val)		{ this->valueChanged(QueryState::RAMP_SEGMENTS); });
 	rampdownSegments.on_change().connect([this](int val)		{ this->valueChanged(QueryState::RAMPDOWN_SEGMENTS); });
 
+	// a new event count means the event file must be read again
+	rampdownEventsCount.on_change().connect([this](int val)		{ this->markStale(RAMPDOWN_EVENTS_SYNC); });
+	quenchEventsCount.on_change().connect([this](int val)		{ this->markStale(QUENCH_EVENTS_SYNC); });
+
 	for (int i = 0; i < 10; i++)	// up to 10 segments
 	{
 		currentRampRates[i].on_change().connect([this](double val)	{ this->valueChanged(QueryState::RAMP_RATE_CURRENT); });
@@ -90,14 +89,44 @@ Model430::~Model430()
 //---------------------------------------------------------------------------
 void Model430::sync(void)
 {
-	// sync the state of this object with remote instrument's values
+	// sync the state of this object with remote instrument's values,
+	// all pages are written to the 430 in one burst
 	if (socket)
 	{
+		socket->beginBatch();
 		syncSupplySetup();
 		syncLoadSetup();
 		syncSwitchSetup();
 		syncProtectionSetup();
 		syncRampRates();
+		socket->endBatch();
+	}
+}
+
+//---------------------------------------------------------------------------
+// Re-queries those of pages that are stale, in one burst
+void Model430::syncStale(int pages)
+{
+	pages &= stalePages.load();
+
+	if (socket && pages)
+	{
+		socket->beginBatch();
+
+		if (pages & SUPPLY_SYNC)
+			syncSupplySetup();
+		if (pages & LOAD_SYNC)
+			syncLoadSetup();
+		if (pages & SWITCH_SYNC)
+			syncSwitchSetup();
+		if (pages & PROTECTION_SYNC)
+			syncProtectionSetup();
+		if (pages & RAMP_SYNC)
+			syncRampRates();
+		if (pages & RAMPDOWN_SYNC)
+			syncRampdownSegmentValues();
+
+		socket->endBatch();
 	}
 }
 
@@ -122,6 +151,9 @@ void Model430::syncSupplySetup(void)
 	// sync the state of this object with remote instrument's values
 	if (socket)
 	{
+		markSynced(SUPPLY_SYNC);
+		socket->beginBatch();
+
 		if (firmwareVersion() > 3.15 || (firmwareVersion() < 3.0 && firmwareVersion() > 2.65))
 			socket->sendQuery("SUPP:RANGE?\r\n", QueryState::CURRENT_RANGE);
 		else
@@ -133,6 +165,7 @@ void Model430::syncSupplySetup(void)
 		socket->sendQuery("SUPP:CURR:MIN?\r\n", QueryState::SUPPLY_MIN_CURRENT);
 		socket->sendQuery("SUPP:CURR:MAX?\r\n", QueryState::SUPPLY_MAX_CURRENT);
 		socket->sendQuery("SUPP:MODE?\r\n", QueryState::SUPPLY_VV_INPUT);
+		socket->endBatch();
 	}
 }
 
@@ -142,6 +175,8 @@ void Model430::syncLoadSetup(void)
 	// sync the state of this object with remote instrument's values
 	if (socket)
 	{
+		markSynced(LOAD_SYNC);
+		socket->beginBatch();
 		socket->sendQuery("STAB:MODE?\r\n", QueryState::STABILITY_MODE);
 		socket->sendQuery("STAB?\r\n", QueryState::STABILITY_SETTING);
 		socket->sendQuery("STAB:RES?\r\n", QueryState::STABILITY_RESISTOR);
@@ -151,6 +186,8 @@ void Model430::syncLoadSetup(void)
 			socket->sendQuery("IND?\r\n", QueryState::INDUCTANCE);
 			socket->sendQuery("AB?\r\n", QueryState::ABSORBER_PRESENT);
 		}
+
+		socket->endBatch();
 	}
 }
 
@@ -160,7 +197,17 @@ void Model430::syncSwitchSetup(void)
 	// sync the state of this object with remote instrument's values
 	if (socket && !shortSampleMode)
 	{
-		socket->sendQuery("PS:INST?\r\n", QueryState::SWITCH_INSTALLED);
+		markSynced(SWITCH_SYNC);
+		socket->beginBatch();
+
+		// heater state query depends on the installed reply
+		socket->sendQuery("PS:INST?\r\n", QueryState::SWITCH_INSTALLED, [this](bool ok)
+		{
+			if (switchInstalled())
+				socket->sendQuery("PS?\r\n", QueryState::SWITCH_HTR_STATE);
+			else
+				setSwitchHeaterState(false);
+		});
 		socket->sendQuery("STAB:RES?\r\n", QueryState::STABILITY_RESISTOR);
 		socket->sendQuery("PS:CURR?\r\n", QueryState::SWITCH_CURRENT);
 		socket->sendQuery("PS:TRAN?\r\n", QueryState::SWITCH_TRANSITION);
@@ -168,11 +215,7 @@ void Model430::syncSwitchSetup(void)
 		socket->sendQuery("PS:CTIME?\r\n", QueryState::SWITCH_COOLED_TIME);
 		socket->sendQuery("PS:PSRR?\r\n", QueryState::PS_RAMP_RATE);
 		socket->sendQuery("PS:CGAIN?\r\n", QueryState::SWITCH_COOLING_GAIN);
-
-		if (switchInstalled())
-			socket->sendQuery("PS?\r\n", QueryState::SWITCH_HTR_STATE);
-		else
-			switchHeaterState = false;
+		socket->endBatch();
 	}
 }
 
@@ -182,6 +225,8 @@ void Model430::syncProtectionSetup(void)
 	// sync the state of this object with remote instrument's values
 	if (socket)
 	{
+		markSynced(PROTECTION_SYNC);
+		socket->beginBatch();
 		socket->sendQuery("CURR:LIM?\r\n", QueryState::CURRENT_LIMIT);
 		
 		if (shortSampleMode)
@@ -207,6 +252,8 @@ void Model430::syncProtectionSetup(void)
 			socket->sendQuery("OPL:TSCALE?\r\n", QueryState::TSCALE);
 			socket->sendQuery("OPL:TOFFSET?\r\n", QueryState::TOFFSET);
 		}
+
+		socket->endBatch();
 	}
 }
 
@@ -274,11 +321,18 @@ void Model430::syncRampRates(void)
 	// get all the present ramp rate segments
 	if (socket)
 	{
+		markSynced(RAMP_SYNC);
+		socket->beginBatch();
+
 		// get the present target setpoint in A
 		socket->sendQuery("CURR:TARG?\r\n", QueryState::TARGET_CURRENT);
 
-		// get the present number of segments
-		socket->sendQuery("RAMP:RATE:SEG?\r\n", QueryState::RAMP_SEGMENTS);
+		// get the present number of segments, then the segment values
+		socket->sendQuery("RAMP:RATE:SEG?\r\n", QueryState::RAMP_SEGMENTS, [this](bool ok)
+		{
+			if (ok)
+				syncRampSegmentValues();
+		});
 
 		// get the time units (sec or min)
 		socket->sendQuery("RAMP:RATE:UNITS?\r\n", QueryState::RAMP_TIMEBASE);
@@ -298,7 +352,7 @@ void Model430::syncRampRates(void)
 			socket->sendQuery("FIELD:UNITS?\r\n", QueryState::FIELD_UNITS);
 		}
 
-		syncRampSegmentValues();
+		socket->endBatch();
 	}
 }
 
@@ -313,7 +367,9 @@ void Model430::syncRampSegmentValues(void)
 		if (rampRateSegments() < 10 && rampRateSegments() >= 0)
 			segCount = rampRateSegments();
 
-		// get the ramp segments
+		// get the ramp segments in one burst
+		socket->beginBatch();
+
 		for (int i = 0; i < segCount; i++)
 		{
 			if (socket)
@@ -332,8 +388,11 @@ void Model430::syncRampSegmentValues(void)
 				break;
 		}
 
+		socket->endBatch();
+
+		// replot once all segment replies are in
 		if (!shortSampleMode)
-			emit syncRampPlot();
+			socket->whenIdle([this](bool ok) { emit syncRampPlot(); });
 	}
 }
 
@@ -342,38 +401,379 @@ void Model430::syncRampdownSegmentValues(void)
 {
 	if (socket && !shortSampleMode)
 	{
-		// avoid memory crashes
-		int segCount = 10;
+		markSynced(RAMPDOWN_SYNC);
 
-		// get the present number of segments
-		socket->sendExtendedQuery("RAMPD:RATE:SEG?\r\n", QueryState::RAMPDOWN_SEGMENTS, 2); // 2 second time limit on reply
+		// get the present number of segments, then the segment values
+		socket->sendExtendedQuery("RAMPD:RATE:SEG?\r\n", QueryState::RAMPDOWN_SEGMENTS, 2, [this](bool ok) // 2 second time limit on reply
+		{
+			// avoid memory crashes
+			int segCount = 10;
 
-		if (rampdownSegments() < 10 && rampdownSegments() >= 0)
-			segCount = rampdownSegments();
+			if (rampdownSegments() < 10 && rampdownSegments() >= 0)
+				segCount = rampdownSegments();
 
-		// get the ramp segments
-		for (int i = 0; i < segCount; i++)
-		{
-			if (socket)
+			// get the ramp segments in one burst
+			socket->beginBatch();
+
+			for (int i = 0; i < segCount; i++)
 			{
-				// get the "i"th segment, starts at 1
-				QString queryStr = "RAMPD:RATE:CURR:" + QString::number(i + 1) + "?\r\n";
-				socket->sendRampQuery(queryStr, QueryState::RAMPDOWN_CURRENT, i + 1);
+				if (socket)
+				{
+					// get the "i"th segment, starts at 1
+					QString queryStr = "RAMPD:RATE:CURR:" + QString::number(i + 1) + "?\r\n";
+					socket->sendRampQuery(queryStr, QueryState::RAMPDOWN_CURRENT, i + 1);
 
-				queryStr = "RAMPD:RATE:FIELD:" + QString::number(i + 1) + "?\r\n";
-				socket->sendRampQuery(queryStr, QueryState::RAMPDOWN_FIELD, i + 1);
+					queryStr = "RAMPD:RATE:FIELD:" + QString::number(i + 1) + "?\r\n";
+					socket->sendRampQuery(queryStr, QueryState::RAMPDOWN_FIELD, i + 1);
+				}
+				else
+					break;
 			}
+
+			socket->endBatch();
+
+			// replot once all segment replies are in
+			socket->whenIdle([this](bool ok) { emit syncRampdownPlot(); });
+		});
+	}
+}
+
+//---------------------------------------------------------------------------
+// Values that change in normal operation rather than by configuration, so
+// are never taken from the configuration cache.
+void Model430::syncVolatileValues(void)
+{
+	if (socket)
+	{
+		socket->beginBatch();
+		socket->sendQuery("CURR:TARG?\r\n", QueryState::TARGET_CURRENT);
+
+		if (!shortSampleMode)
+		{
+			socket->sendQuery("FIELD:TARG?\r\n", QueryState::TARGET_FIELD);
+
+			if (switchInstalled())
+				socket->sendQuery("PS?\r\n", QueryState::SWITCH_HTR_STATE);
 			else
-				break;
+				setSwitchHeaterState(false);
 		}
 
-		syncRampdownPlot();
+		socket->endBatch();
+	}
+}
+
+//---------------------------------------------------------------------------
+// Digest of the last SETTINGS? dump. A cached configuration is only used if
+// the digest saved with it matches a fresh dump from the instrument.
+QString Model430::settingsDigest(void)
+{
+	if (textSettings.isEmpty())
+		return QString();
+
+	return QString(QCryptographicHash::hash(textSettings.toLatin1(), QCryptographicHash::Sha1).toHex());
+}
+
+//---------------------------------------------------------------------------
+QString Model430::cacheGroup(void)
+{
+	QString serial = serialNumber().trimmed();
+
+	// keep the serial number a single settings key
+	serial.replace('/', '_');
+	serial.replace('\\', '_');
+
+	return "ConfigCache/" + serial;
+}
+
+//---------------------------------------------------------------------------
+// Reads or writes every cached configuration value, in the order a full
+// sync receives them so dependent GUI updates see the same sequence.
+// Restored values always notify so the GUI matches even when the previous
+// session was with a unit that had the same values.
+template <typename T>
+static void cacheProperty(QSettings *settings, bool save, const QString &key, Property<T> &prop)
+{
+	if (save)
+	{
+		settings->setValue(key, prop());
+	}
+	else
+	{
+		prop.set_with_no_emit(settings->value(key).template value<T>());
+		prop.touch();
+	}
+}
+
+static void cacheConfiguration(QSettings *settings, bool save, Model430 *model)
+{
+	// SETUP -> Supply
+	cacheProperty(settings, save, "CurrentRange", model->currentRange);
+	cacheProperty(settings, save, "SupplyType", model->powerSupplySelection);
+	cacheProperty(settings, save, "MinSupplyVoltage", model->minSupplyVoltage);
+	cacheProperty(settings, save, "MaxSupplyVoltage", model->maxSupplyVoltage);
+	cacheProperty(settings, save, "MinSupplyCurrent", model->minSupplyCurrent);
+	cacheProperty(settings, save, "MaxSupplyCurrent", model->maxSupplyCurrent);
+	cacheProperty(settings, save, "InputVoltageRange", model->inputVoltageRange);
+
+	// SETUP -> Load
+	cacheProperty(settings, save, "StabilityMode", model->stabilityMode);
+	cacheProperty(settings, save, "StabilitySetting", model->stabilitySetting);
+	cacheProperty(settings, save, "StabilityResistor", model->stabilityResistor);
+	cacheProperty(settings, save, "CoilConstant", model->coilConstant);
+	cacheProperty(settings, save, "Inductance", model->inductance);
+	cacheProperty(settings, save, "AbsorberPresent", model->absorberPresent);
+
+	// SETUP -> Switch
+	cacheProperty(settings, save, "SwitchInstalled", model->switchInstalled);
+	cacheProperty(settings, save, "SwitchCurrent", model->switchCurrent);
+	cacheProperty(settings, save, "SwitchTransition", model->switchTransition);
+	cacheProperty(settings, save, "SwitchHeatedTime", model->switchHeatedTime);
+	cacheProperty(settings, save, "SwitchCooledTime", model->switchCooledTime);
+	cacheProperty(settings, save, "CooledSwitchRampRate", model->cooledSwitchRampRate);
+	cacheProperty(settings, save, "SwitchCoolingGain", model->switchCoolingGain);
+
+	// SETUP -> Protection
+	cacheProperty(settings, save, "CurrentLimit", model->currentLimit);
+	cacheProperty(settings, save, "SampleQuenchDetection", model->sampleQuenchDetection);
+	cacheProperty(settings, save, "SampleQuenchLimit", model->sampleQuenchLimit);
+	cacheProperty(settings, save, "QuenchDetection", model->quenchDetection);
+	cacheProperty(settings, save, "QuenchSensitivity", model->quenchSensitivity);
+	cacheProperty(settings, save, "ExtRampdownEnabled", model->extRampdownEnabled);
+	cacheProperty(settings, save, "ProtectionMode", model->protectionMode);
+	cacheProperty(settings, save, "IcSlope", model->IcSlope);
+	cacheProperty(settings, save, "IcOffset", model->IcOffset);
+	cacheProperty(settings, save, "Tmax", model->Tmax);
+	cacheProperty(settings, save, "Tscale", model->Tscale);
+	cacheProperty(settings, save, "Toffset", model->Toffset);
+
+	// RAMP RATE
+	cacheProperty(settings, save, "RampRateSegments", model->rampRateSegments);
+	cacheProperty(settings, save, "RampRateTimeUnits", model->rampRateTimeUnits);
+	cacheProperty(settings, save, "VoltageLimit", model->voltageLimit);
+	cacheProperty(settings, save, "RampdownSegments", model->rampdownSegments);
+	cacheProperty(settings, save, "FieldUnits", model->fieldUnits);
+
+	for (int i = 0; i < 10; i++)	// up to 10 segments
+	{
+		QString segment = QString::number(i + 1);
+
+		cacheProperty(settings, save, "CurrentRampRate" + segment, model->currentRampRates[i]);
+		cacheProperty(settings, save, "CurrentRampLimit" + segment, model->currentRampLimits[i]);
+		cacheProperty(settings, save, "FieldRampRate" + segment, model->fieldRampRates[i]);
+		cacheProperty(settings, save, "FieldRampLimit" + segment, model->fieldRampLimits[i]);
+	}
+
+	// RAMPDOWN
+	for (int i = 0; i < 10; i++)	// up to 10 segments
+	{
+		QString segment = QString::number(i + 1);
+
+		cacheProperty(settings, save, "CurrentRampdownRate" + segment, model->currentRampdownRates[i]);
+		cacheProperty(settings, save, "CurrentRampdownLimit" + segment, model->currentRampdownLimits[i]);
+		cacheProperty(settings, save, "FieldRampdownRate" + segment, model->fieldRampdownRates[i]);
+		cacheProperty(settings, save, "FieldRampdownLimit" + segment, model->fieldRampdownLimits[i]);
+	}
+}
+
+//---------------------------------------------------------------------------
+// True if a configuration was cached for this serial number with the same
+// firmware and S2 mode. The cache is still to be validated against a fresh
+// SETTINGS? dump with restoreCachedConfiguration().
+bool Model430::hasCachedConfiguration(QSettings *settings)
+{
+	if (serialNumber().trimmed().isEmpty())
+		return false;
+
+	settings->beginGroup(cacheGroup());
+
+	bool found = settings->value("FirmwareVersion").toString() == QString::number(firmwareVersion(), 'f', 2) &&
+				 settings->value("FirmwareSuffix").toString() == firmwareSuffix &&
+				 settings->value("Mode", -1).toInt() == mode() &&
+				 !settings->value("Digest").toString().isEmpty();
+
+	settings->endGroup();
+
+	return found;
+}
+
+//---------------------------------------------------------------------------
+// Loads the cached configuration if its digest matches the present
+// SETTINGS? dump, otherwise leaves the model untouched for a full sync.
+bool Model430::restoreCachedConfiguration(QSettings *settings)
+{
+	QString digest = settingsDigest();
+
+	if (digest.isEmpty() || !hasCachedConfiguration(settings))
+		return false;
+
+	settings->beginGroup(cacheGroup());
+
+	if (settings->value("Digest").toString() != digest)
+	{
+		settings->endGroup();
+		return false;
+	}
+
+	cacheConfiguration(settings, false, this);
+	settings->endGroup();
+
+	// everything saved is as current as the settings dump just read
+	markSynced(CACHED_SYNC | SETTINGS_SYNC);
+
+	// redraw the ramp profiles from the restored segments
+	if (!shortSampleMode)
+	{
+		emit syncRampPlot();
+		emit syncRampdownPlot();
+	}
+
+	return true;
+}
+
+//---------------------------------------------------------------------------
+// Saves the present configuration with the digest of the last SETTINGS?
+// dump, which must have been read after any outstanding configuration
+// changes were synced. Nothing is saved while a cached page is stale, its
+// values would be restored as current next time.
+void Model430::saveCachedConfiguration(QSettings *settings)
+{
+	QString digest = settingsDigest();
+
+	if (digest.isEmpty() || serialNumber().trimmed().isEmpty() || isStale(CACHED_SYNC))
+		return;
+
+	settings->beginGroup(cacheGroup());
+	settings->remove("");	// no stale keys from older versions
+	settings->setValue("FirmwareVersion", QString::number(firmwareVersion(), 'f', 2));
+	settings->setValue("FirmwareSuffix", firmwareSuffix);
+	settings->setValue("Mode", mode());
+	settings->setValue("Digest", digest);
+	cacheConfiguration(settings, true, this);
+	settings->endGroup();
+}
+
+//---------------------------------------------------------------------------
+// Views a configuration command writes to, by SCPI header. The command may be
+// clipped or rejected by the 430, so those views are read back on next show.
+int Model430::commandSyncPages(const QString &cmd)
+{
+	QString str = cmd.trimmed().toUpper();
+
+	if (!str.startsWith("CONF"))
+		return 0;
+
+	str = str.mid(str.indexOf(':') + 1);	// past CONFigure:
+
+	int pages = SETTINGS_SYNC;
+
+	if (str.startsWith("IPNAME"))
+		return pages;
+	else if (str.startsWith("SUPP"))
+		pages |= SUPPLY_SYNC;
+	else if (str.startsWith("STAB:RES"))
+		pages |= LOAD_SYNC | SWITCH_SYNC;
+	else if (str.startsWith("STAB") || str.startsWith("COIL") || str.startsWith("IND") || str.startsWith("AB"))
+		pages |= LOAD_SYNC;
+	else if (str.startsWith("PS"))
+		pages |= SWITCH_SYNC;
+	else if (str.startsWith("CURR:LIM") || str.startsWith("QU") || str.startsWith("RAMPD:ENAB") || str.startsWith("OPL"))
+		pages |= PROTECTION_SYNC;
+	else if (str.startsWith("RAMPD"))
+		pages |= RAMPDOWN_SYNC;
+	else if (str.startsWith("RAMP") || str.startsWith("CURR:TARG") || str.startsWith("FIELD") || str.startsWith("VOLT:LIM"))
+		pages |= RAMP_SYNC;
+	else
+		pages |= SETUP_SYNC;	// unknown, read everything back
+
+	return pages;
+}
+
+//---------------------------------------------------------------------------
+// Views holding the value a query reads, so a timed out reply is retried
+// when the view is next shown.
+int Model430::querySyncPages(QueryState aState)
+{
+	switch (aState)
+	{
+		case QueryState::CURRENT_RANGE:
+		case QueryState::SUPPLY_TYPE:
+		case QueryState::SUPPLY_MIN_VOLTAGE:
+		case QueryState::SUPPLY_MAX_VOLTAGE:
+		case QueryState::SUPPLY_MIN_CURRENT:
+		case QueryState::SUPPLY_MAX_CURRENT:
+		case QueryState::SUPPLY_VV_INPUT:
+			return SUPPLY_SYNC;
+
+		case QueryState::STABILITY_MODE:
+		case QueryState::STABILITY_SETTING:
+		case QueryState::COIL_CONSTANT:
+		case QueryState::INDUCTANCE:
+		case QueryState::ABSORBER_PRESENT:
+			return LOAD_SYNC;
+
+		case QueryState::STABILITY_RESISTOR:
+			return LOAD_SYNC | SWITCH_SYNC;
+
+		case QueryState::SWITCH_INSTALLED:
+		case QueryState::SWITCH_CURRENT:
+		case QueryState::SWITCH_TRANSITION:
+		case QueryState::SWITCH_HEATED_TIME:
+		case QueryState::SWITCH_COOLED_TIME:
+		case QueryState::PS_RAMP_RATE:
+		case QueryState::SWITCH_COOLING_GAIN:
+		case QueryState::SWITCH_HTR_STATE:
+			return SWITCH_SYNC;
+
+		case QueryState::CURRENT_LIMIT:
+		case QueryState::QUENCH_ENABLE:
+		case QueryState::QUENCH_SENSITIVITY:
+		case QueryState::SAMPLE_QUENCH_ENABLE:
+		case QueryState::SAMPLE_QUENCH_LIMIT:
+		case QueryState::EXT_RAMPDOWN:
+		case QueryState::PROTECTION_MODE:
+		case QueryState::IC_SLOPE:
+		case QueryState::IC_OFFSET:
+		case QueryState::TMAX:
+		case QueryState::TSCALE:
+		case QueryState::TOFFSET:
+			return PROTECTION_SYNC;
+
+		case QueryState::TARGET_CURRENT:
+		case QueryState::TARGET_FIELD:
+		case QueryState::VOLTAGE_LIMIT:
+		case QueryState::RAMP_TIMEBASE:
+		case QueryState::FIELD_UNITS:
+		case QueryState::RAMP_SEGMENTS:
+		case QueryState::RAMP_RATE_CURRENT:
+		case QueryState::RAMP_RATE_FIELD:
+			return RAMP_SYNC;
+
+		case QueryState::RAMPDOWN_SEGMENTS:
+		case QueryState::RAMPDOWN_CURRENT:
+		case QueryState::RAMPDOWN_FIELD:
+			return RAMPDOWN_SYNC;
+
+		case QueryState::RAMPDOWN_COUNT:
+		case QueryState::RAMPDOWN_FILE:
+			return RAMPDOWN_EVENTS_SYNC;
+
+		case QueryState::QUENCH_COUNT:
+		case QueryState::QUENCH_FILE:
+			return QUENCH_EVENTS_SYNC;
+
+		case QueryState::SETTINGS:
+			return SETTINGS_SYNC;
+
+		default:
+			return 0;
 	}
 }
 
 //---------------------------------------------------------------------------
 void Model430::valueChanged(QueryState aState)
 {
+	// any configuration change also changes the settings dump
+	markStale(SETTINGS_SYNC);
 	emit configurationChanged(aState);
 }
 
@@ -420,15 +820,22 @@ void Model430::setSettings(QString str)
 }
 
 //---------------------------------------------------------------------------
-void Model430::setCurrentData(qint64 time, double magField, double magCurrent, double magVoltage, double supCurrent, double supVoltage, double refCurrent)
+// Publishes a sample, with the heater state if it came with it (heater >= 0).
+void Model430::setCurrentData(qint64 time, double magField, double magCurrent, double magVoltage, double supCurrent, double supVoltage, double refCurrent, int heater)
 {
-	timestamp = time;
-	magnetField = magField;
-	magnetCurrent = magCurrent;
-	magnetVoltage = magVoltage;
-	supplyCurrent = supCurrent;
-	supplyVoltage = supVoltage;
-	referenceCurrent = refCurrent;
+	live.update([=](LiveState &s)
+	{
+		s.timestamp = time;
+		s.magnetField = magField;
+		s.magnetCurrent = magCurrent;
+		s.magnetVoltage = magVoltage;
+		s.supplyCurrent = supCurrent;
+		s.supplyVoltage = supVoltage;
+		s.referenceCurrent = refCurrent;
+
+		if (heater >= 0)
+			s.switchHeaterState = (heater != 0);
+	});
 }
 
 //---------------------------------------------------------------------------
\ No newline at end of file
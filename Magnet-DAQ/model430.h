@@ -5,7 +5,11 @@
 class Socket;
 
 #include <QObject>
+#include <QSettings>
+#include <atomic>
+#include <functional>
 #include "property.hpp"
+#include "seqlock.h"
 
 // definitions for summary status register bits
 #define EXT_RAMPDOWN_EVENT				0x02
@@ -161,6 +165,27 @@ enum class QueryState
 	IDLE_STATE
 };
 
+// views whose values are re-queried from the 430 only when stale (bit flags)
+enum SyncPage
+{
+	SUPPLY_SYNC = 0x001,
+	LOAD_SYNC = 0x002,
+	SWITCH_SYNC = 0x004,
+	PROTECTION_SYNC = 0x008,
+	RAMP_SYNC = 0x010,
+	RAMPDOWN_SYNC = 0x020,
+	RAMPDOWN_EVENTS_SYNC = 0x040,
+	QUENCH_EVENTS_SYNC = 0x080,
+	SETTINGS_SYNC = 0x100,	/* SETTINGS? dump */
+
+	SETUP_SYNC = SUPPLY_SYNC | LOAD_SYNC | SWITCH_SYNC | PROTECTION_SYNC | RAMP_SYNC,
+	CACHED_SYNC = SETUP_SYNC | RAMPDOWN_SYNC,	/* held in the configuration cache */
+	ALL_SYNC = 0x1FF
+};
+
+// query completion callback, ok is false on reply timeout or disconnect
+typedef std::function<void(bool ok)> QueryCallback;
+
 enum class State
 {
 	RAMPING = 1,
@@ -176,6 +201,22 @@ enum class State
 	EXTERNAL_RAMPDOWN
 };
 
+// latest measurements and state, published together for other threads
+struct LiveState
+{
+	qint64 timestamp;		// of the last sample
+	double magnetField;
+	double magnetCurrent;
+	double magnetVoltage;
+	double supplyCurrent;
+	double supplyVoltage;
+	double referenceCurrent;
+	double quenchCurrent;
+	int state;				// State, 0 before the first STATE? reply
+	bool switchHeaterState; // is pswitch heater on?
+	bool persistentState;	// is magnet in persistent mode?
+};
+
 
 class Model430 : public QObject {
 	Q_OBJECT
@@ -193,22 +234,30 @@ public:
 	void setRampdownFile(QString str);
 	void setQuenchFile(QString str);
 	void setSettings(QString str);
-	void setCurrentData(qint64 time, double magField, double magCurrent, double magVoltage, double supCurrent, double supVoltage, double refCurrent);
+	void setCurrentData(qint64 time, double magField, double magCurrent, double magVoltage, double supCurrent, double supVoltage, double refCurrent, int heater = -1);
+	void setSwitchHeaterState(bool on) { live.update([on](LiveState &s) { s.switchHeaterState = on; }); }
+	void setPersistentState(bool on) { live.update([on](LiveState &s) { s.persistentState = on; }); }
+	void setQuenchCurrent(double value) { live.update([value](LiveState &s) { s.quenchCurrent = value; }); }
+	LiveState liveState(void) const { return live.load(); }	// safe from any thread
 	void setIpName(QString str) { ipName = str; }
 	QString getIpName(void) { return ipName; }
+	QString getSettings(void) { return textSettings; }
+
+	// configuration cache, keyed by serial number
+	QString settingsDigest(void);
+	bool hasCachedConfiguration(QSettings *settings);
+	bool restoreCachedConfiguration(QSettings *settings);
+	void saveCachedConfiguration(QSettings *settings);
+
+	// stale tracking, marked by remote change notifications and local writes
+	void markStale(int pages) { stalePages.fetch_or(pages); }
+	void markSynced(int pages) { stalePages.fetch_and(~pages); }
+	bool isStale(int pages) { return (stalePages.load() & pages) != 0; }
+	static int commandSyncPages(const QString &cmd);
+	static int querySyncPages(QueryState aState);
 
 	// public data and properties
-	qint64 timestamp;
-	bool switchHeaterState; // is pswitch heater on?
-	bool persistentState;	// is magnet in persistent mode?
 	bool shortSampleMode;	// is system in short-sample mode?
-	double magnetField;
-	double magnetCurrent;
-	double magnetVoltage;
-	double supplyCurrent;
-	double supplyVoltage;
-	double quenchCurrent;
-	double referenceCurrent;
 
 	Property<double> firmwareVersion;
 	Property<QString> serialNumber;
@@ -298,6 +347,7 @@ signals:
 
 public slots:
 	void sync(void);
+	void syncStale(int pages);
 	void syncFieldUnits(void);
 	void syncSupplySetup(void);
 	void syncLoadSetup(void);
@@ -312,6 +362,7 @@ public slots:
 	void syncRampRates(void);
 	void syncRampSegmentValues(void);
 	void syncRampdownSegmentValues(void);
+	void syncVolatileValues(void);
 
 private:
 	Socket *socket;	// communication socket to 430
@@ -320,7 +371,10 @@ private:
 	QString textSettings;
 	QString firmwareSuffix;
 	QString ipName;
+	std::atomic<int> stalePages;	// SyncPage flags
+	SeqLock<LiveState> live;	// written on the GUI thread, read by the parser threads too
 
+	QString cacheGroup(void);
 	void valueChanged(QueryState);
 	void modeValueChanged(void);
 	void fieldUnitsChanged(void);
@@ -0,0 +1,57 @@
+#ifndef NUMBERCONV_H
+#define NUMBERCONV_H
+
+#include <QByteArray>
+#include <QLocale>
+#include <charconv>
+#include <cstring>
+
+//---------------------------------------------------------------------------
+// Locale-independent double conversion. Uses std::from_chars() and
+// to_chars(), which don't allocate, where the standard library has them for
+// floating point; older libc++ (macOS) and libstdc++ only have the integer
+// forms, there QByteArray does the conversion.
+//---------------------------------------------------------------------------
+
+// parses the number at first, returns the end of it or nullptr if there is
+// no valid number; like from_chars() no leading whitespace or '+'
+inline const char *parseDouble(const char *first, const char *last, double &value)
+{
+#if defined(__cpp_lib_to_chars)
+	std::from_chars_result result = std::from_chars(first, last, value);
+
+	return (result.ec == std::errc()) ? result.ptr : nullptr;
+#else
+	const char *stop = first;
+
+	while (stop < last && *stop != ',' && *stop != ' ' && *stop != '\r' && *stop != '\n')
+		stop++;
+
+	bool ok = false;
+
+	if (stop > first && *first != ' ' && *first != '+')
+		value = QByteArray::fromRawData(first, (int)(stop - first)).toDouble(&ok);
+
+	return ok ? stop : nullptr;
+#endif
+}
+
+// writes value with precision decimals, or in the shortest form that reads
+// back exactly if precision is negative; returns the end of the text
+inline char *formatDouble(char *first, char *last, double value, int precision = -1)
+{
+#if defined(__cpp_lib_to_chars)
+	if (precision < 0)
+		return std::to_chars(first, last, value).ptr;
+
+	return std::to_chars(first, last, value, std::chars_format::fixed, precision).ptr;
+#else
+	QByteArray text = (precision < 0) ? QByteArray::number(value, 'g', QLocale::FloatingPointShortest) : QByteArray::number(value, 'f', precision);
+	int length = qMin(text.size(), (int)(last - first));
+
+	memcpy(first, text.constData(), length);
+	return first + length;
+#endif
+}
+
+#endif // NUMBERCONV_H
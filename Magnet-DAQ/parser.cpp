@@ -2,6 +2,8 @@
 #include "parser.h"
 #include "socket.h"
 #include <iostream>
+#include <cstdarg>
+#include <climits>
 
 #if defined(Q_OS_LINUX) || defined(Q_OS_MACOS)
 #include <sys/time.h>
@@ -13,10 +15,13 @@
 #include <stdlib.h>
 #endif
 
-#define DELIMITER	":"		// colon
-#define SEPARATOR ": \t"	// colon, space, or tab
-#define SPACE " \t"			// space or tab
-#define COMMA ","			// comma
+const int BUFFER_SIZE = 1024;	// input line and reply buffers
+const int MAX_DEPTH = 4;		// keywords in a command header
+const bool QUERY = true;		// Parser::Command kinds
+const bool COMMAND = false;
+
+// keeps each reply or sample line whole on stdout, whatever thread writes it
+static QMutex stdoutMutex;
 
 /************************************************************
 	This file is designed to support using Magnet-DAQ as a
@@ -31,161 +36,58 @@
 	process is opened for each axis.
 
 	The Parser::process() method executes in a separate thread
-	from the user interface. I/O uses stdin and stdout.
+	from the user interface, waiting for stdin. Each line is
+	handled on the user interface thread, which owns the model.
+	I/O uses stdin and stdout.
 
 	To enable the parser function, use the command line
 	argument "-p" on Magnet-DAQ launch.
 
+	The same commands and queries are served to any number of
+	local clients with "-s <name>", see ControlServer. Each
+	client has its own Parser and error queue.
+
 	Please note that the QProcess functionality is not available
 	for UWP (Universal Windows) apps as the sandboxing does not
 	allow this type of interprocess communication.
 ************************************************************/
 
-//---------------------------------------------------------------------------
-// Command and query parsing tokens
-//---------------------------------------------------------------------------
-const char _SYST[] = "SYST";
-const char _SYSTEM[] = "SYSTEM";
-const char _ERR[] = "ERR";
-const char _ERROR[] = "ERROR";
-const char _EXIT[] = "EXIT";
-const char _COUN[] = "COUN";
-const char _COUNT[] = "COUNT";
-const char _CLS[] = "*CLS";
-const char _CONFIGURE[] = "CONFIGURE";
-const char _CONF[] = "CONF";
-const char _IDN[] = "*IDN";
-const char _INDUCTANCE[] = "INDUCTANCE";
-const char _IND[] = "IND";
-const char _PAUSE[] = "PAUSE";
-const char _PSWITCH[] = "PSWITCH";
-const char _PS[] = "PS";
-const char _RAMP[] = "RAMP";
-const char _ZERO[] = "ZERO";
-const char _CURR[] = "CURR";
-const char _CURRENT[] = "CURRENT";
-const char _VOLT[] = "VOLT";
-const char _VOLTAGE[] = "VOLTAGE";
-const char _LIM[] = "LIM";
-const char _LIMIT[] = "LIMIT";
-const char _SUPP[] = "SUPP";
-const char _SUPPLY[] = "SUPPLY";
-const char _MAG[] = "MAG";
-const char _MAGNET[] = "MAGNET";
-const char _TARG[] = "TARG";
-const char _TARGET[] = "TARGET";
-const char _COIL[] = "COIL";
-const char _COILCONST[] = "COILCONST";
-const char _FIELD[] = "FIELD";
-const char _UNITS[] = "UNITS";
-const char _STAB[] = "STAB";
-const char _STABILITY[] = "STABILITY";
-const char _RES[] = "RES";
-const char _RESISTOR[] = "RESISTOR";
-const char _MODE[] = "MODE";
-const char _RATE[] = "RATE";
-const char _SEG[] = "SEG";
-const char _SEGMENTS[] = "SEGMENTS";
-const char _STATE[] = "STATE";
-const char _QU[] = "QU";
-const char _QUENCH[] = "QUENCH";
-const char _POWERSUPPLYRAMPRATE[] = "POWERSUPPLYRAMPRATE";
-const char _PSRR[] = "PSRR";
-const char _HTIME[] = "HTIME";
-const char _HEATTIME[] = "HEATTIME";
-const char _CTIME[] = "CTIME";
-const char _COOLTIME[] = "COOLTIME";
-const char _CGAIN[] = "CGAIN";
-const char _COOLINGGAIN[] = "COOLINGGAIN";
-const char _TRAN[] = "TRAN";
-const char _TRANSITION[] = "TRANSITION";
-const char _INST[] = "INST";
-const char _INSTALLED[] = "INSTALLED";
-const char _PERS[] = "PERS";
-const char _PERSISTENT[] = "PERSISTENT";
-const char _REF[] = "REF";
-const char _REFERENCE[] = "REFERENCE";
-
-
 //---------------------------------------------------------------------------
 // Incoming data type tests and conversions
 //---------------------------------------------------------------------------
-char *struprt(char *str)
-{
-	if (str == NULL)
-		return NULL;
-
-#if defined(Q_OS_LINUX) || defined(Q_OS_MACOS)
-	char *next = str;
-	while (*next != '\0')
-	{
-		*next = toupper((unsigned char)*next);
-		next++;
-	}
-#else
-	str = _strupr(str);	// convert to all uppercase
-#endif
-	return str;
-}
-
-//---------------------------------------------------------------------------
-char *trimwhitespace(char *str)
-{
-	char *end;
-
-	// Trim leading space
-	while (isspace((unsigned char)*str)) str++;
-
-	if (*str == 0)  // All spaces?
-		return str;
-
-	// Trim trailing space
-	end = str + strlen(str) - 1;
-	while (end > str && isspace((unsigned char)*end)) end--;
-
-	// Write new null terminator character
-	end[1] = '\0';
-
-	return str;
-}
-
-//---------------------------------------------------------------------------
-bool isValue(const char* buf)
+bool isValue(std::string_view text)
 {
 	short digits = 0;   // digits
 	short sign = 0;     // optional sign
 	short dec = 0;      // optional mantissa decimal
 	short exp = 0;      // optional exponent indicator 'E'
+	size_t i = 0;
 
-	// must check for this first!
-	if (buf == NULL)
-		return false;
-
-	// skip all leading whitespace
+	// skip all leading and trailing whitespace
 	// no whitespace can occur within rest of string
-	// string is null terminated
-	while (isspace(*buf))
-		buf++;	// next character, NULL not considered whitespace
+	text = Scpi::trim(text);
 
 	// search for mantissa sign and digits
-	while (*buf != '\0' && !exp)
+	while (i < text.size() && !exp)
 	{
-		if (*buf == '+' || *buf == '-')
+		char c = text[i];
+
+		if (c == '+' || c == '-')
 		{
 			sign++;
 
 			if (sign > 1)	// more than one sign or it followed a digit/decimal
 				return false;
 
-			buf++;			// next character
+			i++;			// next character
 		}
-		else if (isdigit(*buf))
+		else if (isdigit((unsigned char)c))
 		{
 			digits++;
 			sign++;			// sign can't follow digit
-			buf++;			// next character
+			i++;			// next character
 		}
-		else if (*buf == '.')
+		else if (c == '.')
 		{
 			dec++;
 			sign++;			// sign can't follow decimal
@@ -193,15 +95,15 @@ bool isValue(const char* buf)
 			if (dec > 1)	// more than one decimal
 				return false;
 
-			buf++;			// next character
+			i++;			// next character
 		}
-		else if (*buf == 'E')
+		else if (c == 'E' || c == 'e')
 		{	// found exponent
 			if (!digits)	// need at least one mantissa digit before an exponent
 				return false;
 
 			exp++;
-			buf++;
+			i++;
 		}
 		else
 		{
@@ -216,20 +118,22 @@ bool isValue(const char* buf)
 	// possibly in exponent portion, search for exponent sign and digits
 	sign = 0;
 	digits = 0;
-	while (*buf != '\0' && exp)
+	while (i < text.size() && exp)
 	{
-		if (*buf == '+' || *buf == '-')
+		char c = text[i];
+
+		if (c == '+' || c == '-')
 		{
 			sign++;
 			if (sign > 1)	// more than one sign or it followed a digit/decimal
 				return false;
-			buf++;			// next character
+			i++;			// next character
 		}
-		else if (isdigit(*buf))
+		else if (isdigit((unsigned char)c))
 		{
 			digits++;
 			sign++;			// sign can't follow digit
-			buf++;			// next character
+			i++;			// next character
 		}
 		else
 		{
@@ -244,6 +148,56 @@ bool isValue(const char* buf)
 	return true;	// all tests satisfied, valid number
 }
 
+//---------------------------------------------------------------------------
+// A validated number, views point into the NUL-terminated input line and
+// end at a delimiter that strtod() stops at.
+double toValue(std::string_view text)
+{
+	return strtod(Scpi::trim(text).data(), NULL);
+}
+
+//---------------------------------------------------------------------------
+// Dispatch key of a header path, queries and commands kept apart
+quint64 commandKey(bool query, quint32 path)
+{
+	return (quint64)query << 32 | path;
+}
+
+//---------------------------------------------------------------------------
+// SUBScribe channel names, e.g. FIELD, CURR:SUPP, returns 0 if unknown
+//---------------------------------------------------------------------------
+int subscribeChannel(std::string_view item)
+{
+	ScpiCursor cursor(item);
+	quint32 path = 0;
+	int depth = 0;
+
+	for (std::string_view word = cursor.next(":"); !word.empty(); word = cursor.next(":"))
+	{
+		Keyword keyword = Scpi::lookup(word);
+
+		if (keyword == KW_NONE || depth == MAX_DEPTH)
+			return 0;
+
+		path |= (quint32)keyword << (24 - 8 * depth++);
+	}
+
+	switch (path)
+	{
+		case Scpi::path(KW_FIELD):				return SUB_FIELD;
+		case Scpi::path(KW_CURR):
+		case Scpi::path(KW_CURR, KW_MAG):		return SUB_CURRENT;
+		case Scpi::path(KW_CURR, KW_SUPP):		return SUB_SUPPLY_CURRENT;
+		case Scpi::path(KW_CURR, KW_REF):		return SUB_REF_CURRENT;
+		case Scpi::path(KW_VOLT):
+		case Scpi::path(KW_VOLT, KW_MAG):		return SUB_VOLTAGE;
+		case Scpi::path(KW_VOLT, KW_SUPP):		return SUB_SUPPLY_VOLTAGE;
+		case Scpi::path(KW_STATE):				return SUB_STATE;
+		case Scpi::path(KW_PS):					return SUB_HEATER;
+		default:								return 0;
+	}
+}
+
 //---------------------------------------------------------------------------
 // Class methods
 //---------------------------------------------------------------------------
@@ -253,6 +207,10 @@ Parser::Parser(QObject *parent)
 	stopParsing.store(false);
 	model430 = nullptr;
 	_parent = nullptr;
+	output = nullptr;
+	subscribeDivider.store(0);
+	subscribeChannels.store(SUB_ALL);
+	subscribeCount = 0;
 }
 
 //---------------------------------------------------------------------------
@@ -293,8 +251,8 @@ void Parser::process(void)
 
 		// allocate resources and start parsing
 		qDebug("Magnet-DAQ stdin Parser Start");
-		char input[1024];
-		char output[1024];
+		char input[BUFFER_SIZE];
+		char output[BUFFER_SIZE];
 
 #if defined(Q_OS_LINUX) || defined(Q_OS_MACOS)
 		fd_set read_fds;
@@ -349,13 +307,19 @@ void Parser::process(void)
 			if (input[0] != '\0')
 				qDebug() << QString(input);
 #endif
-			struprt(input);	// convert to all uppercase
+			if (stopParsing.load())
+				break;	// consumed by a stopped parser, see stop()
 
-			// save original string
-			inputStr = QString(input);
+			// the handlers read and write the model, so they run on its
+			// (GUI) thread; this thread only waits for stdin
+			QMetaObject::invokeMethod(model430, [this, &input, &output]()
+			{
+				// save original string
+				inputStr = QString(input);
 
-			// parse stdin
-			parseInput(input, output);
+				// parse stdin
+				parseInput(std::string_view(input), output);
+			}, Qt::BlockingQueuedConnection);
 		}
 
 		disconnect(this, SIGNAL(sendBlockingCommand(QString)), model430->getSocket(), SLOT(sendBlockingCommand(QString)));
@@ -365,6 +329,19 @@ void Parser::process(void)
 	emit finished();
 }
 
+//---------------------------------------------------------------------------
+// Parses a line from a client other than stdin, see ControlServer. Replies
+// go to the output device, the caller connects the signals.
+void Parser::parse(const char *line)
+{
+	char outputBuffer[BUFFER_SIZE];
+
+	// save original string
+	inputStr = QString(line);
+
+	parseInput(std::string_view(line), outputBuffer);
+}
+
 //---------------------------------------------------------------------------
 void Parser::addToErrorQueue(SystemError error)
 {
@@ -414,11 +391,15 @@ void Parser::addToErrorQueue(SystemError error)
 		errorStack.push(errMsg);
 		emit error_msg(errMsg);
 
+		// only the stdin parser runs off the GUI thread, where Beep() blocks
+		if (output == nullptr)
+		{
 #if defined(Q_OS_WIN)
-		Beep(1000, 600);
+			Beep(1000, 600);
 #else
-		QApplication::beep();
+			QApplication::beep();
 #endif
+		}
 	}
 }
 
@@ -430,1524 +411,852 @@ void Parser::addSystemError(QString errMsg)
 }
 
 //---------------------------------------------------------------------------
-void Parser::parseInput(char *commbuf, char* outputBuffer)
+// The SAMPle? reply, the whole latest sample from one consistent snapshot
+// as comma-separated values in this fixed order:
+//
+//	timestamp (Unix time in ms), magnet field, magnet current,
+//	supply current, magnet voltage, supply voltage, reference current,
+//	state, heater (0/1), persistent (0/1), quench current
+//
+// The field is in the present field units and only meaningful with a coil
+// constant. In short-sample mode the currents and voltages are the sample
+// current and voltage, as plotted.
+void Parser::formatLiveState(char *outputBuffer)
 {
-	char* word;    // string tokens
-	char* value;   // start of argument
-	char* pos;
+	LiveState live = model430->liveState();
 
-	pos = strchr(commbuf, '?');
+	sprintf(outputBuffer, "%lld,%0.10g,%0.10g,%0.10g,%0.10g,%0.10g,%0.10g,%d,%d,%d,%0.10g\n",
+		(long long)live.timestamp, live.magnetField, live.magnetCurrent,
+		live.supplyCurrent, live.magnetVoltage, live.supplyVoltage, live.referenceCurrent,
+		live.state, (int)live.switchHeaterState, (int)live.persistentState, live.quenchCurrent);
+}
 
-	/************************************************************
-	The command is a query.
-	************************************************************/
-	if (pos != NULL)
-	{		// found a ?
-			// terminate string at the question mark
-		*pos = '\0';
+//---------------------------------------------------------------------------
+// SUBScribe [<divider>[,<channel>,...]]
+//
+// Writes every <divider>th sample (default 1) to stdout as it is acquired,
+// until UNSUBScribe, as a line starting with '@' so it can be told apart
+// from query replies:
+//
+//	@timestamp (Unix time in ms),<channel values>
+//
+// The channels are FIELD, CURR[:MAG], CURR:SUPP, VOLT[:MAG], VOLT:SUPP,
+// CURR:REF, STATE and PS (heater, 0/1), default all. Values are always in
+// that order, as in the SAMPle? reply, whatever order they are listed in.
+// Stale samples (no reply from the 430) are not written. While subscribed
+// acquisition runs at the Magnet-DAQ sample rate limit.
+void Parser::subscribe(std::string_view text)
+{
+	ScpiCursor cursor(text);
+	int divider = 1;
+	int channels = 0;
+	bool first = true;
 
-		// get first token
-		word = strtok(commbuf, DELIMITER);
+	while (!text.empty() && !cursor.atEnd())
+	{
+		std::string_view item = cursor.field(',');
 
-		if (word == NULL)
+		if (first && isValue(item))
 		{
-			addToErrorQueue(ERR_UNRECOGNIZED_QUERY);
-			return; // no match
-		}
+			double value = toValue(item);
 
-		// switch on first character
-		switch (*word)
-		{
-			// tests: *IDN?,
-			case  '*':
-				if (!strcmp(word, _IDN))
-				{
-					QString version(qApp->applicationName() + "," + qApp->applicationVersion() + "\n");
-					std::cout.write(version.toLocal8Bit(), version.size());
-				}
-				else
-				{
-					addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match, error
-				}
-				break;
+			// range checked before the cast, also rejects huge values
+			if (!(value >= 1.0 && value <= INT_MAX))
+			{
+				addToErrorQueue(ERR_OUT_OF_RANGE);
+				return;
+			}
 
-			// I* queries
-			case  'I':
-				parse_query_I(word, outputBuffer);
-				break;
+			divider = (int)value;
+		}
+		else if (!item.empty() || !cursor.atEnd())
+		{
+			int channel = subscribeChannel(item);
 
-			// S* queries
-			case  'S':
-				parse_query_S(word, outputBuffer);
-				break;
+			if (channel == 0)
+			{
+				addToErrorQueue(ERR_INVALID_ARGUMENT);
+				return;
+			}
 
-			// V* queries
-			case  'V':
-				parse_query_V(word, outputBuffer);
-				break;
+			channels |= channel;
+		}
 
-			// C* queries
-			case  'C':
-				parse_query_C(word, outputBuffer);
-				break;
+		first = false;
+	}
 
-			// P* queries
-			case  'P':
-				parse_query_P(word, outputBuffer);
-				break;
+	subscribeChannels.store(channels ? channels : (int)SUB_ALL);
 
-			// Q* queries
-			case  'Q':
-				parse_query_Q(word, outputBuffer);
-				break;
+	if (subscribeDivider.exchange(divider) == 0)
+		emit subscriptionChanged(true);
+}
 
-			// R* queries
-			case  'R':
-				parse_query_R(word, outputBuffer);
-				break;
+//---------------------------------------------------------------------------
+// Writes a subscribed sample, see subscribe(). Runs on the GUI thread
+// as samples arrive, each line is written whole so it never splits a reply.
+void Parser::publishSample(const Sample &sample)
+{
+	int divider = subscribeDivider.load();
+
+	if (divider == 0 || sample.stale)
+		return;
+
+	if (++subscribeCount < divider)
+		return;
+
+	subscribeCount = 0;
+
+	int channels = subscribeChannels.load();
+	char line[256];
+	int length = sprintf(line, "@%lld", (long long)sample.time);
+
+	if (channels & SUB_FIELD)
+		length += sprintf(line + length, ",%0.10g", sample.magnetField);
+	if (channels & SUB_CURRENT)
+		length += sprintf(line + length, ",%0.10g", sample.magnetCurrent);
+	if (channels & SUB_SUPPLY_CURRENT)
+		length += sprintf(line + length, ",%0.10g", sample.supplyCurrent);
+	if (channels & SUB_VOLTAGE)
+		length += sprintf(line + length, ",%0.10g", sample.magnetVoltage);
+	if (channels & SUB_SUPPLY_VOLTAGE)
+		length += sprintf(line + length, ",%0.10g", sample.supplyVoltage);
+	if (channels & SUB_REF_CURRENT)
+		length += sprintf(line + length, ",%0.10g", sample.refCurrent);
+	if (channels & SUB_STATE)
+		length += sprintf(line + length, ",%d", (int)sample.state);
+	if (channels & SUB_HEATER)
+		length += sprintf(line + length, ",%d", (int)sample.heater);
+
+	line[length++] = '\n';
+	write(line, length);
+}
 
-			// F* queries
-			case  'F':
-				parse_query_F(word, outputBuffer);
-				break;
+//---------------------------------------------------------------------------
+// Writes a query reply
+void Parser::reply(char *outputBuffer, const char *format, ...)
+{
+	va_list args;
 
-			// O* queries
-			case 'O':
-				addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match, error
-				//parse_query_O(word, outputBuffer);
-				break;
+	va_start(args, format);
+	vsnprintf(outputBuffer, BUFFER_SIZE, format, args);
+	va_end(args);
 
-			// no match
-			default:
-				addToErrorQueue(ERR_UNRECOGNIZED_QUERY);
-				break;
-		}	// end switch on first word
+	write(outputBuffer, strlen(outputBuffer));
+}
 
-#if defined(Q_OS_LINUX) || defined(Q_OS_MACOS)
-		std::cout.flush();	// needed on Linux
-#endif
+//---------------------------------------------------------------------------
+// Replies and subscribed samples go to stdout or the output device; each
+// write to stdout is whole and flushed
+void Parser::write(const char *data, qint64 length)
+{
+	if (output)
+	{
+		output->write(data, length);
 	}
-
-	/************************************************************
-	The command is not a query (no return data).
-	************************************************************/
 	else
 	{
-		// get first token
-		word = strtok(commbuf, SEPARATOR);
-		if (word == NULL)
-		{
-			addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-			return; // no match
-		}
-
-		// switch on first character
-		switch (*word)
-		{
-			// tests *CLS
-			case '*':
-				if (!strcmp(word, _CLS))
-				{
-					errorStack.clear();
-				}
-				else
-				{
-					addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-				}
-				break;
-
-				// tests EXIT
-			case 'E':
-				if (strcmp(word, _EXIT) == 0)
-				{
-					emit exit_app();
-				}
-				else
-				{
-					addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-				}
-				break;
-
-			// tests all CONFigure commands
-			case  'C':
-				if (strcmp(word, _CONF) == 0 || strcmp(word, _CONFIGURE) == 0)
-				{
-					// get next token
-					word = strtok(NULL, SEPARATOR);
-					if (word == NULL)
-					{
-						addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-					}
-					else
-					{
-						parse_configure(word, outputBuffer);
-					}
-				}
-				else
-				{
-					addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-				}
-				break;
-
-			// tests RAMP
-			case  'R':
-				if (strcmp(word, _RAMP) == 0)
-				{
-					// get next token
-					word = strtok(NULL, DELIMITER);
-
-					// Check for the NULL condition here to make sure there are not additional args
-					if (word == NULL)
-					{
-						emit sendBlockingCommand(inputStr + "\r\n");
-					}
-					else
-					{
-						addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-					}
-				}
-				else
-				{
-					addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-				}
-				break;
-
-			// tests PSwitch 0|1,PAUSE
-			case  'P':
-				if (strcmp(word, _PS) == 0 || strcmp(word, _PSWITCH) == 0)
-				{
-					value = strtok(NULL, SPACE);		// look for value
-
-					if (isValue(value))
-					{
-						while (isspace(*value))
-							value++;
-
-						if (*value == '1' || *value == '0')
-						{
-							emit sendBlockingCommand(inputStr + "\r\n");
-						}
-						else
-						{
-							addToErrorQueue(ERR_NON_BOOLEAN_ARGUMENT);
-						}
-					}
-					else
-					{
-						if (value == NULL)
-							addToErrorQueue(ERR_MISSING_PARAMETER);
-						else
-							addToErrorQueue(ERR_INVALID_ARGUMENT);
-					}
-
-				}
-				else if (strcmp(word, _PAUSE) == 0)
-				{
-					emit sendBlockingCommand(inputStr + "\r\n");
-				}
-				else
-				{
-					addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-				}
-				break;
-
-				// tests ZERO
-			case  'Z':
-				if (strcmp(word, _ZERO) == 0)
-				{
-					// get next token
-					word = strtok(NULL, DELIMITER);
-
-					// Check for the NULL condition here to make sure there are not additional args
-					if (word == NULL)
-					{
-						emit sendBlockingCommand(inputStr + "\r\n");
-					}
-					else
-					{
-						addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-					}
-				}
-				else
-				{
-					addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-				}
-				break;
+		QMutexLocker lock(&stdoutMutex);
 
-			default:
-				addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-				break;
-		}
+		std::cout.write(data, length);
+		std::cout.flush();
 	}
 }
 
 //---------------------------------------------------------------------------
-// tests  CURRent:TARGet?, CURRent:MAGnet?, CURRent:SUPPly?
-//        CURRent:LIMit?, CURRent:REFerence?,  COILconst?
+// Passes a validated command on to the 430
+void Parser::forward(void)
+{
+	emit sendBlockingCommand(inputStr + "\r\n");
+}
+
 //---------------------------------------------------------------------------
-void Parser::parse_query_C(char* word, char* outputBuffer)
+// The first word of a numeric argument, queues an error if there is none
+bool Parser::numberArgument(std::string_view text, double &value)
 {
-	if (strcmp(word, _CURR) == 0 || strcmp(word, _CURRENT) == 0)
+	ScpiCursor cursor(text);
+	std::string_view word = cursor.next(" \t");
+
+	if (word.empty())
+	{
+		addToErrorQueue(ERR_MISSING_PARAMETER);
+		return false;
+	}
+	else if (!isValue(word))
 	{
-		word = strtok(NULL, DELIMITER);		// get next token
+		addToErrorQueue(ERR_INVALID_ARGUMENT);
+		return false;
+	}
 
-		if (word == NULL)
-		{
-			addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match, error
-		}
+	value = toValue(word);
+	return true;
+}
 
-		// CURRent:LIMit?
-		else if (strcmp(word, _LIM) == 0 || strcmp(word, _LIMIT) == 0)
-		{
-			sprintf(outputBuffer, "%0.10g\n", model430->currentLimit());
-			std::cout.write(outputBuffer, strlen(outputBuffer));
-		}
+//---------------------------------------------------------------------------
+// A 1-based ramp segment number as a 0-based index, -1 with an error queued
+// if it isn't a number or not a present segment
+int Parser::segmentArgument(std::string_view text)
+{
+	if (!isValue(text))
+	{
+		addToErrorQueue(ERR_INVALID_ARGUMENT);
+		return -1;
+	}
 
-		// CURRent:SUPPly?
-		else if (strcmp(word, _SUPP) == 0 || strcmp(word, _SUPPLY) == 0)
-		{
-			sprintf(outputBuffer, "%0.10g\n", model430->supplyCurrent);
-			std::cout.write(outputBuffer, strlen(outputBuffer));
-		}
+	double value = toValue(text);
 
-		// CURRent:MAGnet?
-		else if (strcmp(word, _MAG) == 0 || strcmp(word, _MAGNET) == 0)
-		{
-			sprintf(outputBuffer, "%0.10g\n", model430->magnetCurrent);
-			std::cout.write(outputBuffer, strlen(outputBuffer));
-		}
+	// range checked before the cast, the header may hold any number
+	if (!(value >= 1.0 && value <= model430->rampRateSegments()))
+	{
+		addToErrorQueue(ERR_OUT_OF_RANGE);	// ramp index out of range
+		return -1;
+	}
 
-		// CURRent:TARGet?
-		else if (strcmp(word, _TARG) == 0 || strcmp(word, _TARGET) == 0)
-		{
-			sprintf(outputBuffer, "%0.10g\n", model430->targetCurrent());
-			std::cout.write(outputBuffer, strlen(outputBuffer));
-		}
+	return (int)value - 1;
+}
 
-		// CURRent:REFerence?
-		else if (strcmp(word, _REF) == 0 || strcmp(word, _REFERENCE) == 0)
-		{
-			sprintf(outputBuffer, "%0.10g\n", model430->referenceCurrent);
-			std::cout.write(outputBuffer, strlen(outputBuffer));
-		}
+//---------------------------------------------------------------------------
+// A numeric argument whose first digit is one of choices, e.g. "01"
+bool Parser::choiceArgument(std::string_view text, const char *choices, SystemError invalid, int &value)
+{
+	ScpiCursor cursor(text);
+	std::string_view word = cursor.next(" \t");
 
-		else
-		{
-			addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match, error
-		}
+	if (word.empty())
+	{
+		addToErrorQueue(ERR_MISSING_PARAMETER);
+		return false;
 	}
-	else if (strcmp(word, _COIL) == 0 || strcmp(word, _COILCONST) == 0)
+	else if (!isValue(word))
 	{
-		sprintf(outputBuffer, "%0.10g\n", model430->coilConstant());
-		std::cout.write(outputBuffer, strlen(outputBuffer));
+		addToErrorQueue(ERR_INVALID_ARGUMENT);
+		return false;
 	}
-	else
+	else if (strchr(choices, word[0]) == NULL)
 	{
-		addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match, error
+		addToErrorQueue(invalid);
+		return false;
 	}
+
+	value = word[0] - '0';
+	return true;
 }
 
 //---------------------------------------------------------------------------
-// tests FIELD:MAGnet?, FIELD:TARGet?, FIELD:UNITS?
-//---------------------------------------------------------------------------
-void Parser::parse_query_F(char* word, char* outputBuffer)
+// <segment>,<rate>,<upper bound> of CONFigure:RAMP:RATE:CURRent|FIELD
+bool Parser::rampSegmentArguments(std::string_view text)
 {
-	if (strcmp(word, _FIELD) == 0)
+	ScpiCursor cursor(text);
+
+	for (int i = 0; i < 3; i++)
 	{
-		word = strtok(NULL, DELIMITER);	// get next token
+		std::string_view value = cursor.atEnd() ? std::string_view() : cursor.field(',');
 
-		if (word == NULL)
-		{
-			addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match, error
-		}
-		else if (strcmp(word, _MAG) == 0 || strcmp(word, _MAGNET) == 0)
-		{
-			if (model430->coilConstant() > 0.0)
-			{
-				sprintf(outputBuffer, "%0.10g\n", model430->magnetField);
-				std::cout.write(outputBuffer, strlen(outputBuffer));
-			}
-			else
-			{
-				addToErrorQueue(ERR_NO_COIL_CONSTANT);	// error -- no coil constant defined
-			}
-		}
-		else if (strcmp(word, _TARG) == 0 || strcmp(word, _TARGET) == 0)
+		if (value.empty())
 		{
-			if (model430->coilConstant() > 0.0)
-			{
-				sprintf(outputBuffer, "%0.10g\n", model430->targetField());
-				std::cout.write(outputBuffer, strlen(outputBuffer));
-			}
-			else
-			{
-				addToErrorQueue(ERR_NO_COIL_CONSTANT);	// error -- no coil constant defined
-			}
+			addToErrorQueue(ERR_MISSING_PARAMETER);
+			return false;
 		}
-		else if (strcmp(word, _UNITS) == 0)
+		else if (!isValue(value))
 		{
-			sprintf(outputBuffer, "%d\n", model430->fieldUnits());
-			std::cout.write(outputBuffer, strlen(outputBuffer));
+			addToErrorQueue(ERR_INVALID_ARGUMENT);
+			return false;
 		}
-		else
+
+		double checkValue = toValue(value);
+
+		if (i == 0 && !(checkValue > 0 && checkValue <= 10 && checkValue == (int)checkValue))
 		{
-			addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match, error
+			addToErrorQueue(ERR_OUT_OF_RANGE);
+			return false;
 		}
 	}
-	else
-	{
-		addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match, error
-	}
+
+	return true;
 }
 
 //---------------------------------------------------------------------------
-// tests INDuctance?
+// Splits a line into its header keywords and arguments and calls the
+// handler registered for the header in commands[]. Each header word costs
+// one hash and one compare, whatever the size of the command set.
+//
+// A query ends its header with '?', a command's arguments follow the
+// header after whitespace. A number in the header is passed on as the
+// parameter, e.g. the segment of RAMP:RATE:CURRent:<segment>?
 //---------------------------------------------------------------------------
-void Parser::parse_query_I(char* word, char* outputBuffer)
+void Parser::parseInput(std::string_view line, char *outputBuffer)
 {
-	if (strcmp(word, _IND) == 0 || strcmp(word, _INDUCTANCE) == 0)
-	{
-		word = strtok(NULL, DELIMITER);		// get next token
+	Arguments args;
+	std::string_view header;
 
-		if (word == NULL)	// return present inductance
-		{
-			sprintf(outputBuffer, "%0.2f\n", model430->inductance());
-			std::cout.write(outputBuffer, strlen(outputBuffer));
-		}
-		else
-		{
-			addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match, error
-		}
+	line = Scpi::trim(line);
+
+	size_t mark = line.find('?');
+	bool query = (mark != std::string_view::npos);
+
+	if (query)
+	{
+		header = line.substr(0, mark);
+		args.text = Scpi::trim(line.substr(mark + 1));
 	}
 	else
 	{
-		addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match, error
+		size_t space = line.find_first_of(" \t");
+
+		header = line.substr(0, space);
+
+		if (space != std::string_view::npos)
+			args.text = Scpi::trim(line.substr(space));
+	}
+
+	ScpiCursor cursor(header);
+	quint32 path = 0;
+	int depth = 0;
+	bool valid = true;
+
+	for (std::string_view word = cursor.next(":"); !word.empty() && valid; word = cursor.next(":"))
+	{
+		Keyword keyword = Scpi::lookup(word);
+
+		if (keyword != KW_NONE && depth < MAX_DEPTH && args.parameter.empty())
+			path |= (quint32)keyword << (24 - 8 * depth++);
+		else if (keyword == KW_NONE && depth > 0 && args.parameter.empty())
+			args.parameter = word;	// checked by the handler
+		else
+			valid = false;
 	}
+
+	const Command *command = valid ? commandIndex().value(commandKey(query, path), nullptr) : nullptr;
+
+	if (command == nullptr || command->parameter == args.parameter.empty())
+		addToErrorQueue(query ? ERR_UNRECOGNIZED_QUERY : ERR_UNRECOGNIZED_COMMAND);	// no match, error
+	else
+		command->handler(*this, args, outputBuffer);
 }
 
 //---------------------------------------------------------------------------
-// tests PSwitch:INSTalled?, PSwitch:CURRent?, PSwitch:TRANsition?,
-// PSwitch:HeatTIME?, PSwitch:CoolTime?, PSwitch:PowerSupplyRampeRate?
-// PSwitch:CoolingGAIN?
+// The supported subset of the Model 430 remote interface. To add a command
+// add its keywords to scpi.h and an entry here; the handler gets the
+// arguments after the header and a reply buffer.
 //---------------------------------------------------------------------------
-void Parser::parse_query_P(char* word, char* outputBuffer)
+const Parser::Command Parser::commands[] =
 {
-	if (strcmp(word, _PS) == 0 || strcmp(word, _PSWITCH) == 0)
-	{
-		word = strtok(NULL, DELIMITER);		// get next token
+	/************************************************************
+	Queries
+	************************************************************/
 
-		if (word == NULL)
-		{
-			sprintf(outputBuffer, "%d\n", (int)model430->switchHeaterState);
-			std::cout.write(outputBuffer, strlen(outputBuffer));
-		}
-		else if (strcmp(word, _CURR) == 0 || strcmp(word, _CURRENT) == 0)
+	// *IDN?
+	{ QUERY, Scpi::path(KW_IDN), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%s,%s\n", qPrintable(qApp->applicationName()), qPrintable(qApp->applicationVersion())); } },
+
+	// STATE?
+	{ QUERY, Scpi::path(KW_STATE), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%d\n", p.model430->liveState().state); } },
+
+	// SAMPle?
+	{ QUERY, Scpi::path(KW_SAMP), false, [](Parser &p, const Arguments &, char *outputBuffer)
 		{
-			sprintf(outputBuffer, "%0.1f\n", model430->switchCurrent());
-			std::cout.write(outputBuffer, strlen(outputBuffer));
-		}
-		else if (strcmp(word, _HTIME) == 0 || strcmp(word, _HEATTIME) == 0)
+			p.formatLiveState(outputBuffer);
+			p.write(outputBuffer, strlen(outputBuffer));
+		} },
+
+	// SYSTem:ERRor?
+	{ QUERY, Scpi::path(KW_SYST, KW_ERR), false, [](Parser &p, const Arguments &, char *outputBuffer)
 		{
-			sprintf(outputBuffer, "%d\n", model430->switchHeatedTime());
-			std::cout.write(outputBuffer, strlen(outputBuffer));
-		}
-		else if (strcmp(word, _CTIME) == 0 || strcmp(word, _COOLTIME) == 0)
+			if (p.errorStack.count())
+				p.reply(outputBuffer, "%s\n", p.errorStack.pop().toLocal8Bit().constData());
+			else
+				p.reply(outputBuffer, "0,\"No error\"\n");
+		} },
+
+	// SYSTem:ERRor:COUNt?
+	{ QUERY, Scpi::path(KW_SYST, KW_ERR, KW_COUN), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%d\n", (int)p.errorStack.count()); } },
+
+	// SYSTem:COMMunication?
+	// communication statistics: queries,timeouts,malformed,unsolicited,
+	// cmd queue depth,max cmd queue depth,mean,50%,99%,max query latency (us)
+	{ QUERY, Scpi::path(KW_SYST, KW_COMM), false, [](Parser &p, const Arguments &, char *outputBuffer)
 		{
-			sprintf(outputBuffer, "%d\n", model430->switchCooledTime());
-			std::cout.write(outputBuffer, strlen(outputBuffer));
-		}
-		else if (strcmp(word, _CGAIN) == 0 || strcmp(word, _COOLINGGAIN) == 0)
-		{
-			sprintf(outputBuffer, "%0.1f\n", model430->switchCoolingGain());
-			std::cout.write(outputBuffer, strlen(outputBuffer));
-		}
-		else if (strcmp(word, _INST) == 0 || strcmp(word, _INSTALLED) == 0)
-		{
-			sprintf(outputBuffer, "%d\n", (int)model430->switchInstalled());
-			std::cout.write(outputBuffer, strlen(outputBuffer));
-		}
-		else if (strcmp(word, _PSRR) == 0 || strcmp(word, _POWERSUPPLYRAMPRATE) == 0)
-		{
-			sprintf(outputBuffer, "%0.1f\n", model430->cooledSwitchRampRate());
-			std::cout.write(outputBuffer, strlen(outputBuffer));
-		}
-		else if (strcmp(word, _TRAN) == 0 || strcmp(word, _TRANSITION) == 0)
-		{
-			sprintf(outputBuffer, "%d\n", model430->switchTransition());
-			std::cout.write(outputBuffer, strlen(outputBuffer));
-		}
-		else
-		{
-			addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match, error
-		}
-	}
-	else if (strcmp(word, _PERS) == 0 || strcmp(word, _PERSISTENT) == 0)
-	{
-		sprintf(outputBuffer, "%d\n", (int)model430->persistentState);
-		std::cout.write(outputBuffer, strlen(outputBuffer));
-	}
-	else
-	{
-		addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match, error
-	}
-}
+			Socket *socket = p.model430->getSocket();
 
-//---------------------------------------------------------------------------
-// tests QUench:CURRent?
-//---------------------------------------------------------------------------
-void Parser::parse_query_Q(char* word, char* outputBuffer)
-{
-	if (strcmp(word, _QU) == 0 || strcmp(word, _QUENCH) == 0)
-	{
-		word = strtok(NULL, DELIMITER);	// get next token
-
-		if (word == NULL)
-		{
-			addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match, error
-		}
-		else if (strcmp(word, _CURR) == 0 || strcmp(word, _CURRENT) == 0)
-		{
-			sprintf(outputBuffer, "%0.10g\n", model430->quenchCurrent);
-			std::cout.write(outputBuffer, strlen(outputBuffer));
-		}
-		else
-		{
-			addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match, error
-		}
-	}
-	else
-	{
-		addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match, error
-	}
-}
+			if (socket)
+				p.reply(outputBuffer, "%s\n", socket->commStats().summary().toLocal8Bit().constData());
+			else
+				p.reply(outputBuffer, "0,0,0,0,0,0,0,0,0,0\n");
+		} },
 
-//---------------------------------------------------------------------------
-// tests RAMP:RATE:SEGments?, RAMP:RATE:UNITS?, RATE:RATE:CURRent:<segment>?,
-// RAMP:RATE:FIELD:<segment>?
-//---------------------------------------------------------------------------
-void Parser::parse_query_R(char* word, char* outputBuffer)
-{
-	char* value;   // start of argument
+	// INDuctance?
+	{ QUERY, Scpi::path(KW_IND), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%0.2f\n", p.model430->inductance()); } },
 
-	if (strcmp(word, _RAMP) == 0)
-	{
-		word = strtok(NULL, DELIMITER);	// get next token
+	// STABility?
+	{ QUERY, Scpi::path(KW_STAB), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%0.10g\n", p.model430->stabilitySetting()); } },
 
-		if (word == NULL)
-		{
-			addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match, error
-		}
+	// STABility:MODE?
+	{ QUERY, Scpi::path(KW_STAB, KW_MODE), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%d\n", p.model430->stabilityMode()); } },
 
-		// RAMP:RATE query group or RAMPDown:RATE query group
-		if (strcmp(word, _RATE) == 0)
-		{
-			word = strtok(NULL, DELIMITER);	// get next token
+	// STABility:RESistor?
+	{ QUERY, Scpi::path(KW_STAB, KW_RES), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%d\n", (int)p.model430->stabilityResistor()); } },
 
-			// we should check the NULL condition here since ramp:rate? isn't valid
-			if (word == NULL)
-			{
-				addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match, error
-			}
+	// VOLTage:SUPPly?
+	{ QUERY, Scpi::path(KW_VOLT, KW_SUPP), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%0.10g\n", p.model430->liveState().supplyVoltage); } },
 
-			// RAMP:RATE:CURRent query group
-			else if (strcmp(word, _CURR) == 0 || strcmp(word, _CURRENT) == 0)
-			{
-				value = strtok(NULL, DELIMITER);		// look for value
+	// VOLTage:LIMit?
+	{ QUERY, Scpi::path(KW_VOLT, KW_LIM), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%0.3f\n", p.model430->voltageLimit()); } },
 
-				// we should check the NULL condition here since ramp:rate:curr? is not valid
-				if (value == NULL)
-				{
-					addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match, error
-					return;
-				}
+	// VOLTage:MAGnet?
+	{ QUERY, Scpi::path(KW_VOLT, KW_MAG), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%0.10g\n", p.model430->liveState().magnetVoltage); } },
 
-				if (isValue(value))
-				{
-					int checkValue = (int)strtod(value, NULL) - 1;
-
-					if (checkValue >= 0 && checkValue < model430->rampRateSegments())
-					{
-						double current = model430->currentRampLimits[checkValue]();
-						double rate = model430->currentRampRates[checkValue]();
-
-						sprintf(outputBuffer, "%0.10g,%0.10g\n", rate, current);
-						std::cout.write(outputBuffer, strlen(outputBuffer));
-					}
-					else
-					{
-						addToErrorQueue(ERR_OUT_OF_RANGE);
-					}
-				}
-				else
-				{
-					addToErrorQueue(ERR_INVALID_ARGUMENT);
-				}
-			}
+	// CURRent:LIMit?
+	{ QUERY, Scpi::path(KW_CURR, KW_LIM), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%0.10g\n", p.model430->currentLimit()); } },
 
-			// RAMP:RATE:FIELD query group
-			else if (strcmp(word, _FIELD) == 0)
-			{
-				if (model430->coilConstant() > 0.0)
-				{
-					value = strtok(NULL, DELIMITER);		// look for value
-
-					// we should check the NULL condition here since ramp:rate:field? isn't valid
-					if (value == NULL)
-					{
-						addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match, error
-						return;
-					}
-
-					if (isValue(value))
-					{
-						int checkValue = (int)strtod(value, NULL) - 1;
-
-						if (checkValue >= 0 && checkValue < model430->rampRateSegments())
-						{
-							double current = model430->fieldRampLimits[checkValue]();
-							double rate = model430->fieldRampRates[checkValue]();
-
-							sprintf(outputBuffer, "%0.10g,%0.10g\n", rate, current);
-							std::cout.write(outputBuffer, strlen(outputBuffer));
-						}
-						else
-						{
-							addToErrorQueue(ERR_OUT_OF_RANGE);	// ramp index out of range
-						}
-					}
-					else
-					{
-						addToErrorQueue(ERR_INVALID_ARGUMENT);
-					}
-				}
-				else
-				{
-					addToErrorQueue(ERR_NO_COIL_CONSTANT);	// error -- no coil constant defined
-				}
-			}
+	// CURRent:SUPPly?
+	{ QUERY, Scpi::path(KW_CURR, KW_SUPP), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%0.10g\n", p.model430->liveState().supplyCurrent); } },
 
-			// RAMP:RATE:UNITS?
-			else if (strcmp(word, _UNITS) == 0)
-			{
-				sprintf(outputBuffer, "%d\n", model430->rampRateTimeUnits());
-				std::cout.write(outputBuffer, strlen(outputBuffer));
-			}
+	// CURRent:MAGnet?
+	{ QUERY, Scpi::path(KW_CURR, KW_MAG), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%0.10g\n", p.model430->liveState().magnetCurrent); } },
 
-			// RAMP:RATE:SEGments query group
-			else if (strcmp(word, _SEG) == 0 || strcmp(word, _SEGMENTS) == 0)
-			{
-				sprintf(outputBuffer, "%d\n", model430->rampRateSegments());
-				std::cout.write(outputBuffer, strlen(outputBuffer));
-			}
+	// CURRent:TARGet?
+	{ QUERY, Scpi::path(KW_CURR, KW_TARG), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%0.10g\n", p.model430->targetCurrent()); } },
 
-			else
-			{
-				addToErrorQueue(ERR_UNRECOGNIZED_QUERY); //no match, error
-			}
-		}
-		else
-		{
-			addToErrorQueue(ERR_UNRECOGNIZED_QUERY); //no match, error
-		}
-	}
-	else
-	{
-		addToErrorQueue(ERR_UNRECOGNIZED_QUERY); //no match, error
-	}
-}
+	// CURRent:REFerence?
+	{ QUERY, Scpi::path(KW_CURR, KW_REF), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%0.10g\n", p.model430->liveState().referenceCurrent); } },
 
-//---------------------------------------------------------------------------
-// tests STATE?, SYSTem:ERRor?, SYSTem:COUNt?, STABility?, STABility:MODE?,
-// STABility:RESistor?
-//---------------------------------------------------------------------------
-void Parser::parse_query_S(char* word, char* outputBuffer)
-{
-	if (!strcmp(word, _STATE))
-	{
-		QString tmpStr(QString::number((int)(model430->state())) + "\n");
-		std::cout.write(tmpStr.toLocal8Bit(), tmpStr.size());
-	}
-	else if (strcmp(word, _SYST) == 0 || strcmp(word, _SYSTEM) == 0)
-	{
-		// get next token
-		word = strtok(NULL, SEPARATOR);
+	// COILconst?
+	{ QUERY, Scpi::path(KW_COIL), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%0.10g\n", p.model430->coilConstant()); } },
 
-		if (word == NULL)
+	// FIELD:MAGnet?
+	{ QUERY, Scpi::path(KW_FIELD, KW_MAG), false, [](Parser &p, const Arguments &, char *outputBuffer)
 		{
-			addToErrorQueue(ERR_UNRECOGNIZED_QUERY); // no match, error
-		}
-		else if (strcmp(word, _ERR) == 0 || strcmp(word, _ERROR) == 0)
-		{
-			// get next token
-			word = strtok(NULL, SEPARATOR);
-
-			if (word == NULL)
-			{
-				if (errorStack.count())
-					sprintf(outputBuffer, "%s\n", errorStack.pop().toLocal8Bit().constData());
-				else
-					sprintf(outputBuffer, "0,\"No error\"\n");
-
-				std::cout.write(outputBuffer, strlen(outputBuffer));
-			}
-			else if (strcmp(word, _COUN) == 0 || strcmp(word, _COUNT) == 0)
-			{
-				// get next token
-				word = strtok(NULL, SEPARATOR);
-
-				if (word == NULL)
-				{
-					sprintf(outputBuffer, "%d\n", (int)errorStack.count());
-					std::cout.write(outputBuffer, strlen(outputBuffer));
-				}
-			}
+			if (p.model430->coilConstant() > 0.0)
+				p.reply(outputBuffer, "%0.10g\n", p.model430->liveState().magnetField);
 			else
-			{
-				addToErrorQueue(ERR_UNRECOGNIZED_QUERY); // no match, error
-			}
-		}
-		else
-		{
-			addToErrorQueue(ERR_UNRECOGNIZED_QUERY); //no match, error
-		}
-	}
-	else if (strcmp(word, _STAB) == 0 || strcmp(word, _STABILITY) == 0)
-	{
-		// get next token
-		word = strtok(NULL, DELIMITER);
+				p.addToErrorQueue(ERR_NO_COIL_CONSTANT);	// error -- no coil constant defined
+		} },
 
-		if (word == NULL)	// return stability setting
+	// FIELD:TARGet?
+	{ QUERY, Scpi::path(KW_FIELD, KW_TARG), false, [](Parser &p, const Arguments &, char *outputBuffer)
 		{
-			sprintf(outputBuffer, "%0.10g\n", model430->stabilitySetting());
-			std::cout.write(outputBuffer, strlen(outputBuffer));
-		}
-		else if (strcmp(word, _MODE) == 0)	// return stability mode
-		{
-			sprintf(outputBuffer, "%d\n", model430->stabilityMode());
-			std::cout.write(outputBuffer, strlen(outputBuffer));
-		}
-		else if (strcmp(word, _RES) == 0 || strcmp(word, _RESISTOR) == 0)	// return stabilizing resistor installed?
-		{
-			sprintf(outputBuffer, "%d\n", (int)model430->stabilityResistor());
-			std::cout.write(outputBuffer, strlen(outputBuffer));
-		}
-		else
-		{
-			addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match
-		}
-	}
-	else
-	{
-		addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match, error
-	}
-}
+			if (p.model430->coilConstant() > 0.0)
+				p.reply(outputBuffer, "%0.10g\n", p.model430->targetField());
+			else
+				p.addToErrorQueue(ERR_NO_COIL_CONSTANT);	// error -- no coil constant defined
+		} },
 
-//---------------------------------------------------------------------------
-// tests VOLTage:LIMit?, VOLTage:MAGnet?, VOLTage:SUPPly?
-//---------------------------------------------------------------------------
-void Parser::parse_query_V(char* word, char* outputBuffer)
-{
-	if (strcmp(word, _VOLT) == 0 || strcmp(word, _VOLTAGE) == 0)
-	{
-		word = strtok(NULL, DELIMITER);		// get next token
-		if (word == NULL)
-		{
-			addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match, error
-		}
-		else if (strcmp(word, _SUPP) == 0 || strcmp(word, _SUPPLY) == 0)
-		{
-			sprintf(outputBuffer, "%0.10g\n", model430->supplyVoltage);
-			std::cout.write(outputBuffer, strlen(outputBuffer));
-		}
-		else if (strcmp(word, _LIM) == 0 || strcmp(word, _LIMIT) == 0)
-		{
-			sprintf(outputBuffer, "%0.3f\n", model430->voltageLimit());
-			std::cout.write(outputBuffer, strlen(outputBuffer));
-		}
-		else if (strcmp(word, _MAG) == 0 || strcmp(word, _MAGNET) == 0)
-		{
-			sprintf(outputBuffer, "%0.10g\n", model430->magnetVoltage);
-			std::cout.write(outputBuffer, strlen(outputBuffer));
-		}
-		else
-		{
-			addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match, error
-		}
-	}
-	else
-	{
-		addToErrorQueue(ERR_UNRECOGNIZED_QUERY);	// no match, error
-	}
-}
+	// FIELD:UNITS?
+	{ QUERY, Scpi::path(KW_FIELD, KW_UNITS), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%d\n", p.model430->fieldUnits()); } },
 
-//---------------------------------------------------------------------------
-//	 Parses all CONFigure commands. These are broken out of
-//   parseInput() for easier reading.
-//---------------------------------------------------------------------------
-void Parser::parse_configure(const char* word, char *outputBuffer)
-{
-	if (word == NULL)
-	{
-		addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-	}
-	else
-	{
-		switch (*word)
-		{
-			// CONFigure:I* commands
-			case  'I':
-				parse_configure_I(word, outputBuffer);
-				break;
+	// PSwitch?
+	{ QUERY, Scpi::path(KW_PS), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%d\n", (int)p.model430->liveState().switchHeaterState); } },
 
-			// CONFigure:V* commands
-			case  'V':
-				parse_configure_V(word, outputBuffer);
-				break;
+	// PSwitch:CURRent?
+	{ QUERY, Scpi::path(KW_PS, KW_CURR), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%0.1f\n", p.model430->switchCurrent()); } },
 
-			// CONFigure:C* commands
-			case  'C':
-				parse_configure_C(word, outputBuffer);
-				break;
+	// PSwitch:HeatTIME?
+	{ QUERY, Scpi::path(KW_PS, KW_HTIME), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%d\n", p.model430->switchHeatedTime()); } },
 
-			// CONFigure:R* commands
-			case  'R':
-				parse_configure_R(word, outputBuffer);
-				break;
+	// PSwitch:CoolTIME?
+	{ QUERY, Scpi::path(KW_PS, KW_CTIME), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%d\n", p.model430->switchCooledTime()); } },
 
-			// CONFigure:F* commands
-			case  'F':
-				parse_configure_F(word, outputBuffer);
-				break;
+	// PSwitch:CoolingGAIN?
+	{ QUERY, Scpi::path(KW_PS, KW_CGAIN), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%0.1f\n", p.model430->switchCoolingGain()); } },
 
-			// CONFigure:P* commands
-			case  'P':
-				parse_configure_P(word, outputBuffer);
-				break;
+	// PSwitch:INSTalled?
+	{ QUERY, Scpi::path(KW_PS, KW_INST), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%d\n", (int)p.model430->switchInstalled()); } },
 
-			// CONFigure:Q* commands
-			case  'Q':
-				addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-				//parse_configure_Q(word);
-				break;
+	// PSwitch:PowerSupplyRampRate?
+	{ QUERY, Scpi::path(KW_PS, KW_PSRR), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%0.1f\n", p.model430->cooledSwitchRampRate()); } },
 
-			// CONFigure:S* commands
-			case  'S':
-				parse_configure_S(word, outputBuffer);
-				break;
+	// PSwitch:TRANsition?
+	{ QUERY, Scpi::path(KW_PS, KW_TRAN), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%d\n", p.model430->switchTransition()); } },
 
-			default:
-				addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-				break;
-		}	// end switch(*word) for CONF
-	}
-}
+	// PERSistent?
+	{ QUERY, Scpi::path(KW_PERS), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%d\n", (int)p.model430->liveState().persistentState); } },
 
-//---------------------------------------------------------------------------
-// tests CONFigure:CURRent:TARGet, CONFigure:CURRent:LIMit,
-//       CONFigure:COILconst
-//---------------------------------------------------------------------------
-void Parser::parse_configure_C(const char* word, char *outputBuffer)
-{
-	if (strcmp(word, _CURR) == 0 || strcmp(word, _CURRENT) == 0)
-	{
-		word = strtok(NULL, SEPARATOR);		// get next token
+	// QUench:CURRent?
+	{ QUERY, Scpi::path(KW_QU, KW_CURR), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%0.10g\n", p.model430->liveState().quenchCurrent); } },
 
-		if (word == NULL)
+	// RAMP:RATE:CURRent:<segment>?
+	{ QUERY, Scpi::path(KW_RAMP, KW_RATE, KW_CURR), true, [](Parser &p, const Arguments &args, char *outputBuffer)
 		{
-			addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-		}
+			int segment = p.segmentArgument(args.parameter);
 
-		// CONFigure:CURRent:LIMit...
-		else if (strcmp(word, _LIM) == 0 || strcmp(word, _LIMIT) == 0)
-		{
-			word = strtok(NULL, SEPARATOR);	// get next token
+			if (segment >= 0)
+				p.reply(outputBuffer, "%0.10g,%0.10g\n", p.model430->currentRampRates[segment](), p.model430->currentRampLimits[segment]());
+		} },
 
-			// CONFigure:CURRent:LIMit
-			if (isValue(word))
-			{
-				double temp = strtod(word, NULL);
-				emit sendBlockingCommand(inputStr + "\r\n");
-				model430->currentLimit = temp;
-			}
-			else
+	// RAMP:RATE:FIELD:<segment>?
+	{ QUERY, Scpi::path(KW_RAMP, KW_RATE, KW_FIELD), true, [](Parser &p, const Arguments &args, char *outputBuffer)
+		{
+			if (p.model430->coilConstant() <= 0.0)
 			{
-				if (word == NULL)
-					addToErrorQueue(ERR_MISSING_PARAMETER);
-				else
-					addToErrorQueue(ERR_INVALID_ARGUMENT);
+				p.addToErrorQueue(ERR_NO_COIL_CONSTANT);	// error -- no coil constant defined
+				return;
 			}
-		}
 
-		// CONFigure:CURRent:TARGet
-		else if (strcmp(word, _TARG) == 0 || strcmp(word, _TARGET) == 0)
-		{
-			char *value = strtok(NULL, SPACE);		// look for value
+			int segment = p.segmentArgument(args.parameter);
 
-			if (isValue(value))
-			{
-				double temp = strtod(value, NULL);
-				emit sendBlockingCommand(inputStr + "\r\n");
-				model430->targetCurrent = temp;
-			}
-			else
-			{
-				if (value == NULL)
-					addToErrorQueue(ERR_MISSING_PARAMETER);
-				else
-					addToErrorQueue(ERR_INVALID_ARGUMENT);
-			}
-		}
+			if (segment >= 0)
+				p.reply(outputBuffer, "%0.10g,%0.10g\n", p.model430->fieldRampRates[segment](), p.model430->fieldRampLimits[segment]());
+		} },
 
-		else
-		{
-			addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-		}
-	}	// end if CURR
+	// RAMP:RATE:UNITS?
+	{ QUERY, Scpi::path(KW_RAMP, KW_RATE, KW_UNITS), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%d\n", p.model430->rampRateTimeUnits()); } },
 
-	// CONFigure:COILconst
-	else if (strcmp(word, _COIL) == 0 || strcmp(word, _COILCONST) == 0)
-	{
-		char *value = strtok(NULL, SPACE);		// look for value
+	// RAMP:RATE:SEGments?
+	{ QUERY, Scpi::path(KW_RAMP, KW_RATE, KW_SEG), false, [](Parser &p, const Arguments &, char *outputBuffer)
+		{ p.reply(outputBuffer, "%d\n", p.model430->rampRateSegments()); } },
 
-		if (isValue(value))
-		{
-			double temp = strtod(value, NULL);
-			emit sendBlockingCommand(inputStr + "\r\n");
-			model430->coilConstant = temp;
-		}
-		else
-		{
-			if (value == NULL)
-				addToErrorQueue(ERR_MISSING_PARAMETER);
-			else
-				addToErrorQueue(ERR_INVALID_ARGUMENT);
-		}
-	}	// end if COIL
-	else
-	{
-		addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-	}
-}
+	/************************************************************
+	Commands (no return data)
+	************************************************************/
 
-//---------------------------------------------------------------------------
-// tests CONFigure:FIELD:TARGet, CONFigure:FIELD:UNITS
-//---------------------------------------------------------------------------
-void Parser::parse_configure_F(const char* word, char *outputBuffer)
-{
-	if (strcmp(word, _FIELD) == 0)
-	{
-		word = strtok(NULL, SEPARATOR);	// get next token
+	// *CLS
+	{ COMMAND, Scpi::path(KW_CLS), false, [](Parser &p, const Arguments &, char *)
+		{ p.errorStack.clear(); } },
 
-		if (word == NULL)
-		{
-			addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-		}
+	// EXIT
+	{ COMMAND, Scpi::path(KW_EXIT), false, [](Parser &p, const Arguments &, char *)
+		{ emit p.exit_app(); } },
 
-		// CONFigure:FIELD:TARGet
-		else if (strcmp(word, _TARG) == 0 || strcmp(word, _TARGET) == 0)
-		{
-			char *value = strtok(NULL, SPACE);	// look for value
+	// SUBScribe [<divider>[,<channel>...]]
+	{ COMMAND, Scpi::path(KW_SUBS), false, [](Parser &p, const Arguments &args, char *)
+		{ p.subscribe(args.text); } },
 
-			if (isValue(value))
-			{
-				double temp = strtod(value, NULL);
-				emit sendBlockingCommand(inputStr + "\r\n");
-				model430->targetField = temp;
-			}
-			else
-			{
-				if (value == NULL)
-					addToErrorQueue(ERR_MISSING_PARAMETER);
-				else
-					addToErrorQueue(ERR_INVALID_ARGUMENT);
-			}
-		}
-		// CONFigure:FIELD:UNITS
-		else if (strcmp(word, _UNITS) == 0)
+	// UNSUBScribe
+	{ COMMAND, Scpi::path(KW_UNSUBS), false, [](Parser &p, const Arguments &, char *)
 		{
-			char *value = strtok(NULL, SPACE);	// look for value
-
-			if (isValue(value))
-			{
-				while (isspace(*value))
-					value++;
+			if (p.subscribeDivider.exchange(0) > 0)
+				emit p.subscriptionChanged(false);
+		} },
 
-				if (*value == '1' || *value == '0')
-				{
-					emit sendBlockingCommand(inputStr + "\r\n");
-					model430->fieldUnits = atoi(value);
-				}
-				else
-				{
-					addToErrorQueue(ERR_INVALID_ARGUMENT);
-				}
-			}
-			else
-			{
-				if (value == NULL)
-					addToErrorQueue(ERR_MISSING_PARAMETER);
-				else
-					addToErrorQueue(ERR_INVALID_ARGUMENT);
-			}
-		}
-		else
+	// RAMP
+	{ COMMAND, Scpi::path(KW_RAMP), false, [](Parser &p, const Arguments &args, char *)
 		{
-			addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-		}
-	}
-	else
-	{
-		addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-	}
-}
+			if (args.text.empty())
+				p.forward();
+			else
+				p.addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no additional args
+		} },
 
-//---------------------------------------------------------------------------
-// tests CONFigure:INDuctance
-//---------------------------------------------------------------------------
-void Parser::parse_configure_I(const char* word, char *outputBuffer)
-{
-	if (strcmp(word, _IND) == 0 || strcmp(word, _INDUCTANCE) == 0)
-	{
-		word = strtok(NULL, SEPARATOR);	// get next token
+	// PAUSE
+	{ COMMAND, Scpi::path(KW_PAUSE), false, [](Parser &p, const Arguments &, char *)
+		{ p.forward(); } },
 
-		if (isValue(word))
-		{
-			double temp = strtod(word, NULL);
-			emit sendBlockingCommand(inputStr + "\r\n");
-			model430->inductance = temp;
-		}
-		else
+	// ZERO
+	{ COMMAND, Scpi::path(KW_ZERO), false, [](Parser &p, const Arguments &args, char *)
 		{
-			if (word == NULL)
-				addToErrorQueue(ERR_MISSING_PARAMETER);
+			if (args.text.empty())
+				p.forward();
 			else
-				addToErrorQueue(ERR_INVALID_ARGUMENT);
-		}
-	}
-	else
-	{
-		addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-	}
-}
-
-//---------------------------------------------------------------------------
-// tests CONFigure:PSwitch,          CONFigure:PSwitch:CURRent,             CONFigure:PSwitch:HeatTIME,
-//       CONFigure:PSwitch:CoolTIME, CONFigure:PSwitch:PowerSupplyRampRate, CONFigure:PSwitch:CoolingGAIN,
-//		 CONFigure:PSwitch:TRANsition
-//---------------------------------------------------------------------------
-void Parser::parse_configure_P(const char* word, char *outputBuffer)
-{
-	if (strcmp(word, _PS) == 0 || strcmp(word, _PSWITCH) == 0)
-	{
-		word = strtok(NULL, SEPARATOR); // get next token
+				p.addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no additional args
+		} },
 
-		if (word == NULL)
+	// PSwitch 0|1
+	{ COMMAND, Scpi::path(KW_PS), false, [](Parser &p, const Arguments &args, char *)
 		{
-			addToErrorQueue(ERR_MISSING_PARAMETER);	// no argument
-		}
+			int value;
 
-		// CONFigure:PSwitch:CURRent
-		else if (strcmp(word, _CURR) == 0 || strcmp(word, _CURRENT) == 0)
+			if (p.choiceArgument(args.text, "01", ERR_NON_BOOLEAN_ARGUMENT, value))
+				p.forward();
+		} },
+
+	// CONFigure:CURRent:LIMit
+	{ COMMAND, Scpi::path(KW_CONF, KW_CURR, KW_LIM), false, [](Parser &p, const Arguments &args, char *)
 		{
-			char *value = strtok(NULL, SPACE);	// look for value
+			double value;
 
-			if (isValue(value))
+			if (p.numberArgument(args.text, value))
 			{
-				double temp = strtod(value, NULL);
-				emit sendBlockingCommand(inputStr + "\r\n");
-				model430->switchCurrent = temp;
+				p.forward();
+				p.model430->currentLimit = value;
 			}
-			else
-			{
-				if (value == NULL)
-					addToErrorQueue(ERR_MISSING_PARAMETER);
-				else
-					addToErrorQueue(ERR_INVALID_ARGUMENT);
-			}
-		}
+		} },
 
-		// CONFigure:PSwitch:PowerSupplyRampRate
-		else if (strcmp(word, _PSRR) == 0 || strcmp(word, _POWERSUPPLYRAMPRATE) == 0)
+	// CONFigure:CURRent:TARGet
+	{ COMMAND, Scpi::path(KW_CONF, KW_CURR, KW_TARG), false, [](Parser &p, const Arguments &args, char *)
 		{
-			char *value = strtok(NULL, SPACE);
-			if (isValue(value))
-			{
-				double temp = strtod(value, NULL);
-				emit sendBlockingCommand(inputStr + "\r\n");
-				model430->cooledSwitchRampRate = temp;
-			}
-			else
+			double value;
+
+			if (p.numberArgument(args.text, value))
 			{
-				if (value == NULL)
-					addToErrorQueue(ERR_MISSING_PARAMETER);
-				else
-					addToErrorQueue(ERR_INVALID_ARGUMENT);
+				p.forward();
+				p.model430->targetCurrent = value;
 			}
-		}
+		} },
 
-		// CONFigure:PSwitch:HeatTIME
-		else if (strcmp(word, _HTIME) == 0 || strcmp(word, _HEATTIME) == 0)
+	// CONFigure:COILconst
+	{ COMMAND, Scpi::path(KW_CONF, KW_COIL), false, [](Parser &p, const Arguments &args, char *)
 		{
-			char *value = strtok(NULL, SPACE);	// look for value
+			double value;
 
-			if (isValue(value))
+			if (p.numberArgument(args.text, value))
 			{
-				double temp = strtod(value, NULL);
-				emit sendBlockingCommand(inputStr + "\r\n");
-				model430->switchHeatedTime = temp;
+				p.forward();
+				p.model430->coilConstant = value;
 			}
-			else
-			{
-				if (value == NULL)
-					addToErrorQueue(ERR_MISSING_PARAMETER);
-				else
-					addToErrorQueue(ERR_INVALID_ARGUMENT);
-			}
-		}
+		} },
 
-		// CONFigure:PSwitch:CoolTIME
-		else if (strcmp(word, _CTIME) == 0 || strcmp(word, _COOLTIME) == 0)
+	// CONFigure:FIELD:TARGet
+	{ COMMAND, Scpi::path(KW_CONF, KW_FIELD, KW_TARG), false, [](Parser &p, const Arguments &args, char *)
 		{
-			char *value = strtok(NULL, SPACE);	// look for value
+			double value;
 
-			if (isValue(value))
-			{
-				double temp = strtod(value, NULL);
-				emit sendBlockingCommand(inputStr + "\r\n");
-				model430->switchCooledTime = temp;
-			}
-			else
+			if (p.numberArgument(args.text, value))
 			{
-				if (value == NULL)
-					addToErrorQueue(ERR_MISSING_PARAMETER);
-				else
-					addToErrorQueue(ERR_INVALID_ARGUMENT);
+				p.forward();
+				p.model430->targetField = value;
 			}
-		}
+		} },
 
-		// CONFigure:PSwitch:CoolingGAIN
-		else if (strcmp(word, _CGAIN) == 0 || strcmp(word, _COOLINGGAIN) == 0)
+	// CONFigure:FIELD:UNITS 0|1
+	{ COMMAND, Scpi::path(KW_CONF, KW_FIELD, KW_UNITS), false, [](Parser &p, const Arguments &args, char *)
 		{
-			char *value = strtok(NULL, SPACE);	// look for value
+			int value;
 
-			if (isValue(value))
+			if (p.choiceArgument(args.text, "01", ERR_INVALID_ARGUMENT, value))
 			{
-				double temp = strtod(value, NULL);
-				emit sendBlockingCommand(inputStr + "\r\n");
-				model430->switchCoolingGain = temp;
+				p.forward();
+				p.model430->fieldUnits = value;
 			}
-			else
-			{
-				if (value == NULL)
-					addToErrorQueue(ERR_MISSING_PARAMETER);
-				else
-					addToErrorQueue(ERR_INVALID_ARGUMENT);
-			}
-		}
+		} },
 
-		// CONFigure:PSwitch:TRANsition
-		else if (strcmp(word, _TRAN) == 0 || strcmp(word, _TRANSITION) == 0)
+	// CONFigure:INDuctance
+	{ COMMAND, Scpi::path(KW_CONF, KW_IND), false, [](Parser &p, const Arguments &args, char *)
 		{
-			char *value = strtok(NULL, SPACE);	// look for value
+			double value;
 
-			if (isValue(value))
+			if (p.numberArgument(args.text, value))
 			{
-				while (isspace(*value))
-					value++;
-
-				if (*value == '0' || *value == '1')
-				{
-					emit sendBlockingCommand(inputStr + "\r\n");
-					model430->switchTransition = atoi(value);
-				}
-				else
-				{
-					addToErrorQueue(ERR_INVALID_ARGUMENT);
-				}
+				p.forward();
+				p.model430->inductance = value;
 			}
-			else
-			{
-				if (value == NULL)
-					addToErrorQueue(ERR_MISSING_PARAMETER);
-				else
-					addToErrorQueue(ERR_INVALID_ARGUMENT);
-			}
-		}
+		} },
 
-		// CONFigure:PSwitch
-		else if (isValue(word))
+	// CONFigure:PSwitch 0|1
+	{ COMMAND, Scpi::path(KW_CONF, KW_PS), false, [](Parser &p, const Arguments &args, char *)
 		{
-			char *value = strtok((char*)word, SPACE);	// look for value
+			int value;
 
-			while (isspace(*value))
-				value++;
-
-			if (*value == '0' || *value == '1')
+			if (p.choiceArgument(args.text, "01", ERR_NON_BOOLEAN_ARGUMENT, value))
 			{
-				emit sendBlockingCommand(inputStr + "\r\n");
-				model430->switchInstalled = atoi(value);
+				p.forward();
+				p.model430->switchInstalled = value;
 			}
-			else
-			{
-				addToErrorQueue(ERR_NON_BOOLEAN_ARGUMENT);
-			}
-		}
+		} },
 
-		else
+	// CONFigure:PSwitch:CURRent
+	{ COMMAND, Scpi::path(KW_CONF, KW_PS, KW_CURR), false, [](Parser &p, const Arguments &args, char *)
 		{
-			addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-		}
-	}
-	else
-	{
-		addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-	}
-}
+			double value;
 
-//---------------------------------------------------------------------------
-// tests CONFigure:RAMP:RATE:FIELD,     CONFigure:RAMP:RATE:CURRent,
-//       CONFigure:RAMP:RATE:UNITS,     CONFigure:RAMP:RATE:SEGments <segs>
-//---------------------------------------------------------------------------
-void Parser::parse_configure_R(const char* word, char *outputBuffer)
-{
-	// CONFigure:RAMP command group
-	if (strcmp(word, _RAMP) == 0)
-	{
-		word = strtok(NULL, SEPARATOR);	// get next token
+			if (p.numberArgument(args.text, value))
+			{
+				p.forward();
+				p.model430->switchCurrent = value;
+			}
+		} },
 
-		if (word == NULL)
+	// CONFigure:PSwitch:PowerSupplyRampRate
+	{ COMMAND, Scpi::path(KW_CONF, KW_PS, KW_PSRR), false, [](Parser &p, const Arguments &args, char *)
 		{
-			addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-		}
+			double value;
+
+			if (p.numberArgument(args.text, value))
+			{
+				p.forward();
+				p.model430->cooledSwitchRampRate = value;
+			}
+		} },
 
-		// CONFigure:RAMP:RATE group
-		else if (strcmp(word, _RATE) == 0)
+	// CONFigure:PSwitch:HeatTIME
+	{ COMMAND, Scpi::path(KW_CONF, KW_PS, KW_HTIME), false, [](Parser &p, const Arguments &args, char *)
 		{
-			word = strtok(NULL, SEPARATOR);	// get next token
+			double value;
 
-			if (word == NULL)
+			if (p.numberArgument(args.text, value))
 			{
-				addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
+				p.forward();
+				p.model430->switchHeatedTime = value;
 			}
+		} },
 
-			// CONFigure:RAMP:RATE:FIELD
-			else if (strcmp(word, _FIELD) == 0)
-			{
-				// Read in the segment number
-				char *value = strtok(NULL, COMMA);
+	// CONFigure:PSwitch:CoolTIME
+	{ COMMAND, Scpi::path(KW_CONF, KW_PS, KW_CTIME), false, [](Parser &p, const Arguments &args, char *)
+		{
+			double value;
 
-				if (isValue(value))
-				{
-					double checkValue = strtod(value, NULL);
-					if (checkValue > 0 && checkValue <= 10 && checkValue == (int)checkValue)
-					{
-						// Read in the ramp rate
-						value = strtok(NULL, COMMA);
-
-						if (isValue(value)) // end range
-						{
-							// Grab the upper limit value
-							value = strtok(NULL, COMMA);	// look for upper bound value
-							if (isValue(value))
-							{
-								emit sendBlockingCommand(inputStr + "\r\n");
-								emit configurationChanged(QueryState::RAMP_RATE_FIELD);
-							}
-							else
-							{
-								if (value == NULL)
-									addToErrorQueue(ERR_MISSING_PARAMETER);
-								else
-									addToErrorQueue(ERR_INVALID_ARGUMENT);
-							}
-						}
-						else
-						{
-							if (value == NULL)
-								addToErrorQueue(ERR_MISSING_PARAMETER);
-							else
-								addToErrorQueue(ERR_INVALID_ARGUMENT);
-						}
-					}
-					else
-					{
-						addToErrorQueue(ERR_OUT_OF_RANGE);
-					}
-				}
-				else
-				{
-					if (value == NULL)
-						addToErrorQueue(ERR_MISSING_PARAMETER);
-					else
-						addToErrorQueue(ERR_INVALID_ARGUMENT);
-				}
+			if (p.numberArgument(args.text, value))
+			{
+				p.forward();
+				p.model430->switchCooledTime = value;
 			}
+		} },
 
-			// CONFigure:RAMP:RATE:UNITS
-			else if (strcmp(word, _UNITS) == 0)
-			{
-				char *value = strtok(NULL, SPACE);	// look for value
+	// CONFigure:PSwitch:CoolingGAIN
+	{ COMMAND, Scpi::path(KW_CONF, KW_PS, KW_CGAIN), false, [](Parser &p, const Arguments &args, char *)
+		{
+			double value;
 
-				if (isValue(value))
-				{
-					while (isspace(*value))
-					{
-						value++;
-					}
-
-					if (*value == '1' || *value == '0')
-					{
-						emit sendBlockingCommand(inputStr + "\r\n");
-						model430->rampRateTimeUnits = atoi(value);
-					}
-					else
-					{
-						addToErrorQueue(ERR_INVALID_ARGUMENT);
-					}
-				}
-				else
-				{
-					if (value == NULL)
-						addToErrorQueue(ERR_MISSING_PARAMETER);
-					else
-						addToErrorQueue(ERR_INVALID_ARGUMENT);
-				}
+			if (p.numberArgument(args.text, value))
+			{
+				p.forward();
+				p.model430->switchCoolingGain = value;
 			}
+		} },
 
-			// CONFigure:RAMP:RATE:CURRent
-			else if (strcmp(word, _CURR) == 0 || strcmp(word, _CURRENT) == 0)
-			{
-				// Read in the segment number
-				char *value = strtok(NULL, COMMA);
+	// CONFigure:PSwitch:TRANsition 0|1
+	{ COMMAND, Scpi::path(KW_CONF, KW_PS, KW_TRAN), false, [](Parser &p, const Arguments &args, char *)
+		{
+			int value;
 
-				if (isValue(value))
-				{
-					double checkValue = strtod(value, NULL);
-					if (checkValue > 0 && checkValue <= 10 && checkValue == (int)checkValue)
-					{
-						// Read in the ramp rate
-						value = strtok(NULL, COMMA);
-
-						if (isValue(value)) // end range
-						{
-							value = strtok(NULL, COMMA);	// look for upper bound value
-							if (isValue(value))
-							{
-								emit sendBlockingCommand(inputStr + "\r\n");
-								emit configurationChanged(QueryState::RAMP_RATE_CURRENT);
-							}
-							else
-							{
-								if (value == NULL)
-									addToErrorQueue(ERR_MISSING_PARAMETER);
-								else
-									addToErrorQueue(ERR_INVALID_ARGUMENT);
-							}
-						}
-						else
-						{
-							if (value == NULL)
-								addToErrorQueue(ERR_MISSING_PARAMETER);
-							else
-								addToErrorQueue(ERR_INVALID_ARGUMENT);
-						}
-					}
-					else
-					{
-						addToErrorQueue(ERR_OUT_OF_RANGE);
-					}
-				}
-				else
-				{
-					if (value == NULL)
-						addToErrorQueue(ERR_MISSING_PARAMETER);
-					else
-						addToErrorQueue(ERR_INVALID_ARGUMENT);
-				}
+			if (p.choiceArgument(args.text, "01", ERR_INVALID_ARGUMENT, value))
+			{
+				p.forward();
+				p.model430->switchTransition = value;
 			}
+		} },
 
-			// CONFigure:RAMP:RATE:SEGments
-			else if (strcmp(word, _SEG) == 0 || strcmp(word, _SEGMENTS) == 0)
+	// CONFigure:RAMP:RATE:CURRent <segment>,<rate>,<upper bound>
+	{ COMMAND, Scpi::path(KW_CONF, KW_RAMP, KW_RATE, KW_CURR), false, [](Parser &p, const Arguments &args, char *)
+		{
+			if (p.rampSegmentArguments(args.text))
 			{
-				char *value = strtok(NULL, SPACE);	// look for value
-
-				if (isValue(value))
-				{
-					double checkValue = strtod(value, NULL);
-
-					if (checkValue > 0 && checkValue <= 10)
-					{
-						emit sendBlockingCommand(inputStr + "\r\n");
-						model430->rampRateSegments = checkValue;
-					}
-					else
-					{
-						addToErrorQueue(ERR_OUT_OF_RANGE);
-					}
-				}
-				else
-				{
-					if (value == NULL)
-						addToErrorQueue(ERR_MISSING_PARAMETER);
-					else
-						addToErrorQueue(ERR_INVALID_ARGUMENT);
-				}
+				p.forward();
+				emit p.configurationChanged(QueryState::RAMP_RATE_CURRENT);
 			}
+		} },
 
-			else
+	// CONFigure:RAMP:RATE:FIELD <segment>,<rate>,<upper bound>
+	{ COMMAND, Scpi::path(KW_CONF, KW_RAMP, KW_RATE, KW_FIELD), false, [](Parser &p, const Arguments &args, char *)
+		{
+			if (p.rampSegmentArguments(args.text))
 			{
-				addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
+				p.forward();
+				emit p.configurationChanged(QueryState::RAMP_RATE_FIELD);
 			}
-		}
-		else
-		{
-			addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-		}
-	}
-	else
-	{
-		addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-	}
-}
+		} },
 
-//---------------------------------------------------------------------------
-// tests CONFigure:STABility, CONFigure:STABility:MODE,
-//		 CONFigure:STABility:RESistor
-//---------------------------------------------------------------------------
-void Parser::parse_configure_S(const char* word, char *outputBuffer)
-{
-	if (strcmp(word, _STAB) == 0 || strcmp(word, _STABILITY) == 0)
-	{
-		word = strtok(NULL, SEPARATOR); // get next token
-
-		if (word == NULL)
+	// CONFigure:RAMP:RATE:UNITS 0|1
+	{ COMMAND, Scpi::path(KW_CONF, KW_RAMP, KW_RATE, KW_UNITS), false, [](Parser &p, const Arguments &args, char *)
 		{
-			// no argument for CONFigure:STABility
-			addToErrorQueue(ERR_MISSING_PARAMETER);	// no match, error
-		}
+			int value;
+
+			if (p.choiceArgument(args.text, "01", ERR_INVALID_ARGUMENT, value))
+			{
+				p.forward();
+				p.model430->rampRateTimeUnits = value;
+			}
+		} },
 
-		// CONFigure:STABility:MODE
-		else if (strcmp(word, _MODE) == 0)
+	// CONFigure:RAMP:RATE:SEGments
+	{ COMMAND, Scpi::path(KW_CONF, KW_RAMP, KW_RATE, KW_SEG), false, [](Parser &p, const Arguments &args, char *)
 		{
-			char *value = strtok(NULL, SPACE);		// look for value
+			double value;
 
-			if (isValue(value))
+			if (p.numberArgument(args.text, value))
 			{
-				while (isspace(*value))
-					value++;
-
-				if (*value == '0' || *value == '1' || *value == '2')
+				if (value > 0 && value <= 10)
 				{
-					emit sendBlockingCommand(inputStr + "\r\n");
-					model430->stabilityMode = atoi(value);
+					p.forward();
+					p.model430->rampRateSegments = value;
 				}
 				else
 				{
-					addToErrorQueue(ERR_INVALID_ARGUMENT);
+					p.addToErrorQueue(ERR_OUT_OF_RANGE);
 				}
 			}
-			else
-			{
-				if (value == NULL)
-					addToErrorQueue(ERR_MISSING_PARAMETER);
-				else
-					addToErrorQueue(ERR_INVALID_ARGUMENT);
-			}
-		}
+		} },
 
-		// CONFigure:STABility:RESistor
-		else if (strcmp(word, _RES) == 0 || strcmp(word, _RESISTOR) == 0)
+	// CONFigure:STABility
+	{ COMMAND, Scpi::path(KW_CONF, KW_STAB), false, [](Parser &p, const Arguments &args, char *)
 		{
-			char *value = strtok(NULL, SPACE);		// look for value
+			double value;
 
-			if (isValue(value))
+			if (p.numberArgument(args.text, value))
 			{
-				while (isspace(*value))
-					value++;
-
-				if (*value == '0' || *value == '1')
-				{
-					emit sendBlockingCommand(inputStr + "\r\n");
-					model430->stabilityResistor = atoi(value);
-				}
-				else
-				{
-					addToErrorQueue(ERR_NON_BOOLEAN_ARGUMENT);
-				}
+				p.forward();
+				p.model430->stabilitySetting = value;
 			}
-			else
+		} },
+
+	// CONFigure:STABility:MODE 0|1|2
+	{ COMMAND, Scpi::path(KW_CONF, KW_STAB, KW_MODE), false, [](Parser &p, const Arguments &args, char *)
+		{
+			int value;
+
+			if (p.choiceArgument(args.text, "012", ERR_INVALID_ARGUMENT, value))
 			{
-				if (value == NULL)
-					addToErrorQueue(ERR_MISSING_PARAMETER);
-				else
-					addToErrorQueue(ERR_INVALID_ARGUMENT);
+				p.forward();
+				p.model430->stabilityMode = value;
 			}
-		}
+		} },
 
-		// CONFigure:STABility
-		else if (isValue(word))
+	// CONFigure:STABility:RESistor 0|1
+	{ COMMAND, Scpi::path(KW_CONF, KW_STAB, KW_RES), false, [](Parser &p, const Arguments &args, char *)
 		{
-			char *value = strtok((char*)word, SPACE);	// look for value
-
-			while (isspace(*value))
-				value++;
+			int value;
 
-			double temp = strtod(value, NULL);
-			emit sendBlockingCommand(inputStr + "\r\n");
-			model430->stabilitySetting = temp;
-		}
+			if (p.choiceArgument(args.text, "01", ERR_NON_BOOLEAN_ARGUMENT, value))
+			{
+				p.forward();
+				p.model430->stabilityResistor = value;
+			}
+		} },
 
-		else
+	// CONFigure:VOLTage:LIMit
+	{ COMMAND, Scpi::path(KW_CONF, KW_VOLT, KW_LIM), false, [](Parser &p, const Arguments &args, char *)
 		{
-			addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-		}
-	}
-	else
-	{
-		addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-	}
-}
+			double value;
+
+			if (p.numberArgument(args.text, value))
+			{
+				p.forward();
+				p.model430->voltageLimit = value;
+			}
+		} },
+};
 
 //---------------------------------------------------------------------------
-// tests CONFigure:VOLTage:LIMit
-//---------------------------------------------------------------------------
-void Parser::parse_configure_V(const char* word, char *outputBuffer)
+// Dispatch index over commands[], built on first use
+const QHash<quint64, const Parser::Command *> &Parser::commandIndex(void)
 {
-	if (strcmp(word, _VOLT) == 0 || strcmp(word, _VOLTAGE) == 0)
+	static const QHash<quint64, const Command *> index = []()
 	{
-		word = strtok(NULL, SEPARATOR);		// get next token
+		QHash<quint64, const Command *> table;
 
-		if (word == NULL)
+		for (const Command &command : commands)
 		{
-			addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
+			Q_ASSERT(!table.contains(commandKey(command.query, command.path)));
+			table.insert(commandKey(command.query, command.path), &command);
 		}
-		else if (strcmp(word, _LIM) == 0 || strcmp(word, _LIMIT) == 0)
-		{
-			word = strtok(NULL, SEPARATOR);	// get next token
 
-			if (isValue(word))
-			{
-				double temp = strtod(word, NULL);
-				emit sendBlockingCommand(inputStr + "\r\n");
-				model430->voltageLimit = temp;
-			}
-			else
-			{
-				if (word == NULL)
-					addToErrorQueue(ERR_MISSING_PARAMETER);
-				else
-					addToErrorQueue(ERR_INVALID_ARGUMENT);
-			}
-		}
-		else
-		{
-			addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-		}
-	}
-	else
-	{
-		addToErrorQueue(ERR_UNRECOGNIZED_COMMAND);	// no match, error
-	}
-}
+		return table;
+	}();
 
-//---------------------------------------------------------------------------
+	return index;
+}
@@ -2,8 +2,14 @@
 #define PARSER_H
 
 #include <QObject>
+#include <QIODevice>
 #include <QStack>
+#include <QHash>
+#include <string_view>
 #include "model430.h"
+#include "scpi.h"
+
+struct Sample;
 
 //---------------------------------------------------------------------------
 // Type declarations
@@ -24,6 +30,21 @@ typedef enum
 
 } SystemError;
 
+// SUBScribe channel selection (bit flags), in output order
+enum SubscribeChannel
+{
+	SUB_FIELD = 0x01,
+	SUB_CURRENT = 0x02,
+	SUB_SUPPLY_CURRENT = 0x04,
+	SUB_VOLTAGE = 0x08,
+	SUB_SUPPLY_VOLTAGE = 0x10,
+	SUB_REF_CURRENT = 0x20,
+	SUB_STATE = 0x40,
+	SUB_HEATER = 0x80,
+
+	SUB_ALL = 0xFF
+};
+
 
 //---------------------------------------------------------------------------
 // Parser class
@@ -37,8 +58,12 @@ public:
 	~Parser();
 	void _setParent(QObject *p) { _parent = p; }
 	void setDataSource(Model430 *src) { model430 = src; }
+	void setOutput(QIODevice *device) { output = device; }	// replies go to stdout if not set
+	void parse(const char *line);	// one line, when not reading stdin
+	bool isSubscribed(void) const { return subscribeDivider.load() > 0; }
 	void stop(void);
 	void addSystemError(QString errMsg);
+	void publishSample(const Sample &sample);	// from the GUI thread
 
 public slots:
 	void process(void);
@@ -49,33 +74,54 @@ signals:
 	void sendBlockingCommand(QString aStr);
 	void configurationChanged(QueryState aState);
 	void exit_app(void);
+	void subscriptionChanged(bool active);
 
 private:
 	// add your variables here
 	std::atomic<bool> stopParsing;
 	Model430 *model430;
 	QObject *_parent;
+	QIODevice *output;
 	QString inputStr;
 	QStack<QString> errorStack;
 
+	// SUBScribe state, set here and read by publishSample()
+	std::atomic<int> subscribeDivider;	// every nth sample, 0 if not subscribed
+	std::atomic<int> subscribeChannels;	// SubscribeChannel flags
+	int subscribeCount;					// samples since the last one written
+
+	// a parsed line, views into the input
+	struct Arguments
+	{
+		std::string_view parameter;	// number in the header, e.g. a ramp segment
+		std::string_view text;		// after the header
+	};
+
+	typedef void (*Handler)(Parser &parser, const Arguments &args, char *outputBuffer);
+
+	// a command or query, dispatched on its header keywords
+	struct Command
+	{
+		bool query;
+		quint32 path;		// Scpi::path() of the header keywords
+		bool parameter;		// header ends in a number
+		Handler handler;
+	};
+
+	static const Command commands[];
+	static const QHash<quint64, const Command *> &commandIndex(void);
+
 	void addToErrorQueue(SystemError error);
-	void parseInput(char *commbuf, char* outputBuffer);
-	void parse_query_C(char* word, char* outputBuffer);
-	void parse_query_F(char* word, char* outputBuffer);
-	void parse_query_I(char* word, char* outputBuffer);
-	void parse_query_P(char* word, char* outputBuffer);
-	void parse_query_Q(char* word, char* outputBuffer);
-	void parse_query_R(char* word, char* outputBuffer);
-	void parse_query_S(char* word, char* outputBuffer);
-	void parse_query_V(char* word, char* outputBuffer);
-	void parse_configure(const char* word, char *outputBuffer);
-	void parse_configure_C(const char* word, char *outputBuffer);
-	void parse_configure_F(const char* word, char *outputBuffer);
-	void parse_configure_I(const char* word, char *outputBuffer);
-	void parse_configure_P(const char* word, char *outputBuffer);
-	void parse_configure_R(const char* word, char *outputBuffer);
-	void parse_configure_S(const char* word, char *outputBuffer);
-	void parse_configure_V(const char* word, char *outputBuffer);
+	void formatLiveState(char *outputBuffer);
+	void subscribe(std::string_view text);
+	void parseInput(std::string_view line, char *outputBuffer);
+	void reply(char *outputBuffer, const char *format, ...);
+	void write(const char *data, qint64 length);
+	void forward(void);
+	bool numberArgument(std::string_view text, double &value);
+	int segmentArgument(std::string_view text);
+	bool choiceArgument(std::string_view text, const char *choices, SystemError invalid, int &value);
+	bool rampSegmentArguments(std::string_view text);
 };
 
 #endif // PARSER_H
\ No newline at end of file
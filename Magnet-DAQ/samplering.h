@@ -0,0 +1,76 @@
+#ifndef SAMPLERING_H
+#define SAMPLERING_H
+
+#include <atomic>
+#include <cstddef>
+
+//---------------------------------------------------------------------------
+// Single-producer/single-consumer lock-free ring buffer. Exactly one thread
+// may push() and exactly one other thread may pop(); neither side ever
+// blocks. N must be a power of two and one slot is always left empty, so
+// the ring holds at most N - 1 items. When full, push() fails and the
+// producer decides what to do with the item (usually count it as dropped).
+//---------------------------------------------------------------------------
+template <typename T, size_t N>
+class SampleRing
+{
+	static_assert(N >= 2 && (N & (N - 1)) == 0, "SampleRing size must be a power of two");
+
+public:
+	SampleRing() : head(0), tail(0) {}
+
+	// producer only
+	bool push(const T &item)
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+		size_t next = (h + 1) & (N - 1);
+
+		if (next == tail.load(std::memory_order_acquire))
+			return false;	// full
+
+		buffer[h] = item;
+		head.store(next, std::memory_order_release);
+
+		return true;
+	}
+
+	// consumer only
+	bool pop(T &item)
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+
+		if (t == head.load(std::memory_order_acquire))
+			return false;	// empty
+
+		item = buffer[t];
+		tail.store((t + 1) & (N - 1), std::memory_order_release);
+
+		return true;
+	}
+
+	// consumer only, discards everything presently in the ring
+	void clear(void)
+	{
+		tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+	}
+
+	bool isEmpty(void) const
+	{
+		return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+	}
+
+	size_t count(void) const
+	{
+		return (head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire)) & (N - 1);
+	}
+
+	static constexpr size_t capacity(void) { return N - 1; }
+
+private:
+	// producer and consumer indexes on separate cache lines
+	alignas(64) std::atomic<size_t> head;	// next slot to write
+	alignas(64) std::atomic<size_t> tail;	// next slot to read
+	T buffer[N];
+};
+
+#endif // SAMPLERING_H
@@ -0,0 +1,275 @@
+#ifndef SCPI_H
+#define SCPI_H
+
+#include <QtGlobal>
+#include <string_view>
+
+//---------------------------------------------------------------------------
+// SCPI keywords understood by the stdin parser. Each is accepted in its
+// short and long form, in any case.
+//---------------------------------------------------------------------------
+enum Keyword
+{
+	KW_NONE = 0,
+	KW_CLS,
+	KW_IDN,
+	KW_EXIT,
+	KW_SYST,
+	KW_ERR,
+	KW_COUN,
+	KW_COMM,
+	KW_CONF,
+	KW_IND,
+	KW_PAUSE,
+	KW_PS,
+	KW_RAMP,
+	KW_ZERO,
+	KW_CURR,
+	KW_VOLT,
+	KW_LIM,
+	KW_SUPP,
+	KW_MAG,
+	KW_TARG,
+	KW_COIL,
+	KW_FIELD,
+	KW_UNITS,
+	KW_STAB,
+	KW_RES,
+	KW_MODE,
+	KW_RATE,
+	KW_SEG,
+	KW_STATE,
+	KW_QU,
+	KW_PSRR,
+	KW_HTIME,
+	KW_CTIME,
+	KW_CGAIN,
+	KW_TRAN,
+	KW_INST,
+	KW_PERS,
+	KW_REF,
+	KW_SAMP,
+	KW_SUBS,
+	KW_UNSUBS,
+
+	KEYWORDS
+};
+
+namespace Scpi
+{
+	struct Spelling
+	{
+		const char *text;	// uppercase
+		Keyword keyword;
+	};
+
+	constexpr Spelling spellings[] =
+	{
+		{ "*CLS", KW_CLS },
+		{ "*IDN", KW_IDN },
+		{ "EXIT", KW_EXIT },
+		{ "SYST", KW_SYST },			{ "SYSTEM", KW_SYST },
+		{ "ERR", KW_ERR },				{ "ERROR", KW_ERR },
+		{ "COUN", KW_COUN },			{ "COUNT", KW_COUN },
+		{ "COMM", KW_COMM },			{ "COMMUNICATION", KW_COMM },
+		{ "CONF", KW_CONF },			{ "CONFIGURE", KW_CONF },
+		{ "IND", KW_IND },				{ "INDUCTANCE", KW_IND },
+		{ "PAUSE", KW_PAUSE },
+		{ "PS", KW_PS },				{ "PSWITCH", KW_PS },
+		{ "RAMP", KW_RAMP },
+		{ "ZERO", KW_ZERO },
+		{ "CURR", KW_CURR },			{ "CURRENT", KW_CURR },
+		{ "VOLT", KW_VOLT },			{ "VOLTAGE", KW_VOLT },
+		{ "LIM", KW_LIM },				{ "LIMIT", KW_LIM },
+		{ "SUPP", KW_SUPP },			{ "SUPPLY", KW_SUPP },
+		{ "MAG", KW_MAG },				{ "MAGNET", KW_MAG },
+		{ "TARG", KW_TARG },			{ "TARGET", KW_TARG },
+		{ "COIL", KW_COIL },			{ "COILCONST", KW_COIL },
+		{ "FIELD", KW_FIELD },
+		{ "UNITS", KW_UNITS },
+		{ "STAB", KW_STAB },			{ "STABILITY", KW_STAB },
+		{ "RES", KW_RES },				{ "RESISTOR", KW_RES },
+		{ "MODE", KW_MODE },
+		{ "RATE", KW_RATE },
+		{ "SEG", KW_SEG },				{ "SEGMENTS", KW_SEG },
+		{ "STATE", KW_STATE },
+		{ "QU", KW_QU },				{ "QUENCH", KW_QU },
+		{ "PSRR", KW_PSRR },			{ "POWERSUPPLYRAMPRATE", KW_PSRR },
+		{ "HTIME", KW_HTIME },			{ "HEATTIME", KW_HTIME },
+		{ "CTIME", KW_CTIME },			{ "COOLTIME", KW_CTIME },
+		{ "CGAIN", KW_CGAIN },			{ "COOLINGGAIN", KW_CGAIN },
+		{ "TRAN", KW_TRAN },			{ "TRANSITION", KW_TRAN },
+		{ "INST", KW_INST },			{ "INSTALLED", KW_INST },
+		{ "PERS", KW_PERS },			{ "PERSISTENT", KW_PERS },
+		{ "REF", KW_REF },				{ "REFERENCE", KW_REF },
+		{ "SAMP", KW_SAMP },			{ "SAMPLE", KW_SAMP },
+		{ "SUBS", KW_SUBS },			{ "SUBSCRIBE", KW_SUBS },
+		{ "UNSUBS", KW_UNSUBS },		{ "UNSUBSCRIBE", KW_UNSUBS },
+	};
+
+	constexpr int SPELLINGS = sizeof(spellings) / sizeof(spellings[0]);
+	constexpr int TABLE_SIZE = 256;				// power of 2, > SPELLINGS
+	constexpr quint32 START_SEED = 0x811CD51F;	// first perfect seed for the list above
+
+	constexpr char upper(char c)
+	{
+		return (c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A') : c;
+	}
+
+	// FNV-1a over the uppercased word, folded to a table slot
+	constexpr int slot(std::string_view word, quint32 seed)
+	{
+		quint32 hash = seed;
+
+		for (char c : word)
+		{
+			hash ^= (quint8)upper(c);
+			hash *= 16777619u;
+		}
+
+		return (int)((hash ^ (hash >> 15)) & (TABLE_SIZE - 1));
+	}
+
+	constexpr bool isPerfect(quint32 seed)
+	{
+		bool used[TABLE_SIZE] = {};
+
+		for (int i = 0; i < SPELLINGS; i++)
+		{
+			int s = slot(spellings[i].text, seed);
+
+			if (used[s])
+				return false;
+
+			used[s] = true;
+		}
+
+		return true;
+	}
+
+	// searches on from START_SEED if the keyword list has changed
+	constexpr quint32 findSeed(quint32 seed)
+	{
+		while (!isPerfect(seed))
+			seed++;
+
+		return seed;
+	}
+
+	constexpr quint32 SEED = findSeed(START_SEED);
+
+	struct Table
+	{
+		quint8 index[TABLE_SIZE];	// spelling + 1, 0 if empty
+	};
+
+	constexpr Table buildTable(void)
+	{
+		Table table = {};
+
+		for (int i = 0; i < SPELLINGS; i++)
+			table.index[slot(spellings[i].text, SEED)] = (quint8)(i + 1);
+
+		return table;
+	}
+
+	constexpr Table table = buildTable();
+
+	// one hash and at most one compare per word
+	constexpr Keyword lookup(std::string_view word)
+	{
+		int index = table.index[slot(word, SEED)];
+
+		if (index == 0)
+			return KW_NONE;
+
+		std::string_view text(spellings[index - 1].text);
+
+		if (text.size() != word.size())
+			return KW_NONE;
+
+		for (size_t i = 0; i < word.size(); i++)
+		{
+			if (upper(word[i]) != text[i])
+				return KW_NONE;
+		}
+
+		return spellings[index - 1].keyword;
+	}
+
+	static_assert(lookup("curr") == KW_CURR && lookup("POWERSUPPLYRAMPRATE") == KW_PSRR && lookup("CURRE") == KW_NONE, "SCPI keyword table");
+
+	// up to 4 header keywords packed into one dispatch key
+	constexpr quint32 path(Keyword a, Keyword b = KW_NONE, Keyword c = KW_NONE, Keyword d = KW_NONE)
+	{
+		return (quint32)a << 24 | (quint32)b << 16 | (quint32)c << 8 | (quint32)d;
+	}
+
+	constexpr std::string_view trim(std::string_view text)
+	{
+		while (!text.empty() && (text.front() == ' ' || text.front() == '\t' || text.front() == '\r' || text.front() == '\n'))
+			text.remove_prefix(1);
+
+		while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r' || text.back() == '\n'))
+			text.remove_suffix(1);
+
+		return text;
+	}
+}
+
+//---------------------------------------------------------------------------
+// Splits text into tokens like strtok(), but reentrant and without copying
+// or modifying the text: each token is a view into it.
+//---------------------------------------------------------------------------
+class ScpiCursor
+{
+public:
+	explicit ScpiCursor(std::string_view text) : rest(text), finished(false) {}
+
+	// next token, skipping leading delimiters, empty at the end
+	std::string_view next(std::string_view delimiters)
+	{
+		size_t start = rest.find_first_not_of(delimiters);
+
+		if (start == std::string_view::npos)
+			return finish();
+
+		size_t end = rest.find_first_of(delimiters, start);
+
+		if (end == std::string_view::npos)
+			return finish(rest.substr(start));
+
+		std::string_view token = rest.substr(start, end - start);
+		rest.remove_prefix(end + 1);
+		return token;
+	}
+
+	// next field up to a single delimiter, trimmed, empty fields included
+	std::string_view field(char delimiter)
+	{
+		size_t end = rest.find(delimiter);
+
+		if (end == std::string_view::npos)
+			return Scpi::trim(finish(rest));
+
+		std::string_view token = rest.substr(0, end);
+		rest.remove_prefix(end + 1);
+		return Scpi::trim(token);
+	}
+
+	bool atEnd(void) const { return finished; }
+	std::string_view remainder(void) const { return Scpi::trim(rest); }
+
+private:
+	std::string_view finish(std::string_view token = std::string_view())
+	{
+		rest = std::string_view();
+		finished = true;
+		return token;
+	}
+
+	std::string_view rest;
+	bool finished;
+};
+
+#endif // SCPI_H
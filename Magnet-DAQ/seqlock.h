@@ -0,0 +1,128 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <QtGlobal>
+#include <QThread>
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+//---------------------------------------------------------------------------
+// Publishes a small trivially-copyable value to any number of reader
+// threads. Readers never block a writer and never see a torn value: they
+// copy the value and retry if a write overlapped the copy, which at our
+// publication rates (tens per second) practically never happens. Writers
+// may be on different threads, they take turns on the odd sequence count.
+// The value is stored as relaxed atomic words so the copy is race-free.
+//---------------------------------------------------------------------------
+template <typename T>
+class SeqLock
+{
+	static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable type");
+
+public:
+	SeqLock() : sequence(0)
+	{
+		for (int i = 0; i < WORDS; i++)
+			words[i].store(0, std::memory_order_relaxed);
+	}
+
+	// consistent copy of the latest value
+	T load(void) const
+	{
+		quint64 buffer[WORDS];
+
+		for (;;)
+		{
+			quint32 before = sequence.load(std::memory_order_acquire);
+
+			if (before & 1)
+			{
+				QThread::yieldCurrentThread();	// write in progress
+				continue;
+			}
+
+			for (int i = 0; i < WORDS; i++)
+				buffer[i] = words[i].load(std::memory_order_relaxed);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+
+			if (sequence.load(std::memory_order_relaxed) == before)
+				break;
+		}
+
+		T value;
+		memcpy(&value, buffer, sizeof(T));
+		return value;
+	}
+
+	// publishes a new value
+	void store(const T &value)
+	{
+		lock();
+		write(value);
+		unlock();
+	}
+
+	// changes part of the value, the change is published as one
+	template <typename F>
+	void update(F change)
+	{
+		lock();
+
+		quint64 buffer[WORDS];
+
+		for (int i = 0; i < WORDS; i++)
+			buffer[i] = words[i].load(std::memory_order_relaxed);
+
+		T value;
+		memcpy(&value, buffer, sizeof(T));
+		change(value);
+		write(value);
+		unlock();
+	}
+
+private:
+	static const int WORDS = (sizeof(T) + sizeof(quint64) - 1) / sizeof(quint64);
+
+	void lock(void)
+	{
+		quint32 count = sequence.load(std::memory_order_relaxed);
+
+		for (;;)
+		{
+			if (count & 1)
+			{
+				QThread::yieldCurrentThread();	// another writer
+				count = sequence.load(std::memory_order_relaxed);
+			}
+			else if (sequence.compare_exchange_weak(count, count + 1, std::memory_order_acquire, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+
+		// keep the value stores after the odd count for readers
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	void unlock(void)
+	{
+		sequence.fetch_add(1, std::memory_order_release);
+	}
+
+	void write(const T &value)
+	{
+		quint64 buffer[WORDS] = {};
+
+		memcpy(buffer, &value, sizeof(T));
+
+		for (int i = 0; i < WORDS; i++)
+			words[i].store(buffer[i], std::memory_order_relaxed);
+	}
+
+	std::atomic<quint32> sequence;	// odd while a write is in progress
+	std::atomic<quint64> words[WORDS];
+};
+
+#endif // SEQLOCK_H
@@ -2,16 +2,36 @@
 #include "socket.h"
 #include "QDateTime"
 #include <magnetdaq.h>
+#include "numberconv.h"
 
 #undef DEBUG
 //#define DEBUG
 
-#if defined(Q_OS_LINUX) || defined(Q_OS_MACOS)
-#include <unistd.h>
-#endif
-
-// timeout constant
+// timeout constants
 const int TIMEOUT = 1000;
+const int SAMPLE_TIMEOUT = 500;
+
+// acquisition scheduling
+const double LATENCY_HEADROOM = 1.25;		// sample period vs. smoothed reply latency
+const double LATENCY_SMOOTHING = 0.125;		// weight of each new latency measurement
+const qint64 STATS_WINDOW = 1000000000;		// ns between achieved rate reports
+const qint64 MIN_BOOST_PERIOD = 5000000;	// ns, rate boost never triggers faster than 200 Hz
+
+// maximum number of queries on the wire awaiting replies
+const int MAX_QUERIES_IN_FLIGHT = 4;
+const int MAX_BURST_QUERIES = 80;	// for a batch, enough for a full configuration sync
+
+// unanswered query bytes on the wire, kept well below the 430's input
+// buffer so a burst can't overflow it; refilled as replies arrive
+const int MAX_INFLIGHT_BYTES = 256;
+
+// after a reply timeout, how long to wait for the resync marker's reply
+const int RESYNC_TIMEOUT = 2000;	// ms
+
+// number of values returned by the trigger queries
+const int TRG_SAMPLE_FIELDS = 5;		// *TRG with *ETE 151
+const int AMI_TRG_MIN_FIELDS = 7;		// *AMITRG, heater state only if switch installed
+const int MAX_SAMPLE_FIELDS = 8;
 
 // save parent
 static magnetdaq* magnetdaqParent;
@@ -22,26 +42,52 @@ Socket::Socket(QObject *parent)
 	: QObject(parent)
 {
 	model430 = NULL;
-	socket = NULL;
-	unitConnected = false;
-	queryState.store(QueryState::WELCOME_STRING);
-	commandTimer.setInterval(0);
-	refCurrent = 0.0;
-	state = 0;
-	heater = 0;
-	connect(&commandTimer, SIGNAL(timeout()), this, SLOT(commandTimerTimeout()));
+	initialize();
 }
 
 //---------------------------------------------------------------------------
 Socket::Socket(Model430 *settings, QObject *parent)
 {
+	// no QObject parent so that this object can be moved to the I/O thread
 	model430 = settings;
 	magnetdaqParent = dynamic_cast<magnetdaq *>(parent);
+	initialize();
+}
+
+//---------------------------------------------------------------------------
+void Socket::initialize(void)
+{
 	socket = NULL;
 	unitConnected = false;
+	triggerInFlight = false;
+	batchDepth = 0;
+	burstRemaining = 0;
+	resyncing = false;
+	outstandingQueries = std::make_shared<std::atomic<int>>(0);
+	droppedSamples = 0;
+	streamSamples = false;
 	queryState.store(QueryState::WELCOME_STRING);
+	memset(&lastSample, 0, sizeof(lastSample));
+
+	// timers are children so they follow this object to the I/O thread
+	commandTimer.setParent(this);
+	replyTimer.setParent(this);
+	sampleTimer.setParent(this);
 	commandTimer.setInterval(0);
+	replyTimer.setInterval(50);
+	sampleTimer.setSingleShot(true);
+	sampleTimer.setTimerType(Qt::PreciseTimer);
+	minSamplePeriod = 100000000;
+	rateBoost = false;
+	nextDeadline = 0;
+	triggerWriteTime = 0;
+	epochOffset = 0;
+	latencyAvg = 0.0;
+	missedDeadlines = 0;
+
 	connect(&commandTimer, SIGNAL(timeout()), this, SLOT(commandTimerTimeout()));
+	connect(&replyTimer, SIGNAL(timeout()), this, SLOT(replyTimerTimeout()));
+	connect(&sampleTimer, SIGNAL(timeout()), this, SLOT(getNextDataPoint()));
 }
 
 //---------------------------------------------------------------------------
@@ -59,6 +105,13 @@ Socket::~Socket()
 //---------------------------------------------------------------------------
 void Socket::connectToModel430(QString ipaddress, quint16 port, QNetworkProxy::ProxyType aProxyType)
 {
+	if (!isIoThread())
+	{
+		// the TCP socket must be created on the I/O thread, caller waits for the result
+		QMetaObject::invokeMethod(this, [=]() { connectToModel430(ipaddress, port, aProxyType); }, Qt::BlockingQueuedConnection);
+		return;
+	}
+
 	socket = new QTcpSocket(this);
 	socket->setProxy(aProxyType);
 
@@ -92,6 +145,10 @@ void Socket::disconnected()
 {
 	unitConnected = false;
 	qDebug() << "Disconnected from Model 430 @" + ipAddress + ":" + QString::number(ipPort);
+
+	// fail anything still waiting on a reply
+	abortQueries();
+
 	emit model430Disconnected();
 }
 
@@ -106,11 +163,11 @@ void Socket::bytesWritten(qint64 bytes)
 //---------------------------------------------------------------------------
 void Socket::readyRead()
 {
-	QString reply = QString::fromLatin1(socket->readAll());
+	QByteArray data = socket->readAll();
 
 	if (queryState.load() == QueryState::WELCOME_STRING)
 	{
-		qDebug() << "WELCOME_STRING: " << reply;
+		qDebug() << "WELCOME_STRING: " << QString::fromLatin1(data);
 
 		if (ipPort == 23 || ipPort > 7189 /* > 7189 for simulation use only */)
 			queryState.store(QueryState::MSG_UPDATE);	// receive broadcast MSG's on telnet port only, no commands or queries!
@@ -118,7 +175,273 @@ void Socket::readyRead()
 			queryState.store(QueryState::IDLE_STATE);	// commands and queries to port 7180
 	}
 
-	else if (queryState.load() == QueryState::FIRMWARE_VERSION)
+	else if (queryState.load() == QueryState::MSG_UPDATE)	// port 23 only
+	{
+		framer.append(data);
+
+		// one broadcast message per line, possibly several per read
+		int length;
+
+		while ((length = framer.nextRecord(false)) > 0)
+		{
+			processReply(QueryState::MSG_UPDATE, 0, QString::fromLatin1(framer.record(), length));
+			framer.consume(length);
+		}
+	}
+
+	else
+	{
+		framer.append(data);
+
+		// after a timeout, everything ahead of the marker's reply is stale
+		while (resyncing)
+		{
+			int length = framer.nextRecord(false);
+
+			if (length == 0)
+				return;
+
+			if (QByteArray::fromRawData(framer.record(), length) == idnReply)
+				resyncing = false;
+			else
+				stats.recordUnsolicitedReply();
+
+			framer.consume(length);
+		}
+
+		// replies arrive in the order the queries were written,
+		// so match each complete reply to the oldest in-flight query
+		while (!inflightQueue.isEmpty())
+		{
+			QueryState aState = inflightQueue.head().state;
+
+			// file replies end with contiguous <CR><LF> pairs
+			bool multiLine = (aState == QueryState::RAMPDOWN_FILE || aState == QueryState::QUENCH_FILE || aState == QueryState::SETTINGS);
+			int length = framer.nextRecord(multiLine);
+
+			if (length == 0)
+				break;
+
+			PendingQuery query = inflightQueue.dequeue();
+			bool ok = true;
+
+			// the next reply is due relative to this one, not to its own write,
+			// so a long burst does not time out while earlier replies drain
+			if (!inflightQueue.isEmpty())
+				inflightQueue.head().sent.restart();
+
+			stats.recordQuery(query.state, query.written.nsecsElapsed() / 1000);
+
+			// data samples are decoded straight from the receive buffer
+			if (query.state == QueryState::TRG_SAMPLE || query.state == QueryState::AMI_TRG_SAMPLE)
+				ok = decodeSample(framer.record(), length, query.state);
+			else
+				processReply(query.state, query.segment, QString::fromLatin1(framer.record(), length));
+
+			framer.consume(length);
+			finishQuery(query, ok);
+		}
+
+		// discard any unsolicited data (e.g. a late reply to a timed out query)
+		if (inflightQueue.isEmpty() && !framer.isEmpty())
+		{
+			stats.recordUnsolicitedReply();
+			framer.clear();
+		}
+
+		writePendingQueries();
+	}
+}
+
+//---------------------------------------------------------------------------
+// I/O thread: takes a single complete reply for the query state it answers.
+// Model values are shared with the GUI and the parsers, so they are written
+// on the model's thread by applyReply(), in reply order and ahead of the
+// query's completion callback. Only the sample path (decodeSample()) and
+// the broadcasts below stay on this thread.
+void Socket::processReply(QueryState aState, int segment, QString reply)
+{
+	if (aState == QueryState::MSG_UPDATE)	// port 23 only
+	{
+		processMessage(reply);
+		return;
+	}
+
+	if (aState == QueryState::FIRMWARE_VERSION)
+		idnReply = reply.toLatin1();	// the resync marker's reply
+
+	Model430 *model = model430;
+
+	QMetaObject::invokeMethod(model430, [model, aState, segment, reply]() { applyReply(model, aState, segment, reply); }, Qt::QueuedConnection);
+
+	if (aState == QueryState::SYSTEM_ERROR)
+		emit systemErrorMessage(reply, nullptr);
+}
+
+//---------------------------------------------------------------------------
+// I/O thread: display/keypad updates and change notifications broadcast by
+// the 430.
+void Socket::processMessage(QString reply)
+{
+	// parse MSG_UPDATE messages with display and keypad info
+	if (reply.contains("MSG_DISP_UPDATE::"))
+	{
+		// split at the :: delimiters
+		QStringList strList = reply.split("::");
+		#ifdef DEBUG
+		qDebug() << "MSG_DISP_UPDATE::" + strList[1] + "::" + strList[2];
+		#endif
+
+		// expect 9 substrings -- if incomplete, ignore
+		if (strList.count() < 9)
+			return;
+
+		QString displayStr = strList[1] + "\n" + strList[2];
+		bool leds[6] = { false, false, false, false, false, false };
+
+		for (int i = 0; i < 6; i++)
+		{
+			if (strList[i + 3] == "1")
+				leds[i] = true;
+		}
+
+		// the state is the model's, so is the quench current parsed from
+		// the display string
+		QMetaObject::invokeMethod(model430, [model = model430, displayStr]()
+		{
+			if (model->state() == State::QUENCH)
+			{
+				// parse quench current from display string
+				QString quenchStr;
+				int start = displayStr.indexOf("Quench Detect @");
+				start += 15;
+				quenchStr = displayStr.mid(start, 12);
+				quenchStr.replace("A", " ");
+
+				bool ok;
+				double temp = quenchStr.toDouble(&ok);
+				if (ok)
+					model->setQuenchCurrent(temp);
+			}
+		}, Qt::QueuedConnection);
+
+		emit updateFrontPanel(displayStr, leds[0], leds[1], leds[2], leds[3], leds[4]);
+	}
+
+	if (reply.contains("MSG_VOLTMETER_UPDATE::"))
+	{
+		// split at the :: delimiters
+		QStringList strList = reply.split("::");
+#ifdef DEBUG
+		qDebug() << "MSG_VOLTMETER_UPDATE::" + strList[1] + "::" + strList[2];
+#endif
+
+		// expect 11 substrings -- if incomplete, ignore
+		if (strList.count() < 11)
+			return;
+
+		QString displayStr = strList[1] + "  (Showing " + strList[9] + " Bar Graph)  " + "\n" + strList[2] + "      " + strList[9] + " = " + strList[10] + "       ";
+		bool leds[6] = { false, false, false, false, false, false };
+
+		for (int i = 0; i < 6; i++)
+		{
+			if (strList[i + 3] == "1")
+				leds[i] = true;
+		}
+
+		emit updateFrontPanel(displayStr, leds[0], leds[1], leds[2], leds[3], leds[4]);
+	}
+
+	if (reply.contains("FIELD_UNITS_CHANGED"))
+	{
+		#ifdef DEBUG
+		qDebug() << "MSG_FIELD_UNITS_CHANGED";
+		#endif
+
+		// field units change notification
+		emit fieldUnitsChanged();
+	}
+
+	if (reply.contains("BEEP"))
+	{
+		#ifdef DEBUG
+		qDebug() << "MSG_BEEP";
+		#endif
+
+		// an error beep occurred, set flag for possible SYST:ERR? status display
+		emit systemError();
+	}
+
+	// the following assist in syncing Magnet-DAQ panels with remote changes by operator
+	if (reply.contains("SYNC:SUPPLY"))
+	{
+		#ifdef DEBUG
+		qDebug() << "MSG_SYNC:SUPPLY";
+		#endif
+		model430->markStale(SUPPLY_SYNC | SETTINGS_SYNC);
+		QMetaObject::invokeMethod(magnetdaqParent, "remoteConfigurationChanged", Qt::QueuedConnection, Q_ARG(int, SUPPLY_PAGE));
+	}
+	else if (reply.contains("SYNC:LOAD"))
+	{
+		#ifdef DEBUG
+		qDebug() << "MSG_SYNC:LOAD";
+		#endif
+		model430->markStale(LOAD_SYNC | SETTINGS_SYNC);
+		QMetaObject::invokeMethod(magnetdaqParent, "remoteConfigurationChanged", Qt::QueuedConnection, Q_ARG(int, LOAD_PAGE));
+	}
+	else if (reply.contains("SYNC:SWITCH"))
+	{
+		#ifdef DEBUG
+		qDebug() << "MSG_SYNC:SWITCH";
+		#endif
+		model430->markStale(SWITCH_SYNC | SETTINGS_SYNC);
+		QMetaObject::invokeMethod(magnetdaqParent, "remoteConfigurationChanged", Qt::QueuedConnection, Q_ARG(int, SWITCH_PAGE));
+	}
+	else if (reply.contains("SYNC:PROT"))
+	{
+		#ifdef DEBUG
+		qDebug() << "MSG_SYNC:PROT";
+		#endif
+		model430->markStale(PROTECTION_SYNC | SETTINGS_SYNC);
+		QMetaObject::invokeMethod(magnetdaqParent, "remoteConfigurationChanged", Qt::QueuedConnection, Q_ARG(int, PROTECTION_PAGE));
+	}
+	else if (reply.contains("SYNC:RAMP"))
+	{
+		#ifdef DEBUG
+		qDebug() << "MSG_SYNC:RAMP";
+		#endif
+		model430->markStale(RAMP_SYNC | RAMPDOWN_SYNC | SETTINGS_SYNC);
+		QMetaObject::invokeMethod(magnetdaqParent, "remoteConfigurationChanged", Qt::QueuedConnection, Q_ARG(int, RAMP_PAGE));
+	}
+
+	if (reply.contains("EXT_RAMPDOWN_START"))
+	{
+		#ifdef DEBUG
+		qDebug() << "MSG_EXT_RAMPDOWN_START";
+		#endif
+
+		// external rampdown start notification
+		emit startExternalRampdown();
+	}
+
+	if (reply.contains("EXT_RAMPDOWN_END"))
+	{
+		#ifdef DEBUG
+		qDebug() << "MSG_EXT_RAMPDOWN_END";
+		#endif
+
+		// external rampdown end notification, a new event was recorded
+		model430->markStale(RAMPDOWN_EVENTS_SYNC);
+		emit endExternalRampdown();
+	}
+}
+
+//---------------------------------------------------------------------------
+// Model thread: decodes a single complete reply into the model values it
+// answers. Static, the socket may be gone by the time this runs.
+void Socket::applyReply(Model430 *model430, QueryState aState, int segment, QString reply)
+{
+	if (aState == QueryState::FIRMWARE_VERSION)
 	{
 		qDebug() << "*IDN? Reply: " << reply;
 
@@ -155,81 +478,24 @@ void Socket::readyRead()
 			model430->setFirmwareVersion(temp);
 			model430->setFirmwareSuffix(suffix);
 		}
-
-		queryState.store(QueryState::IDLE_STATE);
-	}
-
-	else if (queryState.load() == QueryState::TRG_SAMPLE || queryState.load() == QueryState::AMI_TRG_SAMPLE)
-	{
-		// this assumes *ETE 151 or *AMITRIG command
-		#ifdef DEBUG
-		if (queryState.load() == AMI_TRG_SAMPLE)
-			qDebug() << "*AMITRG Reply: " << reply;
-		else
-			qDebug() << "*TRG Reply: " << reply;
-		#endif
-
-		// read return data
-		// split at the , delimiters
-		QStringList strList = reply.split(",");
-
-		for (int i = 0; i < strList.size(); i++)
-		{
-			bool ok;
-			double temp = strList.at(i).toDouble(&ok);
-
-			if (ok)	// if successfully converted to a double
-			{
-				switch (i)
-				{
-				case 0:
-					magnetField = temp;
-					break;
-				case 1:
-					magnetCurrent = temp;
-					break;
-				case 2:
-					magnetVoltage = temp;
-					break;
-				case 3:
-					supplyCurrent = temp;
-					break;
-				case 4:
-					supplyVoltage = temp;
-					break;
-				case 5:
-					refCurrent = temp;
-					break;
-				case 6:
-					state = (quint8)temp;
-					break;
-				case 7:
-					heater = (quint8)temp;
-					break;
-				}
-			}
-		}
-
-		queryState.store(QueryState::IDLE_STATE);
 	}
 
-	// simple boolean type queries
-	else if (queryState.load() == QueryState::ABSORBER_PRESENT || queryState.load() == QueryState::SWITCH_INSTALLED   ||
-			 queryState.load() == QueryState::EXT_RAMPDOWN		|| queryState.load() == QueryState::STABILITY_RESISTOR ||
-			 queryState.load() == QueryState::SWITCH_HTR_STATE || queryState.load() == QueryState::SAMPLE_QUENCH_ENABLE)
+	else if (aState == QueryState::ABSORBER_PRESENT || aState == QueryState::SWITCH_INSTALLED   ||
+			 aState == QueryState::EXT_RAMPDOWN		|| aState == QueryState::STABILITY_RESISTOR ||
+			 aState == QueryState::SWITCH_HTR_STATE || aState == QueryState::SAMPLE_QUENCH_ENABLE)
 	{
 		#ifdef DEBUG
-	if (queryState.load() == QueryState::ABSORBER_PRESENT)
+	if (aState == QueryState::ABSORBER_PRESENT)
 		qDebug() << "AB? Reply: " << reply;
-	else if (queryState.load() == QueryState::SWITCH_INSTALLED)
+	else if (aState == QueryState::SWITCH_INSTALLED)
 		qDebug() << "PS:INST? Reply: " << reply;
-	else if (queryState.load() == QueryState::EXT_RAMPDOWN)
+	else if (aState == QueryState::EXT_RAMPDOWN)
 		qDebug() << "RAMPD:ENAB? Reply: " << reply;
-	else if (queryState.load() == QueryState::STABILITY_RESISTOR)
+	else if (aState == QueryState::STABILITY_RESISTOR)
 		qDebug() << "STAB:RES? Reply: " << reply;
-	else if (queryState.load() == QueryState::SWITCH_HTR_STATE)
+	else if (aState == QueryState::SWITCH_HTR_STATE)
 		qDebug() << "PS? Reply: " << reply;
-	else if (queryState.load() == QueryState::SAMPLE_QUENCH_ENABLE)
+	else if (aState == QueryState::SAMPLE_QUENCH_ENABLE)
 		qDebug() << "QU:SAM? Reply: " << reply;
 		#endif
 
@@ -239,72 +505,71 @@ void Socket::readyRead()
 
 		if (ok)	// if converted to an boolean
 		{
-			if (queryState.load() == QueryState::ABSORBER_PRESENT)
+			if (aState == QueryState::ABSORBER_PRESENT)
 				model430->absorberPresent = temp;
-			else if (queryState.load() == QueryState::SWITCH_INSTALLED)
+			else if (aState == QueryState::SWITCH_INSTALLED)
 				model430->switchInstalled = temp;
-			else if (queryState.load() == QueryState::EXT_RAMPDOWN)
+			else if (aState == QueryState::EXT_RAMPDOWN)
 				model430->extRampdownEnabled = temp;
-			else if (queryState.load() == QueryState::STABILITY_RESISTOR)
+			else if (aState == QueryState::STABILITY_RESISTOR)
 				model430->stabilityResistor = temp;
-			else if (queryState.load() == QueryState::SWITCH_HTR_STATE)
-				model430->switchHeaterState = temp;
-			else if (queryState.load() == QueryState::SAMPLE_QUENCH_ENABLE)
+			else if (aState == QueryState::SWITCH_HTR_STATE)
+				model430->setSwitchHeaterState(temp);
+			else if (aState == QueryState::SAMPLE_QUENCH_ENABLE)
 				model430->sampleQuenchDetection = temp;
 		}
-		queryState.store(QueryState::IDLE_STATE);
 	}
 
 	// simple integer type queries
-	else if (queryState.load() == QueryState::SUPPLY_TYPE		  || queryState.load() == QueryState::SUPPLY_VV_INPUT    ||
-			 queryState.load() == QueryState::STABILITY_MODE	  || queryState.load() == QueryState::SWITCH_TRANSITION  ||
-			 queryState.load() == QueryState::SWITCH_HEATED_TIME || queryState.load() == QueryState::SWITCH_COOLED_TIME ||
-			 queryState.load() == QueryState::QUENCH_ENABLE	  || queryState.load() == QueryState::QUENCH_SENSITIVITY ||
-			 queryState.load() == QueryState::PROTECTION_MODE	  || queryState.load() == QueryState::MODE				  ||
-			 queryState.load() == QueryState::RAMP_TIMEBASE	  || queryState.load() == QueryState::FIELD_UNITS		  ||
-			 queryState.load() == QueryState::RAMP_SEGMENTS	  || queryState.load() == QueryState::RAMPDOWN_SEGMENTS  ||
-			 queryState.load() == QueryState::RAMPDOWN_COUNT	  || queryState	== QueryState::QUENCH_COUNT		  ||
-			 queryState.load() == QueryState::STATE			  || queryState.load() == QueryState::CURRENT_RANGE	  ||
-			 queryState.load() == QueryState::SAMPLE_QUENCH_LIMIT)
+	else if (aState == QueryState::SUPPLY_TYPE		  || aState == QueryState::SUPPLY_VV_INPUT    ||
+			 aState == QueryState::STABILITY_MODE	  || aState == QueryState::SWITCH_TRANSITION  ||
+			 aState == QueryState::SWITCH_HEATED_TIME || aState == QueryState::SWITCH_COOLED_TIME ||
+			 aState == QueryState::QUENCH_ENABLE	  || aState == QueryState::QUENCH_SENSITIVITY ||
+			 aState == QueryState::PROTECTION_MODE	  || aState == QueryState::MODE				  ||
+			 aState == QueryState::RAMP_TIMEBASE	  || aState == QueryState::FIELD_UNITS		  ||
+			 aState == QueryState::RAMP_SEGMENTS	  || aState == QueryState::RAMPDOWN_SEGMENTS  ||
+			 aState == QueryState::RAMPDOWN_COUNT	  || aState == QueryState::QUENCH_COUNT		  ||
+			 aState == QueryState::STATE			  || aState == QueryState::CURRENT_RANGE	  ||
+			 aState == QueryState::SAMPLE_QUENCH_LIMIT)
 	{
 		#ifdef DEBUG
-		if (queryState.load() == QueryState::SUPPLY_TYPE)
+		if (aState == QueryState::SUPPLY_TYPE)
 			qDebug() << "SUPP:TYPE? Reply: " << reply;
-		else if (queryState.load() == QueryState::SUPPLY_VV_INPUT)
+		else if (aState == QueryState::SUPPLY_VV_INPUT)
 			qDebug() << "SUPP:MODE? Reply: " << reply;
-		else if (queryState.load() == QueryState::STABILITY_MODE)
+		else if (aState == QueryState::STABILITY_MODE)
 			qDebug() << "STAB:MODE? Reply: " << reply;
-		else if (queryState.load() == QueryState::SWITCH_TRANSITION)
+		else if (aState == QueryState::SWITCH_TRANSITION)
 			qDebug() << "PS:TRAN? Reply: " << reply;
-		else if (queryState.load() == QueryState::SWITCH_HEATED_TIME)
+		else if (aState == QueryState::SWITCH_HEATED_TIME)
 			qDebug() << "PS:HTIME? Reply: " << reply;
-		else if (queryState.load() == QueryState::SWITCH_COOLED_TIME)
+		else if (aState == QueryState::SWITCH_COOLED_TIME)
 			qDebug() << "PS:CTIME? Reply: " << reply;
-		else if (queryState.load() == QueryState::QUENCH_ENABLE)
+		else if (aState == QueryState::QUENCH_ENABLE)
 			qDebug() << "QU:DET? Reply: " << reply;
-		else if (queryState.load() == QueryState::QUENCH_SENSITIVITY)
+		else if (aState == QueryState::QUENCH_SENSITIVITY)
 			qDebug() << "QU:RATE? Reply: " << reply;
-		else if (queryState.load() == QueryState::PROTECTION_MODE)
+		else if (aState == QueryState::PROTECTION_MODE)
 			qDebug() << "OPLIMIT:MODE? Reply: " << reply;
-		else if (queryState.load() == QueryState::MODE)
+		else if (aState == QueryState::MODE)
 			qDebug() << "MODE? Reply: " << reply;
-		else if (queryState.load() == QueryState::RAMP_TIMEBASE)
+		else if (aState == QueryState::RAMP_TIMEBASE)
 			qDebug() << "RAMP:RATE:UNITS? Reply: " << reply;
-		else if (queryState.load() == QueryState::FIELD_UNITS)
+		else if (aState == QueryState::FIELD_UNITS)
 			qDebug() << "FIELD:UNITS? Reply: " << reply;
-		else if (queryState.load() == QueryState::RAMP_SEGMENTS)
+		else if (aState == QueryState::RAMP_SEGMENTS)
 			qDebug() << "RAMP:RATE:SEG? Reply: " << reply;
-		else if (queryState.load() == QueryState::RAMPDOWN_SEGMENTS)
+		else if (aState == QueryState::RAMPDOWN_SEGMENTS)
 			qDebug() << "RAMPD:RATE:SEG? Reply : " << reply;
-		else if (queryState.load() == QueryState::RAMPDOWN_COUNT)
+		else if (aState == QueryState::RAMPDOWN_COUNT)
 			qDebug() << "RAMPD:COUNT? Reply : " << reply;
-		else if (queryState.load() == QueryState::QUENCH_COUNT)
+		else if (aState == QueryState::QUENCH_COUNT)
 			qDebug() << "QU:COUNT? Reply : " << reply;
-		else if (queryState.load() == QueryState::STATE)
+		else if (aState == QueryState::STATE)
 			qDebug() << "STATE? Reply : " << reply;
-		else if (queryState.load() == QueryState::CURRENT_RANGE)
+		else if (aState == QueryState::CURRENT_RANGE)
 			qDebug() << "SUPP:RANGE? Reply : " << reply;
-		else if (queryState.load() == QueryState::SAMPLE_QUENCH_LIMIT)
+		else if (aState == QueryState::SAMPLE_QUENCH_LIMIT)
 			qDebug() << "QU:SAM? Reply : " << reply;
 		#endif
 
@@ -314,101 +579,103 @@ void Socket::readyRead()
 
 		if (ok)	// if converted to an integer
 		{
-			if (queryState.load() == QueryState::SUPPLY_TYPE)
+			if (aState == QueryState::SUPPLY_TYPE)
 				model430->powerSupplySelection = temp;
-			else if (queryState.load() == QueryState::SUPPLY_VV_INPUT)
+			else if (aState == QueryState::SUPPLY_VV_INPUT)
 				model430->inputVoltageRange = temp;
-			else if (queryState.load() == QueryState::STABILITY_MODE)
+			else if (aState == QueryState::STABILITY_MODE)
 				model430->stabilityMode = temp;
-			else if (queryState.load() == QueryState::SWITCH_TRANSITION)
+			else if (aState == QueryState::SWITCH_TRANSITION)
 				model430->switchTransition = temp;
-			else if (queryState.load() == QueryState::SWITCH_HEATED_TIME)
+			else if (aState == QueryState::SWITCH_HEATED_TIME)
 				model430->switchHeatedTime = temp;
-			else if (queryState.load() == QueryState::SWITCH_COOLED_TIME)
+			else if (aState == QueryState::SWITCH_COOLED_TIME)
 				model430->switchCooledTime = temp;
-			else if (queryState.load() == QueryState::QUENCH_ENABLE)
+			else if (aState == QueryState::QUENCH_ENABLE)
 				model430->quenchDetection = temp;
-			else if (queryState.load() == QueryState::QUENCH_SENSITIVITY)
+			else if (aState == QueryState::QUENCH_SENSITIVITY)
 				model430->quenchSensitivity = temp;
-			else if (queryState.load() == QueryState::PROTECTION_MODE)
+			else if (aState == QueryState::PROTECTION_MODE)
 				model430->protectionMode = temp;
-			else if (queryState.load() == QueryState::MODE)
+			else if (aState == QueryState::MODE)
 				model430->mode = temp;
-			else if (queryState.load() == QueryState::RAMP_TIMEBASE)
+			else if (aState == QueryState::RAMP_TIMEBASE)
 				model430->rampRateTimeUnits = temp;
-			else if (queryState.load() == QueryState::FIELD_UNITS)
+			else if (aState == QueryState::FIELD_UNITS)
 				model430->fieldUnits = temp;
-			else if (queryState.load() == QueryState::RAMP_SEGMENTS)
+			else if (aState == QueryState::RAMP_SEGMENTS)
 				model430->rampRateSegments = temp;
-			else if (queryState.load() == QueryState::RAMPDOWN_SEGMENTS)
+			else if (aState == QueryState::RAMPDOWN_SEGMENTS)
 				model430->rampdownSegments = temp;
-			else if (queryState.load() == QueryState::RAMPDOWN_COUNT)
+			else if (aState == QueryState::RAMPDOWN_COUNT)
 				model430->rampdownEventsCount = temp;
-			else if (queryState.load() == QueryState::QUENCH_COUNT)
+			else if (aState == QueryState::QUENCH_COUNT)
 				model430->quenchEventsCount = temp;
-			else if (queryState.load() == QueryState::STATE)
+			else if (aState == QueryState::STATE)
 				model430->state = (State)temp;
-			else if (queryState.load() == QueryState::CURRENT_RANGE)
+			else if (aState == QueryState::CURRENT_RANGE)
 				model430->currentRange = temp;
-			else if (queryState.load() == QueryState::SAMPLE_QUENCH_LIMIT)
+			else if (aState == QueryState::SAMPLE_QUENCH_LIMIT)
 				model430->sampleQuenchLimit = temp;
 		}
-		queryState.store(QueryState::IDLE_STATE);
 	}
 
 	// simple floating point queries
-	else if (queryState.load() == QueryState::SUPPLY_MIN_VOLTAGE  || queryState.load() == QueryState::SUPPLY_MAX_VOLTAGE	  ||
-			 queryState.load() == QueryState::SUPPLY_MIN_CURRENT  || queryState.load() == QueryState::SUPPLY_MAX_CURRENT	  ||
-			 queryState.load() == QueryState::STABILITY_SETTING   || queryState.load() == QueryState::COIL_CONSTANT		  ||
-			 queryState.load() == QueryState::INDUCTANCE		   || queryState.load() == QueryState::SENSE_INDUCTANCE      ||
-			 queryState.load() == QueryState::SWITCH_CURRENT	   || queryState.load() == QueryState::PS_RAMP_RATE		  ||
-			 queryState.load() == QueryState::SWITCH_COOLING_GAIN || queryState.load() == QueryState::CURRENT_LIMIT		  ||
-			 queryState.load() == QueryState::IC_SLOPE			   || queryState.load() == QueryState::IC_OFFSET			  ||
-			 queryState.load() == QueryState::TSCALE			   || queryState.load() == QueryState::TOFFSET				  ||
-			 queryState.load() == QueryState::TMAX				   || queryState.load() == QueryState::TARGET_CURRENT		  ||
-			 queryState.load() == QueryState::TARGET_FIELD		   || queryState.load() == QueryState::VOLTAGE_LIMIT)
+	else if (aState == QueryState::SUPPLY_MIN_VOLTAGE  || aState == QueryState::SUPPLY_MAX_VOLTAGE	  ||
+			 aState == QueryState::SUPPLY_MIN_CURRENT  || aState == QueryState::SUPPLY_MAX_CURRENT	  ||
+			 aState == QueryState::STABILITY_SETTING   || aState == QueryState::COIL_CONSTANT		  ||
+			 aState == QueryState::INDUCTANCE		   || aState == QueryState::SENSE_INDUCTANCE      ||
+			 aState == QueryState::SWITCH_CURRENT	   || aState == QueryState::PS_RAMP_RATE		  ||
+			 aState == QueryState::SWITCH_COOLING_GAIN || aState == QueryState::CURRENT_LIMIT		  ||
+			 aState == QueryState::IC_SLOPE			   || aState == QueryState::IC_OFFSET			  ||
+			 aState == QueryState::TSCALE			   || aState == QueryState::TOFFSET				  ||
+			 aState == QueryState::TMAX				   || aState == QueryState::TARGET_CURRENT		  ||
+			 aState == QueryState::TARGET_FIELD		   || aState == QueryState::VOLTAGE_LIMIT		  ||
+			 aState == QueryState::AUTODETECT_SWITCH_CURRENT)
 	{
 		#ifdef DEBUG
-		if (queryState.load() == QueryState::SUPPLY_MIN_VOLTAGE)
+		if (aState == QueryState::SUPPLY_MIN_VOLTAGE)
 			qDebug() << "SUPP:VOLT:MIN? Reply: " << reply;
-		else if (queryState.load() == QueryState::SUPPLY_MAX_VOLTAGE)
+		else if (aState == QueryState::SUPPLY_MAX_VOLTAGE)
 			qDebug() << "SUPP:VOLT:MAX? Reply: " << reply;
-		else if (queryState.load() == QueryState::SUPPLY_MIN_CURRENT)
+		else if (aState == QueryState::SUPPLY_MIN_CURRENT)
 			qDebug() << "SUPP:CURR:MIN? Reply: " << reply;
-		else if (queryState.load() == QueryState::SUPPLY_MAX_CURRENT)
+		else if (aState == QueryState::SUPPLY_MAX_CURRENT)
 			qDebug() << "SUPP:CURR:MIN? Reply: " << reply;
-		else if (queryState.load() == QueryState::STABILITY_SETTING)
+		else if (aState == QueryState::STABILITY_SETTING)
 			qDebug() << "STAB? Reply: " << reply;
-		else if (queryState.load() == QueryState::COIL_CONSTANT)
+		else if (aState == QueryState::COIL_CONSTANT)
 			qDebug() << "COIL? Reply: " << reply;
-		else if (queryState.load() == QueryState::INDUCTANCE)
+		else if (aState == QueryState::INDUCTANCE)
 			qDebug() << "IND? Reply: " << reply;
-		else if (queryState.load() == QueryState::SWITCH_CURRENT)
+		else if (aState == QueryState::SWITCH_CURRENT)
 			qDebug() << "PS:CURR? Reply: " << reply;
-		else if (queryState.load() == QueryState::PS_RAMP_RATE)
+		else if (aState == QueryState::PS_RAMP_RATE)
 			qDebug() << "PS:PSRR? Reply: " << reply;
-		else if (queryState.load() == QueryState::SWITCH_COOLING_GAIN)
+		else if (aState == QueryState::SWITCH_COOLING_GAIN)
 			qDebug() << "PS:CGAIN? Reply: " << reply;
-		else if (queryState.load() == QueryState::CURRENT_LIMIT)
+		else if (aState == QueryState::CURRENT_LIMIT)
 			qDebug() << "CURR:LIM? Reply: " << reply;
-		else if (queryState.load() == QueryState::IC_SLOPE)
+		else if (aState == QueryState::IC_SLOPE)
 			qDebug() << "OPL:ICSLOPE? Reply: " << reply;
-		else if (queryState.load() == QueryState::IC_OFFSET)
+		else if (aState == QueryState::IC_OFFSET)
 			qDebug() << "OPL:ICOFFSET? Reply: " << reply;
-		else if (queryState.load() == QueryState::TSCALE)
+		else if (aState == QueryState::TSCALE)
 			qDebug() << "OPL:TSCALE? Reply: " << reply;
-		else if (queryState.load() == QueryState::IC_OFFSET)
+		else if (aState == QueryState::IC_OFFSET)
 			qDebug() << "OPL:TOFFSET? Reply: " << reply;
-		else if (queryState.load() == QueryState::TMAX)
+		else if (aState == QueryState::TMAX)
 			qDebug() << "OPL:TMAX? Reply: " << reply;
-		else if (queryState.load() == QueryState::SENSE_INDUCTANCE)
+		else if (aState == QueryState::SENSE_INDUCTANCE)
 			qDebug() << "IND:SENSE? Reply: " << reply;
-		else if (queryState.load() == QueryState::TARGET_CURRENT)
+		else if (aState == QueryState::TARGET_CURRENT)
 			qDebug() << "CURR:TARG? Reply: " << reply;
-		else if (queryState.load() == QueryState::TARGET_FIELD)
+		else if (aState == QueryState::TARGET_FIELD)
 			qDebug() << "FIELD:TARG? Reply: " << reply;
-		else if (queryState.load() == QueryState::VOLTAGE_LIMIT)
+		else if (aState == QueryState::VOLTAGE_LIMIT)
 			qDebug() << "VOLT:LIM? Reply: " << reply;
+		else if (aState == QueryState::AUTODETECT_SWITCH_CURRENT)
+			qDebug() << "PS:AUTOD? Reply: " << reply;
 		#endif
 
 		// read return data
@@ -417,64 +684,64 @@ void Socket::readyRead()
 
 		if (ok)	// if converted to a double
 		{
-			if (queryState.load() == QueryState::SUPPLY_MIN_VOLTAGE)
+			if (aState == QueryState::SUPPLY_MIN_VOLTAGE)
 				model430->minSupplyVoltage = temp;
-			else if (queryState.load() == QueryState::SUPPLY_MAX_VOLTAGE)
+			else if (aState == QueryState::SUPPLY_MAX_VOLTAGE)
 				model430->maxSupplyVoltage = temp;
-			else if (queryState.load() == QueryState::SUPPLY_MIN_CURRENT)
+			else if (aState == QueryState::SUPPLY_MIN_CURRENT)
 				model430->minSupplyCurrent = temp;
-			else if (queryState.load() == QueryState::SUPPLY_MAX_CURRENT)
+			else if (aState == QueryState::SUPPLY_MAX_CURRENT)
 				model430->maxSupplyCurrent = temp;
-			else if (queryState.load() == QueryState::STABILITY_SETTING)
+			else if (aState == QueryState::STABILITY_SETTING)
 				model430->stabilitySetting = temp;
-			else if (queryState.load() == QueryState::COIL_CONSTANT)
+			else if (aState == QueryState::COIL_CONSTANT)
 				model430->coilConstant = temp;
-			else if (queryState.load() == QueryState::INDUCTANCE)
+			else if (aState == QueryState::INDUCTANCE)
 				model430->inductance = temp;
-			else if (queryState.load() == QueryState::SWITCH_CURRENT)
+			else if (aState == QueryState::SWITCH_CURRENT)
 				model430->switchCurrent = temp;
-			else if (queryState.load() == QueryState::PS_RAMP_RATE)
+			else if (aState == QueryState::PS_RAMP_RATE)
 				model430->cooledSwitchRampRate = temp;
-			else if (queryState.load() == QueryState::SWITCH_COOLING_GAIN)
+			else if (aState == QueryState::SWITCH_COOLING_GAIN)
 				model430->switchCoolingGain = temp;
-			else if (queryState.load() == QueryState::CURRENT_LIMIT)
+			else if (aState == QueryState::CURRENT_LIMIT)
 				model430->currentLimit = temp;
-			else if (queryState.load() == QueryState::IC_SLOPE)
+			else if (aState == QueryState::IC_SLOPE)
 				model430->IcSlope = temp;
-			else if (queryState.load() == QueryState::IC_OFFSET)
+			else if (aState == QueryState::IC_OFFSET)
 				model430->IcOffset = temp;
-			else if (queryState.load() == QueryState::TSCALE)
+			else if (aState == QueryState::TSCALE)
 				model430->Tscale = temp;
-			else if (queryState.load() == QueryState::IC_OFFSET)
+			else if (aState == QueryState::IC_OFFSET)
 				model430->Toffset = temp;
-			else if (queryState.load() == QueryState::TMAX)
+			else if (aState == QueryState::TMAX)
 				model430->Tmax = temp;
-			else if (queryState.load() == QueryState::SENSE_INDUCTANCE)
+			else if (aState == QueryState::SENSE_INDUCTANCE)
 				model430->inductance = temp;
-			else if (queryState.load() == QueryState::TARGET_CURRENT)
+			else if (aState == QueryState::TARGET_CURRENT)
 				model430->targetCurrent = temp;
-			else if (queryState.load() == QueryState::TARGET_FIELD)
+			else if (aState == QueryState::TARGET_FIELD)
 				model430->targetField = temp;
-			else if (queryState.load() == QueryState::VOLTAGE_LIMIT)
+			else if (aState == QueryState::VOLTAGE_LIMIT)
 				model430->voltageLimit = temp;
+			else if (aState == QueryState::AUTODETECT_SWITCH_CURRENT)
+				model430->switchCurrent = temp;
 		}
-
-		queryState.store(QueryState::IDLE_STATE);
 	}
 
 	// two doubles returned queries
-	else if (queryState.load() == QueryState::RAMP_RATE_CURRENT || queryState.load() == QueryState::RAMP_RATE_FIELD ||
-			 queryState.load() == QueryState::RAMPDOWN_CURRENT  || queryState.load() == QueryState::RAMPDOWN_FIELD)
+	else if (aState == QueryState::RAMP_RATE_CURRENT || aState == QueryState::RAMP_RATE_FIELD ||
+			 aState == QueryState::RAMPDOWN_CURRENT  || aState == QueryState::RAMPDOWN_FIELD)
 	{
 		#ifdef DEBUG
-		if (queryState.load() == QueryState::RAMP_RATE_CURRENT)
-			qDebug() << "RAMP:RATE:CURR:" + QString::number(rampSegment) + "? Reply: " << reply;
-		else if (queryState.load() == QueryState::RAMP_RATE_FIELD)
-			qDebug() << "RAMP:RATE:FIELD:" + QString::number(rampSegment) + "? Reply: " << reply;
-		else if (queryState.load() == QueryState::RAMPDOWN_CURRENT)
-			qDebug() << "RAMPD:RATE:CURR:" + QString::number(rampSegment) + "? Reply: " << reply;
-		else if (queryState.load() == QueryState::RAMPDOWN_FIELD)
-			qDebug() << "RAMPD:RATE:FIELD:" + QString::number(rampSegment) + "? Reply: " << reply;
+		if (aState == QueryState::RAMP_RATE_CURRENT)
+			qDebug() << "RAMP:RATE:CURR:" + QString::number(segment) + "? Reply: " << reply;
+		else if (aState == QueryState::RAMP_RATE_FIELD)
+			qDebug() << "RAMP:RATE:FIELD:" + QString::number(segment) + "? Reply: " << reply;
+		else if (aState == QueryState::RAMPDOWN_CURRENT)
+			qDebug() << "RAMPD:RATE:CURR:" + QString::number(segment) + "? Reply: " << reply;
+		else if (aState == QueryState::RAMPDOWN_FIELD)
+			qDebug() << "RAMPD:RATE:FIELD:" + QString::number(segment) + "? Reply: " << reply;
 		#endif
 
 		// read return data
@@ -490,313 +757,384 @@ void Socket::readyRead()
 			{
 				if (i == 0)	// ramp rate value
 				{
-					if (queryState.load() == QueryState::RAMP_RATE_CURRENT)
-						model430->currentRampRates[rampSegment - 1] = temp;
-					else if (queryState.load() == QueryState::RAMP_RATE_FIELD)
-						model430->fieldRampRates[rampSegment - 1] = temp;
-					else if (queryState.load() == QueryState::RAMPDOWN_CURRENT)
-						model430->currentRampdownRates[rampSegment - 1] = temp;
-					else if (queryState.load() == QueryState::RAMPDOWN_FIELD)
-						model430->fieldRampdownRates[rampSegment - 1] = temp;
+					if (aState == QueryState::RAMP_RATE_CURRENT)
+						model430->currentRampRates[segment - 1] = temp;
+					else if (aState == QueryState::RAMP_RATE_FIELD)
+						model430->fieldRampRates[segment - 1] = temp;
+					else if (aState == QueryState::RAMPDOWN_CURRENT)
+						model430->currentRampdownRates[segment - 1] = temp;
+					else if (aState == QueryState::RAMPDOWN_FIELD)
+						model430->fieldRampdownRates[segment - 1] = temp;
 				}
 				else if (i == 1) // ramp limit value
 				{
-					if (queryState.load() == QueryState::RAMP_RATE_CURRENT)
-						model430->currentRampLimits[rampSegment - 1] = temp;
-					else if (queryState.load() == QueryState::RAMP_RATE_FIELD)
-						model430->fieldRampLimits[rampSegment - 1] = temp;
-					else if (queryState.load() == QueryState::RAMPDOWN_CURRENT)
-						model430->currentRampdownLimits[rampSegment - 1] = temp;
-					else if (queryState.load() == QueryState::RAMPDOWN_FIELD)
-						model430->fieldRampdownLimits[rampSegment - 1] = temp;
+					if (aState == QueryState::RAMP_RATE_CURRENT)
+						model430->currentRampLimits[segment - 1] = temp;
+					else if (aState == QueryState::RAMP_RATE_FIELD)
+						model430->fieldRampLimits[segment - 1] = temp;
+					else if (aState == QueryState::RAMPDOWN_CURRENT)
+						model430->currentRampdownLimits[segment - 1] = temp;
+					else if (aState == QueryState::RAMPDOWN_FIELD)
+						model430->fieldRampdownLimits[segment - 1] = temp;
 				}
 			}
 		}
-
-		queryState.store(QueryState::IDLE_STATE);
 	}
 
-	else if (queryState.load() == QueryState::SAMPLE_CURRENT)
+	else if (aState == QueryState::SYSTEM_ERROR)
 	{
 		#ifdef DEBUG
-		qDebug() << "CURRENT: " << reply;
+		qDebug() << "SYST:ERR? Reply: " << reply;
 		#endif
 
-		// read return data
-		magnetCurrent = reply.toDouble();
+		// parse error message code and save
+		QStringList strList = reply.split(',');
+
+		// first string in list should be error code
+		bool ok;
+		int temp = strList.at(0).toInt(&ok);
 
-		queryState.store(QueryState::IDLE_STATE);
+		if (ok)
+			model430->errorCode = -(temp);	// flip sign to positive value
 	}
 
-	else if (queryState.load() == QueryState::SAMPLE_VOLTAGE)
+	else if (aState == QueryState::STATUS_BYTE)
 	{
 		#ifdef DEBUG
-		qDebug() << "VOLTAGE: " << reply;
+		qDebug() << "*STB? Reply: " << reply;
 		#endif
 
-		// read return data
-		magnetVoltage = reply.toDouble();
+		bool ok;
+#if defined(Q_OS_LINUX) || defined(Q_OS_MACOS)
+	   unsigned char temp = (unsigned char)(reply.toInt(&ok));
+#else
+		byte temp = (byte)(reply.toInt(&ok));
+#endif
 
-		queryState.store(QueryState::IDLE_STATE);
+		if (ok)
+			model430->statusByte = temp;
 	}
 
-	else if (queryState.load() == QueryState::SYSTEM_ERROR)
+	else if (aState == QueryState::RAMPDOWN_FILE)
 	{
-		queryState.store(QueryState::IDLE_STATE);
-
-		#ifdef DEBUG
-		qDebug() << "SYST:ERR? Reply: " << reply;
-		#endif
+		// complete reply ends with contiguous <CR><LF> pairs
+		model430->setRampdownFile(reply);
+	}
 
-		// parse error message code and save
-		QStringList strList = reply.split(',');
+	else if (aState == QueryState::QUENCH_FILE)
+	{
+		// complete reply ends with contiguous <CR><LF> pairs
+		model430->setQuenchFile(reply);
+	}
 
-		// first string in list should be error code
-		bool ok;
-		int temp = strList.at(0).toInt(&ok);
+	else if (aState == QueryState::SETTINGS)
+	{
+		// complete reply ends with contiguous <CR><LF> pairs
+		model430->setSettings(reply);
+	}
 
-		if (ok)
-			model430->errorCode = -(temp);	// flip sign to positive value
+	else if (aState == QueryState::IPNAME)
+	{
+		qDebug() << "IPNAME? reply: " << reply;
 
-		emit systemErrorMessage(reply, nullptr);
+		reply.truncate(reply.length() - 2);	// remove terminators
+		model430->setIpName(reply);
 	}
+}
 
-	else if (queryState.load() == QueryState::MSG_UPDATE)	// port 23 only
+//---------------------------------------------------------------------------
+// Decodes a *TRG or *AMITRG reply in place without allocating. The reply is a
+// comma-separated list of numbers terminated by <CR><LF>. A reply with a bad
+// field or the wrong number of fields is counted as malformed and the last
+// good sample is left untouched.
+bool Socket::decodeSample(const char *data, int length, QueryState aState)
+{
+	double fields[MAX_SAMPLE_FIELDS];
+	const char *ptr = data;
+	const char *end = data + length;
+	int count = 0;
+	bool ok = true;
+
+	#ifdef DEBUG
+	if (aState == QueryState::AMI_TRG_SAMPLE)
+		qDebug() << "*AMITRG Reply: " << QByteArray(data, length);
+	else
+		qDebug() << "*TRG Reply: " << QByteArray(data, length);
+	#endif
+
+	// strip terminators
+	while (end > ptr && (end[-1] == '\r' || end[-1] == '\n'))
+		end--;
+
+	while (ok && ptr < end)
 	{
-		// parse MSG_UPDATE messages with display and keypad info
-		if (reply.contains("MSG_DISP_UPDATE::"))
+		if (count == MAX_SAMPLE_FIELDS)
 		{
-			// split at the :: delimiters
-			QStringList strList = reply.split("::");
-			#ifdef DEBUG
-			qDebug() << "MSG_DISP_UPDATE::" + strList[1] + "::" + strList[2];
-			#endif
-
-			// expect 9 substrings -- if incomplete, ignore
-			if (strList.count() < 9)
-				return;
-
-			QString displayStr = strList[1] + "\n" + strList[2];
-			bool leds[6] = { false, false, false, false, false, false };
-
-			for (int i = 0; i < 6; i++)
-			{
-				if (strList[i + 3] == "1")
-					leds[i] = true;
-			}
+			ok = false;
+			break;
+		}
 
-			if (model430->state() == State::QUENCH)
-			{
-				// parse quench current from display string
-				QString quenchStr;
-				int start = displayStr.indexOf("Quench Detect @");
-				start += 15;
-				quenchStr = displayStr.mid(start, 12);
-				quenchStr.replace("A", " ");
+		// parseDouble() accepts neither leading whitespace nor a plus sign
+		while (ptr < end && *ptr == ' ')
+			ptr++;
 
-				bool ok;
-				double temp = quenchStr.toDouble(&ok);
-				if (ok)
-					model430->quenchCurrent = temp;
-			}
+		if (ptr < end && *ptr == '+')
+			ptr++;
 
-			emit updateFrontPanel(displayStr, leds[0], leds[1], leds[2], leds[3], leds[4]);
-		}
+		const char *next = parseDouble(ptr, end, fields[count]);
 
-		if (reply.contains("MSG_VOLTMETER_UPDATE::"))
+		if (next == nullptr)
 		{
-			// split at the :: delimiters
-			QStringList strList = reply.split("::");
-#ifdef DEBUG
-			qDebug() << "MSG_VOLTMETER_UPDATE::" + strList[1] + "::" + strList[2];
-#endif
-
-			// expect 11 substrings -- if incomplete, ignore
-			if (strList.count() < 11)
-				return;
+			ok = false;
+			break;
+		}
 
-			QString displayStr = strList[1] + "  (Showing " + strList[9] + " Bar Graph)  " + "\n" + strList[2] + "      " + strList[9] + " = " + strList[10] + "       ";
-			bool leds[6] = { false, false, false, false, false, false };
+		count++;
+		ptr = next;
 
-			for (int i = 0; i < 6; i++)
-			{
-				if (strList[i + 3] == "1")
-					leds[i] = true;
-			}
+		while (ptr < end && *ptr == ' ')
+			ptr++;
 
-			emit updateFrontPanel(displayStr, leds[0], leds[1], leds[2], leds[3], leds[4]);
+		if (ptr < end)
+		{
+			// expect a delimiter followed by another value
+			if (*ptr != ',' || ++ptr == end)
+				ok = false;
 		}
+	}
 
-		if (reply.contains("FIELD_UNITS_CHANGED"))
-		{
-			#ifdef DEBUG
-			qDebug() << "MSG_FIELD_UNITS_CHANGED";
-			#endif
-
-			// field units change notification
-			emit fieldUnitsChanged();
-		}
+	// check the field count for the query sent
+	if (aState == QueryState::AMI_TRG_SAMPLE)
+	{
+		if (count < AMI_TRG_MIN_FIELDS)
+			ok = false;
+	}
+	else if (count != TRG_SAMPLE_FIELDS)
+	{
+		ok = false;
+	}
 
-		if (reply.contains("BEEP"))
-		{
-			#ifdef DEBUG
-			qDebug() << "MSG_BEEP";
-			#endif
+	if (!ok)
+	{
+		stats.recordMalformedReply();
 
-			// an error beep occurred, set flag for possible SYST:ERR? status display
-			emit systemError();
-		}
+		#ifdef DEBUG
+		qDebug() << "Malformed sample reply: " << QByteArray(data, length);
+		#endif
 
-		// the following assist in syncing Magnet-DAQ panels with remote changes by operator
-		if (reply.contains("SYNC:SUPPLY"))
-		{
-			#ifdef DEBUG
-			qDebug() << "MSG_SYNC:SUPPLY";
-			#endif
-			magnetdaqParent->remoteConfigurationChanged(SUPPLY_PAGE);
-		}
-		else if (reply.contains("SYNC:LOAD"))
-		{
-			#ifdef DEBUG
-			qDebug() << "MSG_SYNC:LOAD";
-			#endif
-			magnetdaqParent->remoteConfigurationChanged(LOAD_PAGE);
-		}
-		else if (reply.contains("SYNC:SWITCH"))
-		{
-			#ifdef DEBUG
-			qDebug() << "MSG_SYNC:SWITCH";
-			#endif
-			magnetdaqParent->remoteConfigurationChanged(SWITCH_PAGE);
-		}
-		else if (reply.contains("SYNC:PROT"))
-		{
-			#ifdef DEBUG
-			qDebug() << "MSG_SYNC:PROT";
-			#endif
-			magnetdaqParent->remoteConfigurationChanged(PROTECTION_PAGE);
-		}
-		else if (reply.contains("SYNC:RAMP"))
-		{
-			#ifdef DEBUG
-			qDebug() << "MSG_SYNC:RAMP";
-			#endif
-			magnetdaqParent->remoteConfigurationChanged(RAMP_PAGE);
-		}
+		return false;
+	}
 
-		if (reply.contains("EXT_RAMPDOWN_START"))
-		{
-			#ifdef DEBUG
-			qDebug() << "MSG_EXT_RAMPDOWN_START";
-			#endif
+	lastSample.magnetField = fields[0];
+	lastSample.magnetCurrent = fields[1];
+	lastSample.magnetVoltage = fields[2];
+	lastSample.supplyCurrent = fields[3];
+	lastSample.supplyVoltage = fields[4];
 
-			// external rampdown start notification
-			emit startExternalRampdown();
-		}
+	// NOTE: last three values not received in firmware prior to 2.64/3.14
+	if (count > 5)
+		lastSample.refCurrent = fields[5];
 
-		if (reply.contains("EXT_RAMPDOWN_END"))
-		{
-			#ifdef DEBUG
-			qDebug() << "MSG_EXT_RAMPDOWN_END";
-			#endif
+	if (count > 6)
+	{
+		lastSample.state = (quint8)fields[6];
 
-			// external rampdown end notification
-			emit endExternalRampdown();
-		}
+		// a quench adds to the quench event file
+		if (State(lastSample.state) == State::QUENCH)
+			model430->markStale(QUENCH_EVENTS_SYNC);
 	}
 
-	else if (queryState.load() == QueryState::STATUS_BYTE)
-	{
-		#ifdef DEBUG
-		qDebug() << "*STB? Reply: " << reply;
-		#endif
-
-		bool ok;
-#if defined(Q_OS_LINUX) || defined(Q_OS_MACOS)
-	   unsigned char temp = (unsigned char)(reply.toInt(&ok));
-#else
-		byte temp = (byte)(reply.toInt(&ok));
-#endif
+	if (count > 7)
+		lastSample.heater = (quint8)fields[7];
 
-		if (ok)
-			model430->statusByte = temp;
+	return true;
+}
 
-		queryState.store(QueryState::IDLE_STATE);
+//---------------------------------------------------------------------------
+// Samples are triggered on absolute deadlines of a monotonic clock. The
+// period adapts to the measured trigger reply latency, so acquisition runs
+// as fast as the connected 430 can sustain, but never faster than maxRate.
+// Call from the thread that reads nextSample(), which owns the ring's tail.
+void Socket::startSampling(int maxRate)
+{
+	if (!isIoThread())
+	{
+		sampleRing.clear();	// consumer side, before the I/O thread pushes again
+		QMetaObject::invokeMethod(this, [=]() { startSampling(maxRate); }, Qt::QueuedConnection);
+		return;
 	}
 
-	else if (queryState.load() == QueryState::RAMPDOWN_FILE)
-	{
-		replyBuffer.append(reply);
+	setSampleRateLimit(maxRate);
+	rateBoost = false;
+	latencyAvg = 0.0;
+	missedDeadlines = 0;
+	acquisitionClock.start();
+	epochOffset = QDateTime::currentMSecsSinceEpoch() * 1000;
+
+	statsStart = 0;
+	lastTriggerTime = -1;
+	intervalCount = 0;
+	intervalMean = 0.0;
+	intervalM2 = 0.0;
+
+	// first sample right away
+	nextDeadline = 0;
+	sampleTimer.start(0);
+}
 
-		// check for contiguous <CR><LF> for transmission finished
-		if (replyBuffer.contains("\r\n\r\n"))
-		{
-			queryState.store(QueryState::IDLE_STATE);
-			model430->setRampdownFile(replyBuffer);
-		}
+//---------------------------------------------------------------------------
+void Socket::stopSampling(void)
+{
+	if (!isIoThread())
+	{
+		QMetaObject::invokeMethod(this, [=]() { stopSampling(); }, Qt::QueuedConnection);
+		return;
 	}
 
-	else if (queryState.load() == QueryState::QUENCH_FILE)
+	sampleTimer.stop();
+}
+
+//---------------------------------------------------------------------------
+// May be changed while sampling, takes effect at the next deadline.
+void Socket::setSampleRateLimit(int maxRate)
+{
+	if (!isIoThread())
 	{
-		replyBuffer.append(reply);
+		QMetaObject::invokeMethod(this, [=]() { setSampleRateLimit(maxRate); }, Qt::QueuedConnection);
+		return;
+	}
 
-		// check for contiguous <CR><LF> for transmission finished
-		if (replyBuffer.contains("\r\n\r\n"))
-		{
-			queryState.store(QueryState::IDLE_STATE);
-			model430->setQuenchFile(replyBuffer);
-		}
+	minSamplePeriod = 1000000000 / qMax(maxRate, 1);
+}
+
+//---------------------------------------------------------------------------
+// While boosted the user rate limit is ignored and acquisition runs as fast
+// as the 430 replies, e.g. around a quench. Takes effect at the next deadline.
+void Socket::setRateBoost(bool boost)
+{
+	if (!isIoThread())
+	{
+		QMetaObject::invokeMethod(this, [=]() { setRateBoost(boost); }, Qt::QueuedConnection);
+		return;
 	}
 
-	else if (queryState.load() == QueryState::SETTINGS)
+	rateBoost = boost;
+}
+
+//---------------------------------------------------------------------------
+// Runs on the I/O thread at each sample deadline, independent of GUI activity.
+void Socket::getNextDataPoint(void)
+{
+	qint64 now = acquisitionClock.nsecsElapsed();
+
+	// only one trigger on the wire at a time, samples are never queued up
+	if (unitConnected && !triggerInFlight)
 	{
-		replyBuffer.append(reply);
+		triggerInFlight = true;
+		triggerWriteTime = now;	// updated when actually written
+		updateAcquisitionStats(now);
 
-		// check for contiguous <CR><LF> for transmission finished
-		if (replyBuffer.contains("\r\n\r\n"))
+		QueryCallback onSample = [this, now](bool ok)
 		{
-			queryState.store(QueryState::IDLE_STATE);
-			model430->setSettings(replyBuffer);
-		}
-	}
+			qint64 received = acquisitionClock.nsecsElapsed();
 
-	else if (queryState.load() == QueryState::IPNAME)
-	{
-		qDebug() << "IPNAME? reply: " << reply;
+			triggerInFlight = false;
 
-		reply.truncate(reply.length() - 2);	// remove terminators
-		model430->setIpName(reply);
-		queryState.store(QueryState::IDLE_STATE);
+			// a timeout counts at its full length so the period backs off
+			double latency = (double)(received - now);
+
+			if (latencyAvg == 0.0)
+				latencyAvg = latency;
+			else
+				latencyAvg += LATENCY_SMOOTHING * (latency - latencyAvg);
+
+			if (!unitConnected)
+				return;
+
+			// a timed out or malformed reply is passed on flagged as stale
+			// so the gap is visible rather than silently re-plotted
+			Sample sample = lastSample;
+
+			sample.sendTime = triggerWriteTime / 1000;
+			sample.receiveTime = received / 1000;
+			sample.midpointTime = (sample.sendTime + sample.receiveTime) / 2;
+			sample.time = (epochOffset + sample.midpointTime) / 1000;
+			sample.stale = !ok;
+
+			// GUI has fallen more than a ring behind, drop the newest
+			if (!sampleRing.push(sample))
+				droppedSamples++;
+
+			if (streamSamples.load())
+				emit sampleAcquired(sample);
+		};
+
+		if (magnetdaqParent->supports_AMITRG())	// firmware 2.64/3.14 or later supports private trigger
+			enqueueQuery("*AMITRG\r\n", QueryState::AMI_TRG_SAMPLE, 0, SAMPLE_TIMEOUT, false, onSample);
+		else
+			enqueueQuery("*TRG\r\n", QueryState::TRG_SAMPLE, 0, SAMPLE_TIMEOUT, false, onSample);
+	}
+	else if (unitConnected)
+	{
+		missedDeadlines++;
 	}
+
+	if (unitConnected)
+		scheduleNextSample(now);
 }
 
 //---------------------------------------------------------------------------
-void Socket::getNextDataPoint()
+void Socket::scheduleNextSample(qint64 now)
 {
-	if (unitConnected)
+	// the 430 cannot be sampled faster than it replies
+	qint64 period = qMax(rateBoost ? MIN_BOOST_PERIOD : minSamplePeriod, (qint64)(latencyAvg * LATENCY_HEADROOM));
+
+	// deadlines advance from the previous deadline, not from when the timer
+	// actually fired, so timer latency does not accumulate as rate drift
+	nextDeadline += period;
+
+	// fell behind (e.g. a long query), skip the missed slots
+	if (nextDeadline < now)
+		nextDeadline = now + period;
+
+	sampleTimer.start((int)((nextDeadline - now + 999999) / 1000000));
+}
+
+//---------------------------------------------------------------------------
+// Accumulates the achieved trigger interval (Welford's algorithm) and
+// reports rate, jitter and latency once per window.
+void Socket::updateAcquisitionStats(qint64 now)
+{
+	if (lastTriggerTime >= 0)
 	{
-		if (queryState.load() == QueryState::IDLE_STATE)
-		{
-			qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
+		double interval = (double)(now - lastTriggerTime);
+		double delta = interval - intervalMean;
 
-			if (magnetdaqParent->supports_AMITRG())	// firmware 2.64/3.14 or later supports private trigger
-			{
-				queryState.store(QueryState::AMI_TRG_SAMPLE);
-				socket->write("*AMITRG\r\n");
-			}
-			else
-			{
-				queryState.store(QueryState::TRG_SAMPLE);
-				socket->write("*TRG\r\n");
-			}
+		intervalCount++;
+		intervalMean += delta / intervalCount;
+		intervalM2 += delta * (interval - intervalMean);
+	}
+	else
+	{
+		statsStart = now;
+	}
 
-			socket->waitForReadyRead(500);
+	lastTriggerTime = now;
 
-			// NOTE: last three values not received in firmware prior to 2.64/3.14
-			emit nextDataPoint(currentTime, magnetField, magnetCurrent, magnetVoltage, supplyCurrent, supplyVoltage, refCurrent, state, heater);
+	if (now - statsStart >= STATS_WINDOW && intervalCount > 1 && intervalMean > 0.0)
+	{
+		double jitter = sqrt(intervalM2 / (intervalCount - 1));
 
-			queryState.store(QueryState::IDLE_STATE);
-		}
+		emit acquisitionStats(1.0e9 / intervalMean, jitter / 1.0e6, latencyAvg / 1.0e6);
+
+		#ifdef DEBUG
+		qDebug() << "Acquisition missed deadlines: " << missedDeadlines;
+		#endif
+
+		statsStart = now;
+		intervalCount = 0;
+		intervalMean = 0.0;
+		intervalM2 = 0.0;
 	}
 }
 
@@ -810,23 +1148,11 @@ void Socket::commandTimerTimeout(void)
 			commandTimer.stop();
 			commandTimer.setInterval(0);
 		}
-		else
+		else if (!isExclusiveInFlight())	// hold commands while the 430 is busy with a long query
 		{
-			while (queryState != QueryState::IDLE_STATE && queryState != QueryState::MSG_UPDATE)
-			{
-#if defined(Q_OS_LINUX) || defined(Q_OS_MACOS)
-				usleep(50000);
-#else
-				Sleep(50);
-#endif
-			}
-
-			QString cmd = commandQueue.dequeue();
-			socket->write(cmd.toLocal8Bit().data(), cmd.size());
-
-			#ifdef DEBUG
-			qDebug() << "CMD: " << cmd;
-			#endif
+			PendingCommand command = commandQueue.dequeue();
+			stats.setCommandQueueDepth(commandQueue.count());
+			writeCommand(command.cmd, command.queued.nsecsElapsed());
 
 			if (magnetdaqParent->isARM())	// dual core ARM -- go faster
 				commandTimer.setInterval(100);
@@ -839,323 +1165,418 @@ void Socket::commandTimerTimeout(void)
 //---------------------------------------------------------------------------
 void Socket::sendCommand(QString aStr)
 {
-	if (unitConnected)
+	if (!isIoThread())
 	{
-		commandQueue.enqueue(aStr);
-		commandTimer.start();
+		QMetaObject::invokeMethod(this, [=]() { sendCommand(aStr); }, Qt::QueuedConnection);
+		return;
 	}
+
+	if (unitConnected)
+		queueCommand(aStr);
 }
 
 //---------------------------------------------------------------------------
+// Commands produce no reply, so they may be written while queries are still
+// in flight without disturbing the FIFO reply matching.
 void Socket::sendBlockingCommand(QString aStr)
 {
+	if (!isIoThread())
+	{
+		QMetaObject::invokeMethod(this, [=]() { sendBlockingCommand(aStr); }, Qt::QueuedConnection);
+		return;
+	}
+
 	if (unitConnected)
 	{
-		while (queryState != QueryState::IDLE_STATE)
+		if (isExclusiveInFlight())
 		{
-#if defined(Q_OS_LINUX) || defined(Q_OS_MACOS)
-				usleep(50000);
-#else
-			Sleep(50);
-#endif
+			// 430 is busy with a long query, send as soon as it completes
+			queueCommand(aStr);
+			return;
 		}
 
-		// according to documentation, this write blocks until all data is written ??
-		socket->write(aStr.toLocal8Bit().data(), aStr.size());
-
-		#ifdef DEBUG
-		qDebug() << "CMD: " << aStr;
-		#endif
+		writeCommand(aStr, 0);
 	}
 }
 
 //---------------------------------------------------------------------------
-void Socket::sendQuery(QString queryStr, QueryState aState)
+void Socket::queueCommand(QString aStr)
 {
-	if (unitConnected)
-	{
-		QElapsedTimer timeout;
-		timeout.restart();
+	PendingCommand command;
 
-		while (queryState.load() != QueryState::IDLE_STATE)
-		{
-			if (timeout.elapsed() > TIMEOUT)
-			{
-				emit systemErrorMessage("Query send timeout", queryStr);
-				return;
-			}
-		}
+	command.cmd = aStr;
+	command.queued.start();
+	commandQueue.enqueue(command);
+	stats.setCommandQueueDepth(commandQueue.count());
+	commandTimer.start();
+}
+
+//---------------------------------------------------------------------------
+void Socket::writeCommand(QString aStr, qint64 queuedTime)
+{
+	socket->write(aStr.toLocal8Bit().data(), aStr.size());
+	stats.recordCommand(aStr, queuedTime / 1000);
 
-		queryState.store(aState);
-		socket->write(queryStr.toLocal8Bit());
-		socket->waitForReadyRead(1000);
+	// read back what the 430 accepted when the view is next shown
+	if (model430)
+		model430->markStale(Model430::commandSyncPages(aStr));
 
-		timeout.restart();
-		while (queryState.load() == aState)
-		{
-			socket->waitForReadyRead(500);
-			if (timeout.elapsed() > TIMEOUT)
-			{
-				queryState.store(QueryState::IDLE_STATE);
-				emit systemErrorMessage("Query reply timeout", queryStr);
-				break;
-			}
-		}
-	}
+	#ifdef DEBUG
+	qDebug() << "CMD: " << aStr;
+	#endif
+}
+
+//---------------------------------------------------------------------------
+// Queues a query and returns immediately. The optional callback is invoked
+// once the reply has been decoded into the model (ok == true), or on reply
+// timeout or disconnect (ok == false).
+void Socket::sendQuery(QString queryStr, QueryState aState, QueryCallback onReply)
+{
+	enqueueQuery(queryStr, aState, 0, TIMEOUT, false, onReply);
 }
 
 //---------------------------------------------------------------------------
 // This is termed an "extended query" because it may return a rather large
 // file (such as troubleshooting.dat) and requires multiple reads to obtain
 // the full reply. The reply end is marked with two contiguous <CR><LF> pairs.
-// Incoming data accumulates in the replyBuffer.
-// Also used for inductance sense and switch current detection
-void Socket::sendExtendedQuery(QString queryStr, QueryState aState, int timelimit /*seconds*/)
+// Also used for inductance sense and switch current detection. Extended
+// queries are always alone on the wire.
+void Socket::sendExtendedQuery(QString queryStr, QueryState aState, int timelimit /*seconds*/, QueryCallback onReply)
 {
-	if (unitConnected)
-	{
-		QElapsedTimer timeout;
-		timeout.restart();
-
-		while (queryState != QueryState::IDLE_STATE)
-		{
-			if (timeout.elapsed() > TIMEOUT)
-			{
-				emit systemErrorMessage("Query send timeout", queryStr);
-				return;
-			}
-		}
+	enqueueQuery(queryStr, aState, 0, timelimit * 1000, true, onReply);
+}
 
-		replyBuffer.clear();
-		queryState.store(aState);
-		socket->write(queryStr.toLocal8Bit());
-		socket->waitForReadyRead(1000);
+//---------------------------------------------------------------------------
+void Socket::sendRampQuery(QString queryStr, QueryState aState, int segment, QueryCallback onReply)
+{
+	enqueueQuery(queryStr, aState, segment, TIMEOUT, false, onReply);
+}
 
-		timeout.restart();
-		while (queryState.load() == aState)
-		{
-			socket->waitForReadyRead(500);
+//---------------------------------------------------------------------------
+// Invokes the callback once every query queued ahead of it has completed.
+void Socket::whenIdle(QueryCallback onIdle)
+{
+	enqueueQuery(QString(), QueryState::IDLE_STATE, 0, 0, false, onIdle);
+}
 
-			if (timeout.elapsed() > (timelimit * 1000))	// longer timeout because we expect a long reply
-			{
-				queryState.store(QueryState::IDLE_STATE);
-				emit systemErrorMessage("Query reply timeout", queryStr);
-				break;
-			}
-		}
+//---------------------------------------------------------------------------
+// Runs a local event loop on the calling (GUI) thread until all queued
+// queries and their callbacks have completed. Only for sequences that cannot
+// proceed without the replies, such as connecting.
+bool Socket::waitForIdle(int msecs)
+{
+	// a dropped connection may delete this object while the loop runs,
+	// so only local references are used once waiting begins
+	QPointer<Socket> self(this);
+	std::shared_ptr<std::atomic<int>> outstanding = outstandingQueries;
+	QElapsedTimer elapsed;
+	elapsed.start();
+
+	while (!self.isNull() && *outstanding > 0 && elapsed.elapsed() < msecs)
+	{
+		// completion callbacks are delivered through this loop
+		QEventLoop loop;
+		QTimer::singleShot(10, &loop, SLOT(quit()));
+		loop.exec(QEventLoop::ExcludeUserInputEvents);
 	}
+
+	return *outstanding == 0;
 }
 
 //---------------------------------------------------------------------------
-void Socket::sendRampQuery(QString queryStr, QueryState aState, int segment)
+// Queries sent between beginBatch() and endBatch() are collected and then
+// written in a burst, as many as MAX_INFLIGHT_BYTES allows in one write,
+// rather than trickled out a few at a time. The replies are decoded as they
+// stream back. Batches may be nested, the outermost endBatch() writes the
+// burst.
+void Socket::beginBatch(void)
 {
-	if (unitConnected)
+	if (!isIoThread())
 	{
-		QElapsedTimer timeout;
-		timeout.restart();
+		QMetaObject::invokeMethod(this, [=]() { beginBatch(); }, Qt::QueuedConnection);
+		return;
+	}
 
-		while (queryState != QueryState::IDLE_STATE)
-		{
-			if (timeout.elapsed() > TIMEOUT)
-			{
-				emit systemErrorMessage("Query send timeout", queryStr);
-				return;
-			}
-		}
+	batchDepth++;
+}
 
-		rampSegment = segment;
-		queryState.store(aState);
-		socket->write(queryStr.toLocal8Bit());
-		socket->waitForReadyRead(1000);
+//---------------------------------------------------------------------------
+void Socket::endBatch(void)
+{
+	if (!isIoThread())
+	{
+		QMetaObject::invokeMethod(this, [=]() { endBatch(); }, Qt::QueuedConnection);
+		return;
+	}
 
-		timeout.restart();
-		while (queryState.load() == aState)
-		{
-			socket->waitForReadyRead(500);
-			if (timeout.elapsed() > TIMEOUT)
-			{
-				queryState.store(QueryState::IDLE_STATE);
-				emit systemErrorMessage("Query reply timeout", queryStr);
-				break;
-			}
-		}
+	if (batchDepth > 0 && --batchDepth == 0)
+	{
+		burstRemaining = pendingQueue.count();
+		writePendingQueries();
 	}
 }
 
-
 //---------------------------------------------------------------------------
-void Socket::getFirmwareVersion(void)
+void Socket::enqueueQuery(QString queryStr, QueryState aState, int segment, int timelimit, bool exclusive, QueryCallback onReply)
 {
-	if (unitConnected)
+	if (!unitConnected)
 	{
-		QElapsedTimer timeout;
-		timeout.restart();
+		if (onReply)
+			onReply(false);
 
-		while (queryState != QueryState::IDLE_STATE)
-		{
-			if (timeout.elapsed() > TIMEOUT)
-			{
-				emit systemErrorMessage("*IDN? send timeout", "");
-				return;
-			}
-		}
+		return;
+	}
+
+	PendingQuery query;
+
+	query.queryStr = queryStr;
+	query.state = aState;
+	query.segment = segment;
+	query.timelimit = timelimit;
+	query.exclusive = exclusive;
+	query.onReply = onReply;
+	query.releasedByCallback = false;
 
-		queryState.store(QueryState::FIRMWARE_VERSION);
-		socket->write("*IDN?\r\n");
-		socket->waitForReadyRead(1000);
+	// count it now so isIdle() is correct as soon as this returns
+	(*outstandingQueries)++;
 
-		timeout.restart();
-		while (queryState.load() == QueryState::FIRMWARE_VERSION)
+	if (isIoThread())
+	{
+		queueQuery(query);
+	}
+	else
+	{
+		// deliver the callback back on the calling thread, where it also
+		// releases the query so chained queries are counted before this one
+		// is released
+		std::shared_ptr<std::atomic<int>> outstanding = outstandingQueries;
+		QObject *context = model430;
+		QueryCallback callback = onReply;
+
+		query.releasedByCallback = true;
+		query.onReply = [outstanding, context, callback](bool ok)
 		{
-			socket->waitForReadyRead(500);
-			if (timeout.elapsed() > TIMEOUT)
+			QMetaObject::invokeMethod(context, [outstanding, callback, ok]()
 			{
-				queryState.store(QueryState::IDLE_STATE);
-				emit systemErrorMessage("*IDN? reply timeout", "");
-				break;
-			}
-		}
+				if (callback)
+					callback(ok);
+
+				(*outstanding)--;
+			}, Qt::QueuedConnection);
+		};
+
+		QMetaObject::invokeMethod(this, [=]() { queueQuery(query); }, Qt::QueuedConnection);
 	}
 }
 
 //---------------------------------------------------------------------------
-void Socket::getMode(void)
+void Socket::queueQuery(PendingQuery query)
 {
 	if (unitConnected)
 	{
-		QElapsedTimer timeout;
-		timeout.restart();
+		pendingQueue.enqueue(query);
+		writePendingQueries();
+	}
+	else
+	{
+		finishQuery(query, false);
+	}
+}
 
-		while (queryState != QueryState::IDLE_STATE)
-		{
-			if (timeout.elapsed() > TIMEOUT)
-			{
-				emit systemErrorMessage("MODE? send timeout", "");
-				return;
-			}
-		}
+//---------------------------------------------------------------------------
+void Socket::finishQuery(PendingQuery &query, bool ok)
+{
+	if (query.onReply)
+		query.onReply(ok);
+
+	if (!query.releasedByCallback)
+		(*outstandingQueries)--;
+}
+
+//---------------------------------------------------------------------------
+// Moves queries from the pending queue onto the wire while there is room in
+// the pipeline. Extended queries are written only to an empty pipeline and
+// hold back everything else until they complete. The queries of a batch
+// (a burst) get a much deeper pipeline, topped up as replies arrive, always
+// within MAX_INFLIGHT_BYTES.
+void Socket::writePendingQueries(void)
+{
+	if (batchDepth > 0 || resyncing)
+		return;	// still collecting a batch, or waiting out late replies
 
-		queryState.store(QueryState::MODE);
-		socket->write("MODE?\r\n");
-		socket->waitForReadyRead(1000);
+	int maxInFlight = (burstRemaining > 0) ? MAX_BURST_QUERIES : MAX_QUERIES_IN_FLIGHT;
+	int inflightBytes = 0;
+	QByteArray output;
 
-		timeout.restart();
-		while (queryState.load() == QueryState::MODE)
+	for (const PendingQuery &query : inflightQueue)
+		inflightBytes += query.queryStr.size();
+
+	while (unitConnected && !pendingQueue.isEmpty())
+	{
+		const PendingQuery &next = pendingQueue.head();
+
+		if (next.queryStr.isEmpty())
 		{
-			socket->waitForReadyRead(500);
-			if (timeout.elapsed() > TIMEOUT)
-			{
-				queryState.store(QueryState::IDLE_STATE);
-				emit systemErrorMessage("MODE? reply timeout", "");
+			// idle marker, fire once everything ahead of it is answered
+			if (!inflightQueue.isEmpty())
 				break;
-			}
+
+			PendingQuery marker = pendingQueue.dequeue();
+			finishQuery(marker, true);
+
+			if (burstRemaining > 0)
+				burstRemaining--;
+
+			continue;
 		}
+
+		if (inflightQueue.count() >= maxInFlight)
+			break;
+
+		if (!inflightQueue.isEmpty() && inflightBytes + next.queryStr.size() > MAX_INFLIGHT_BYTES)
+			break;
+
+		if (!inflightQueue.isEmpty() && (next.exclusive || inflightQueue.head().exclusive))
+			break;
+
+		PendingQuery query = pendingQueue.dequeue();
+		query.sent.start();
+		query.written.start();
+		output.append(query.queryStr.toLocal8Bit());
+		inflightBytes += query.queryStr.size();
+		inflightQueue.enqueue(query);
+
+		if (burstRemaining > 0)
+			burstRemaining--;
+
+		// sample send time is when the trigger leaves, not when it was queued
+		if (query.state == QueryState::TRG_SAMPLE || query.state == QueryState::AMI_TRG_SAMPLE)
+			triggerWriteTime = acquisitionClock.nsecsElapsed();
+
+		#ifdef DEBUG
+		qDebug() << "QUERY: " << query.queryStr;
+		#endif
+	}
+
+	if (!output.isEmpty())
+		socket->write(output);
+
+	if (inflightQueue.isEmpty())
+		replyTimer.stop();
+	else if (!replyTimer.isActive())
+	{
+		replyTimer.start();
 	}
 }
 
 //---------------------------------------------------------------------------
-void Socket::getState(void)
+void Socket::replyTimerTimeout(void)
 {
-	if (unitConnected)
+	if (resyncing)
 	{
-		QElapsedTimer timeout;
-		timeout.restart();
-
-		while (queryState != QueryState::IDLE_STATE)
+		if (resyncTimer.elapsed() > RESYNC_TIMEOUT)
 		{
-			if (timeout.elapsed() > TIMEOUT)
-			{
-				emit systemErrorMessage("STATE? send timeout", "");
-				return;
-			}
+			// the marker went missing too, carry on from a clean buffer
+			qDebug() << "Resync marker reply timeout";
+			resyncing = false;
+			framer.clear();
+			writePendingQueries();
 		}
+	}
+	else if (!inflightQueue.isEmpty() && inflightQueue.head().sent.elapsed() > inflightQueue.head().timelimit)
+	{
+		PendingQuery query = inflightQueue.dequeue();
 
-		queryState.store(QueryState::STATE);
-		socket->write("STATE?\r\n");
-		socket->waitForReadyRead(1000);
+		stats.recordTimeout(query.state);
 
-		timeout.restart();
-		while (queryState.load() == QueryState::STATE)
-		{
-			socket->waitForReadyRead(500);
-			if (timeout.elapsed() > TIMEOUT)
-			{
-				queryState.store(QueryState::IDLE_STATE);
-				emit systemErrorMessage("STATE? reply timeout", "");
-				break;
-			}
-		}
+		// retry the missing value when its view is next shown
+		if (model430)
+			model430->markStale(Model430::querySyncPages(query.state));
+
+		// a missed sample is not an error, the next trigger replaces it
+		if (query.state != QueryState::TRG_SAMPLE && query.state != QueryState::AMI_TRG_SAMPLE)
+			emit systemErrorMessage("Query reply timeout", query.queryStr);
+
+		finishQuery(query, false);
+		resync();
 	}
 }
 
 //---------------------------------------------------------------------------
-void Socket::getStatusByte(void)
+// A late reply to an expired query would be matched to the next one. The
+// queries still in flight go back to the front of the pending queue and an
+// *IDN? marker is written; its reply, which looks like no other, ends the
+// stale input and the requeued queries are written again.
+void Socket::resync(void)
 {
-	if (unitConnected)
+	framer.clear();	// any partial reply belongs to the expired query
+
+	while (!inflightQueue.isEmpty())
+		pendingQueue.prepend(inflightQueue.takeLast());
+
+	if (idnReply.isEmpty() || !unitConnected)
 	{
-		QElapsedTimer timeout;
-		timeout.restart();
+		writePendingQueries();	// no marker reply known yet
+		return;
+	}
 
-		while (queryState != QueryState::IDLE_STATE)
-		{
-			if (timeout.elapsed() > TIMEOUT)
-			{
-				emit systemErrorMessage("*STB? send timeout", "");
-				return;
-			}
-		}
+	resyncing = true;
+	resyncTimer.start();
+	socket->write("*IDN?\r\n");
+}
+
+//---------------------------------------------------------------------------
+void Socket::abortQueries(void)
+{
+	replyTimer.stop();
+	framer.clear();
+	resyncing = false;
+
+	QQueue<PendingQuery> aborted = inflightQueue;
+	aborted.append(pendingQueue);
+	inflightQueue.clear();
+	pendingQueue.clear();
+	burstRemaining = 0;
+	triggerInFlight = false;
+
+	for (int i = 0; i < aborted.count(); i++)
+		finishQuery(aborted[i], false);
+}
 
-		queryState.store(QueryState::STATUS_BYTE);
-		socket->write("*STB?\r\n");
-		socket->waitForReadyRead(1000);
+//---------------------------------------------------------------------------
+bool Socket::isExclusiveInFlight(void)
+{
+	return !inflightQueue.isEmpty() && inflightQueue.head().exclusive;
+}
 
-		timeout.restart();
-		while (queryState.load() == QueryState::STATUS_BYTE)
-		{
-			socket->waitForReadyRead(500);
-			if (timeout.elapsed() > TIMEOUT)
-			{
-				queryState.store(QueryState::IDLE_STATE);
-				emit systemErrorMessage("*STB? reply timeout", "");
-				break;
-			}
-		}
-	}
+//---------------------------------------------------------------------------
+void Socket::getFirmwareVersion(void)
+{
+	sendQuery("*IDN?\r\n", QueryState::FIRMWARE_VERSION);
 }
 
 //---------------------------------------------------------------------------
-void Socket::getIpName(void)
+void Socket::getMode(void)
 {
-	if (unitConnected)
-	{
-		QElapsedTimer timeout;
-		timeout.restart();
+	sendQuery("MODE?\r\n", QueryState::MODE);
+}
 
-		while (queryState != QueryState::IDLE_STATE)
-		{
-			if (timeout.elapsed() > TIMEOUT)
-			{
-				emit systemErrorMessage("IPNAME? send timeout", "");
-				return;
-			}
-		}
+//---------------------------------------------------------------------------
+void Socket::getState(void)
+{
+	sendQuery("STATE?\r\n", QueryState::STATE);
+}
 
-		queryState.store(QueryState::IPNAME);
-		socket->write("IPNAME?\r\n");
-		socket->waitForReadyRead(1000);
+//---------------------------------------------------------------------------
+void Socket::getStatusByte(void)
+{
+	sendQuery("*STB?\r\n", QueryState::STATUS_BYTE);
+}
 
-		timeout.restart();
-		while (queryState.load() == QueryState::IPNAME)
-		{
-			socket->waitForReadyRead(500);
-			if (timeout.elapsed() > TIMEOUT)
-			{
-				queryState.store(QueryState::IDLE_STATE);
-				emit systemErrorMessage("IPNAME? reply timeout", "");
-				break;
-			}
-		}
-	}
+//---------------------------------------------------------------------------
+void Socket::getIpName(void)
+{
+	sendQuery("IPNAME?\r\n", QueryState::IPNAME);
 }
 
 //---------------------------------------------------------------------------
@@ -6,8 +6,38 @@
 #include <QDebug>
 #include <QQueue>
 #include "model430.h"
+#include "samplering.h"
+#include "lineframer.h"
+#include "commstats.h"
 #include <atomic>
+#include <functional>
+#include <memory>
 
+// one acquired data point, handed from the I/O thread to the GUI
+struct Sample
+{
+	qint64 time;			// Unix time (ms) at the send/receive midpoint
+	qint64 sendTime;		// trigger written (us), monotonic acquisition clock
+	qint64 receiveTime;		// reply decoded or timed out (us)
+	qint64 midpointTime;	// best estimate of when the values were measured (us)
+	bool stale;				// no good reply, values repeat the previous sample
+	double magnetField;
+	double magnetCurrent;
+	double magnetVoltage;
+	double supplyCurrent;
+	double supplyVoltage;
+	double refCurrent;
+	quint8 state;
+	quint8 heater;
+};
+Q_DECLARE_METATYPE(Sample)
+
+//---------------------------------------------------------------------------
+// Socket objects live on the I/O thread. The public query/command methods
+// may be called from the GUI thread; they are marshalled onto the I/O
+// thread. Replies are applied to the Model430 on its own (GUI) thread and
+// query callbacks are delivered there after them.
+//---------------------------------------------------------------------------
 class Socket : public QObject
 {
 	Q_OBJECT
@@ -18,12 +48,26 @@ public:
 	~Socket();
 
 	void connectToModel430(QString ipaddress, quint16 port, QNetworkProxy::ProxyType aProxyType);
-	void getNextDataPoint();
 	bool isConnected() {return unitConnected;}
+	void startSampling(int maxRate /* samples/sec */);
+	void stopSampling(void);
+	void setSampleRateLimit(int maxRate /* samples/sec */);
+	void setRateBoost(bool boost);
+	bool nextSample(Sample &sample) { return sampleRing.pop(sample); }
+	void setSampleStreaming(bool on) { streamSamples.store(on); }	// also emit sampleAcquired()
+	quint64 getDroppedSamples(void) { return droppedSamples; }
+	const CommStats &commStats(void) { return stats; }
+	void resetCommStats(void) { stats.reset(); }
 	void sendCommand(QString);
-	void sendQuery(QString queryStr, QueryState aState);
-	void sendExtendedQuery(QString queryStr, QueryState aState, int timelimit /*seconds*/);
-	void sendRampQuery(QString queryStr, QueryState aState, int segment);
+	void sendQuery(QString queryStr, QueryState aState, QueryCallback onReply = nullptr);
+	void sendExtendedQuery(QString queryStr, QueryState aState, int timelimit /*seconds*/, QueryCallback onReply = nullptr);
+	void sendRampQuery(QString queryStr, QueryState aState, int segment, QueryCallback onReply = nullptr);
+	void whenIdle(QueryCallback onIdle);
+	bool waitForIdle(int msecs);
+	bool isIdle(void) { return *outstandingQueries == 0; }
+	int queriesOutstanding(void) { return *outstandingQueries; }
+	void beginBatch(void);
+	void endBatch(void);
 	void getFirmwareVersion();
 	void getMode();
 	void getState(void);
@@ -35,7 +79,6 @@ public slots:
 	void sendBlockingCommand(QString aStr);
 
 signals:
-	void nextDataPoint(qint64 time, double magField, double magCurrent, double magVoltage, double supCurrent, double supVoltage, double refCurrent, quint8 state, quint8 heater);
 	void updateFrontPanel(QString displayString, bool shiftLED, bool fieldLED, bool persistentLED, bool engergizedLED, bool quenchLED);
 	void systemError();
 	void fieldUnitsChanged();
@@ -43,6 +86,8 @@ signals:
 	void endExternalRampdown();
 	void systemErrorMessage(QString errMsg, QString lastStrSent);
 	void model430Disconnected(void);
+	void acquisitionStats(double rate /* samples/sec */, double jitter /* ms */, double latency /* ms */);
+	void sampleAcquired(Sample sample);	// on the I/O thread, while streaming
 
 private slots:
 	void connected();
@@ -50,24 +95,95 @@ private slots:
 	void readyRead();
 	void bytesWritten(qint64 bytes);
 	void commandTimerTimeout(void);
+	void replyTimerTimeout(void);
+	void getNextDataPoint(void);
 
 private:
+	// a query waiting to be written or awaiting its reply
+	struct PendingQuery
+	{
+		QString queryStr;		// empty for an idle marker
+		QueryState state;		// how to decode the reply
+		int segment;			// ramp segment for segment queries
+		int timelimit;			// reply time limit in ms
+		bool exclusive;			// must be alone on the wire (extended queries)
+		QueryCallback onReply;
+		bool releasedByCallback;	// callback runs on the GUI thread and releases the query there
+		QElapsedTimer sent;			// reply time limit, restarted as earlier replies arrive
+		QElapsedTimer written;		// for latency statistics
+	};
+
+	// a command waiting for its turn on the wire
+	struct PendingCommand
+	{
+		QString cmd;
+		QElapsedTimer queued;
+	};
+
+	void initialize(void);
+	bool isIoThread(void) { return QThread::currentThread() == thread(); }
+	void enqueueQuery(QString queryStr, QueryState aState, int segment, int timelimit, bool exclusive, QueryCallback onReply);
+	void queueQuery(PendingQuery query);
+	void finishQuery(PendingQuery &query, bool ok);
+	void queueCommand(QString aStr);
+	void writeCommand(QString aStr, qint64 queuedTime /* ns */);
+	void writePendingQueries(void);
+	void processReply(QueryState aState, int segment, QString reply);
+	void processMessage(QString reply);
+	static void applyReply(Model430 *model430, QueryState aState, int segment, QString reply);
+	void scheduleNextSample(qint64 now);
+	void updateAcquisitionStats(qint64 now);
+	bool decodeSample(const char *data, int length, QueryState aState);
+	void resync(void);
+	void abortQueries(void);
+	bool isExclusiveInFlight(void);
+
 	QTcpSocket *socket;
 	QString ipAddress;
 	quint16 ipPort;
 	std::atomic<QueryState> queryState;
 	volatile bool cmdWritten;
-	double magnetField, magnetCurrent, magnetVoltage, supplyCurrent, supplyVoltage, refCurrent;
-	quint8 state, heater;
-	bool unitConnected;
-	QQueue<QString> commandQueue;
+	Sample lastSample;	// most recent decoded trigger reply, time not set
+	std::atomic<bool> unitConnected;
+	QQueue<PendingCommand> commandQueue;
 	QTimer commandTimer;
-	QString replyBuffer;
+	LineFramer framer;		// splits the received stream into replies
+	QQueue<PendingQuery> pendingQueue;		// queued, not yet written
+	QQueue<PendingQuery> inflightQueue;		// written, replies matched in FIFO order
+	QTimer replyTimer;
+	bool resyncing;				// after a reply timeout, see resync()
+	QElapsedTimer resyncTimer;	// since the marker was written
+	QByteArray idnReply;		// the marker's expected reply
+	bool triggerInFlight;
+	int batchDepth;		// > 0 while a batch of queries is being collected
+	int burstRemaining;	// queries of the last batch not yet written
+
+	// queries accepted but not yet completed, shared with callbacks that may outlive this object
+	std::shared_ptr<std::atomic<int>> outstandingQueries;
+
+	// samples acquired on the I/O thread, drained by the GUI
+	QTimer sampleTimer;				// single shot, rearmed for each deadline
+	QElapsedTimer acquisitionClock;	// monotonic, all times below in ns
+	qint64 minSamplePeriod;			// from the user rate limit
+	bool rateBoost;					// ignore the rate limit, e.g. after an event trigger
+	qint64 nextDeadline;
+	qint64 triggerWriteTime;		// when the in-flight trigger went out on the wire
+	qint64 epochOffset;				// us, acquisition clock to Unix time
+	double latencyAvg;				// smoothed trigger reply latency
+	quint64 missedDeadlines;		// trigger still awaiting a reply at its next deadline
+	qint64 statsStart;				// achieved rate and jitter window
+	qint64 lastTriggerTime;
+	int intervalCount;
+	double intervalMean;
+	double intervalM2;
+	SampleRing<Sample, 1024> sampleRing;
+	std::atomic<quint64> droppedSamples;
+	std::atomic<bool> streamSamples;
+	CommStats stats;		// latency and error instrumentation
 
 	// Model 430 settings
 	Model430 *model430;
 	QString firmwareVersion;
-	int rampSegment;	// present ramp segment for query/command
 };
 
 #endif // SOCKET_H